@@ -0,0 +1,23 @@
+#include "bench.h"
+
+#include <cstdlib>
+#include <new>
+
+std::size_t bench::allocations = 0;
+
+void *operator new(std::size_t size) {
+	bench::allocations += 1;
+	void *ptr = std::malloc(size == 0 ? 1 : size);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+	std::free(ptr);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace bench {
+
+// Counts every call to the global operator new; defined in alloc.cc.
+extern std::size_t allocations;
+
+struct Measurement {
+	std::uint64_t iters;
+	double seconds;
+	std::size_t allocs;
+};
+
+// Run 'func' repeatedly for roughly 'target' seconds, after a warmup.
+template<typename Func>
+Measurement run(Func func, double target = 0.2);
+
+class Bench {
+public:
+	explicit Bench(const char *name): name_(name) {}
+
+	// Run 'func' repeatedly and report the result. One call to 'func'
+	// is expected to perform 'ops' operations and process 'bytes' bytes.
+	template<typename Func>
+	void measure(const char *variant, std::size_t ops, std::size_t bytes, Func func);
+
+private:
+	void report(
+		const char *variant, std::size_t ops, std::size_t bytes,
+		std::uint64_t iters, double seconds, std::size_t allocs);
+
+	const char *name_;
+};
+
+struct Benchmark {
+	Benchmark(const char *file, int line, const char *name, void (*func)(Bench &));
+
+	const char *file;
+	int line;
+	const char *name;
+	void (*func)(Bench &) = nullptr;
+};
+
+template<typename T>
+inline void consume(const T &val) {
+	asm volatile("" : : "r,m"(val) : "memory");
+}
+
+// An input stream over a fixed buffer which can be rewound without allocating.
+class MemIStream: public std::istream {
+public:
+	MemIStream(): std::istream(&buf_) {}
+
+	explicit MemIStream(std::string_view data): std::istream(&buf_) {
+		reset(data);
+	}
+
+	void reset(std::string_view data) {
+		data_ = data;
+		rewind();
+	}
+
+	void rewind() {
+		char *begin = const_cast<char *>(data_.data());
+		buf_.set(begin, begin + data_.size());
+		clear();
+	}
+
+private:
+	class Buf: public std::streambuf {
+	public:
+		void set(char *begin, char *end) {
+			setg(begin, begin, end);
+		}
+	};
+
+	Buf buf_;
+	std::string_view data_;
+};
+
+// An output stream into a string whose capacity is kept between iterations.
+class MemOStream: public std::ostream {
+public:
+	MemOStream(): std::ostream(&buf_) {}
+
+	void reserve(std::size_t size) {
+		buf_.str.reserve(size);
+	}
+
+	void rewind() {
+		buf_.str.clear();
+		clear();
+	}
+
+	const std::string &str() const {
+		return buf_.str;
+	}
+
+private:
+	class Buf: public std::streambuf {
+	public:
+		std::string str;
+
+	protected:
+		int_type overflow(int_type ch) override {
+			if (ch != traits_type::eof()) {
+				str += (char)ch;
+			}
+			return ch;
+		}
+
+		std::streamsize xsputn(const char *s, std::streamsize n) override {
+			str.append(s, n);
+			return n;
+		}
+	};
+
+	Buf buf_;
+};
+
+template<typename Func>
+inline Measurement run(Func func, double target) {
+	using Clock = std::chrono::steady_clock;
+
+	// Warm up, and find out roughly how long one iteration takes
+	std::uint64_t iters = 1;
+	double seconds;
+	while (true) {
+		auto start = Clock::now();
+		for (std::uint64_t i = 0; i < iters; ++i) {
+			func();
+		}
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (seconds >= target / 20) {
+			break;
+		}
+		iters *= 2;
+	}
+
+	iters = (std::uint64_t)((double)iters * (target / seconds)) + 1;
+
+	std::size_t allocsBefore = allocations;
+	auto start = Clock::now();
+	for (std::uint64_t i = 0; i < iters; ++i) {
+		func();
+	}
+	seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	return {iters, seconds, allocations - allocsBefore};
+}
+
+template<typename Func>
+inline void Bench::measure(const char *variant, std::size_t ops, std::size_t bytes, Func func) {
+	Measurement m = run(func);
+	report(variant, ops, bytes, m.iters, m.seconds, m.allocs);
+}
+
+}
+
+#define BENCH_COMBINE1(x,y) x##y
+#define BENCH_COMBINE(x,y) BENCH_COMBINE1(x,y)
+#define BENCHMARK(name) \
+	static void BENCH_COMBINE(benchfunc_,__LINE__)(bench::Bench &bench); \
+	static bench::Benchmark BENCH_COMBINE(benchmark_,__LINE__) = { \
+		__FILE__, __LINE__, name, BENCH_COMBINE(benchfunc_,__LINE__), \
+	}; \
+	static void BENCH_COMBINE(benchfunc_,__LINE__)([[maybe_unused]] bench::Bench &bench)
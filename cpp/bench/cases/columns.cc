@@ -0,0 +1,81 @@
+#include <sbon.h>
+#include <sbon-agg.h>
+#include <sbon-columns.h>
+
+#include "bench.h"
+#include "gen.h"
+
+// An array of 'count' records with a few fields,
+// of which the benchmarks extract two.
+static std::string records(std::size_t count) {
+	gen::Rng rng;
+	std::stringstream ss;
+	sbon::Writer(&ss).writeArray([&](sbon::Writer w) {
+		for (std::size_t i = 0; i < count; ++i) {
+			w.writeObject([&](sbon::ObjectWriter w) {
+				w.key("id").writeUInt(i);
+				w.key("name").writeString(gen::word(rng, 12));
+				w.key("price").writeDouble(rng.unit() * 100);
+				w.key("tags").writeArray([&](sbon::Writer w) {
+					w.writeString(gen::word(rng, 6));
+					w.writeString(gen::word(rng, 6));
+				});
+				w.key("qty").writeUInt(rng.below(1000));
+			});
+		}
+	});
+	return ss.str();
+}
+
+BENCHMARK("Column extraction") {
+	std::size_t count = 1000;
+	auto data = records(count);
+	bench::MemIStream is(data);
+
+	std::vector<double> prices;
+	std::vector<std::int64_t> qtys;
+	bench.measure("matchObject per row", count, data.size(), [&] {
+		is.rewind();
+		prices.clear();
+		qtys.clear();
+		sbon::Reader(&is).readArray([&](sbon::Reader val) {
+			double price = 0;
+			std::int64_t qty = 0;
+			val.matchObject({
+				{"price", [&](sbon::Reader val) { price = val.getDouble(); }},
+				{"qty", [&](sbon::Reader val) { qty = val.getInt(); }},
+			});
+			prices.push_back(price);
+			qtys.push_back(qty);
+		});
+		bench::consume(prices.size() + qtys.size());
+	});
+
+	sbon::ColumnExtractor ex;
+	ex.add("price", sbon::ColumnType::DOUBLE);
+	ex.add("qty", sbon::ColumnType::INT);
+	bench.measure("ColumnExtractor", count, data.size(), [&] {
+		is.rewind();
+		ex.clear();
+		ex.extract(sbon::Reader(&is));
+		bench::consume(ex.rows());
+	});
+}
+
+BENCHMARK("Aggregate::add") {
+	auto values = gen::doubles(4096);
+
+	sbon::Aggregate single;
+	bench.measure("one at a time", values.size(), values.size() * 8, [&] {
+		for (double v: values) {
+			single.add(v);
+		}
+		bench::consume(single.count());
+	});
+
+	sbon::Aggregate batched;
+	bench.measure("batch", values.size(), values.size() * 8, [&] {
+		batched.add(values);
+		bench::consume(batched.count());
+	});
+}
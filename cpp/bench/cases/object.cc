@@ -0,0 +1,263 @@
+#include <sbon.h>
+#include <sbon-diff.h>
+#include <sbon-fixed.h>
+#include <sbon-index.h>
+#include <sbon-shared.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "bench.h"
+#include "gen.h"
+
+BENCHMARK("ObjectReader::match") {
+	for (std::size_t count: {4, 16, 64, 256}) {
+		auto keys = gen::keys(count);
+		auto data = gen::object(keys);
+		bench::MemIStream is(data);
+
+		// Look for the first key, a key in the middle and the last key,
+		// so that the matcher has to skip most of the object
+		std::string first = keys.front();
+		std::string middle = keys[count / 2];
+		std::string last = keys.back();
+
+		std::string variant = std::to_string(count) + " keys";
+		bench.measure(variant.c_str(), 1, data.size(), [&] {
+			is.rewind();
+			std::uint64_t sum = 0;
+			sbon::Reader(&is).matchObject({
+				{first, [&](sbon::Reader val) { sum += val.getUInt(); }},
+				{middle, [&](sbon::Reader val) { sum += val.getUInt(); }},
+				{last, [&](sbon::Reader val) { sum += val.getUInt(); }},
+			});
+			bench::consume(sum);
+		});
+	}
+}
+
+BENCHMARK("ObjectReader::all") {
+	for (std::size_t count: {4, 16, 64, 256}) {
+		auto keys = gen::keys(count);
+		auto data = gen::object(keys);
+		bench::MemIStream is(data);
+
+		std::string variant = std::to_string(count) + " keys";
+		bench.measure(variant.c_str(), count, data.size(), [&] {
+			is.rewind();
+			std::uint64_t sum = 0;
+			sbon::Reader(&is).readObject([&](std::string &, sbon::Reader val) {
+				sum += val.getUInt();
+			});
+			bench::consume(sum);
+		});
+	}
+}
+
+static void traverse(sbon::Reader r, std::uint64_t &sum) {
+	switch (r.getType()) {
+	case sbon::Type::ARRAY:
+		r.readArray([&](sbon::Reader val) {
+			traverse(val, sum);
+		});
+		break;
+
+	case sbon::Type::OBJECT:
+		r.readObject([&](std::string &, sbon::Reader val) {
+			traverse(val, sum);
+		});
+		break;
+
+	case sbon::Type::STRING:
+		sum += r.getString().size();
+		break;
+
+	case sbon::Type::BOOL:
+		sum += r.getBool();
+		break;
+
+	case sbon::Type::DOUBLE:
+		sum += (std::uint64_t)r.getDouble();
+		break;
+
+	default:
+		sum += r.getUInt();
+		break;
+	}
+}
+
+BENCHMARK("Nested traversal") {
+	struct Variant {
+		const char *name;
+		int depth;
+		int width;
+	};
+
+	Variant variants[] = {
+		{"deep, narrow", 12, 2},
+		{"shallow, wide", 3, 16},
+	};
+
+	for (auto &variant: variants) {
+		auto data = gen::nested(variant.depth, variant.width);
+		bench::MemIStream is(data);
+
+		bench.measure(variant.name, 1, data.size(), [&] {
+			is.rewind();
+			std::uint64_t sum = 0;
+			traverse(sbon::Reader(&is), sum);
+			bench::consume(sum);
+		});
+
+		std::string skipName = std::string(variant.name) + ", skip";
+		bench.measure(skipName.c_str(), 1, data.size(), [&] {
+			is.rewind();
+			sbon::Reader(&is).skip();
+		});
+	}
+}
+
+// The heap-free profile: a fixed output buffer, fixed keys and strings,
+// and errors recorded in an sbon::Error. Should report 0 allocs/op.
+BENCHMARK("Fixed-capacity round trip") {
+	sbon::FixedOStream<256> os;
+	sbon::FixedString<32> key;
+	sbon::FixedString<32> name;
+	sbon::Error err;
+
+	bench.measure("write+read", 1, 0, [&] {
+		err = {};
+		os.reset();
+		sbon::Writer(&os, &err).writeObject([](sbon::ObjectWriter w) {
+			w.key("a key which is longer than SSO").writeUInt(1000);
+			w.key("name").writeString("channel 12 gain");
+			w.key("gain").writeFloat(0.5f);
+		});
+
+		sbon::SpanIStream is(os.view());
+		std::uint64_t sum = 0;
+		sbon::Reader(&is, &err).getObject([&](sbon::ObjectReader obj) {
+			while (obj.hasNext()) {
+				auto val = obj.next(key);
+				if (key == "name") {
+					val.getString(name);
+					sum += name.size();
+				} else {
+					val.skip();
+				}
+			}
+		});
+		if (err || sum != 15) {
+			std::abort();
+		}
+		bench::consume(sum);
+	});
+}
+
+// A record where one field changed, as when replicating an update
+BENCHMARK("diff and apply") {
+	for (std::size_t count: {16, 256}) {
+		auto keys = gen::keys(count);
+		auto a = gen::object(keys);
+		std::stringstream ss;
+		sbon::Writer(&ss).writeObject([&](sbon::ObjectWriter w) {
+			for (std::size_t i = 0; i < keys.size(); ++i) {
+				w.key(keys[i].c_str()).writeUInt(i == count / 2 ? 1000 : i * 31);
+			}
+		});
+		auto b = ss.str();
+		auto patch = sbon::diff(a, b);
+
+		std::string variant = "diff " + std::to_string(count) + " keys";
+		bench.measure(variant.c_str(), 1, a.size() + b.size(), [&] {
+			bench::consume(sbon::diff(a, b).size());
+		});
+
+		variant = "apply " + std::to_string(count) + " keys";
+		bench.measure(variant.c_str(), 1, a.size(), [&] {
+			bench::consume(sbon::apply(patch, a).size());
+		});
+	}
+}
+
+// Looking up the same keys as ObjectReader::match, once the object is indexed
+BENCHMARK("SharedValue::find") {
+	for (std::size_t count: {4, 16, 64, 256}) {
+		auto keys = gen::keys(count);
+		sbon::SharedDocument doc(gen::object(keys));
+		std::string first = keys.front();
+		std::string middle = keys[count / 2];
+		std::string last = keys.back();
+
+		std::string variant = std::to_string(count) + " keys";
+		bench.measure(variant.c_str(), 1, doc.data().size(), [&] {
+			auto root = doc.root();
+			std::uint64_t sum = root.find(first)->getUInt();
+			sum += root.find(middle)->getUInt();
+			sum += root.find(last)->getUInt();
+			bench::consume(sum);
+		});
+	}
+}
+
+static std::string sortedObject(const std::vector<std::string> &keys, sbon::ObjectIndex *index) {
+	auto write = [&](sbon::SortedObjectWriter &w) {
+		for (std::size_t i = 0; i < keys.size(); ++i) {
+			w.key(keys[i].c_str()).writeUInt(i * 31);
+		}
+	};
+
+	std::stringstream ss;
+	if (index) {
+		sbon::writeIndexedObject(&ss, *index, write);
+	} else {
+		sbon::writeSortedObject(sbon::Writer(&ss), write);
+	}
+	return ss.str();
+}
+
+// The same lookups as ObjectReader::match, in an object with sorted keys
+BENCHMARK("ObjectReader::find") {
+	for (std::size_t count: {4, 16, 64, 256}) {
+		auto keys = gen::keys(count);
+		auto data = sortedObject(keys, nullptr);
+		bench::MemIStream is(data);
+
+		std::sort(keys.begin(), keys.end());
+		std::string first = keys.front();
+		std::string middle = keys[count / 2];
+		std::string last = keys.back();
+
+		std::string variant = std::to_string(count) + " keys";
+		bench.measure(variant.c_str(), 1, data.size(), [&] {
+			is.rewind();
+			std::uint64_t sum = 0;
+			sbon::Reader(&is).getObject([&](sbon::ObjectReader obj) {
+				obj.find(first, [&](sbon::Reader val) { sum += val.getUInt(); });
+				obj.find(middle, [&](sbon::Reader val) { sum += val.getUInt(); });
+				obj.find(last, [&](sbon::Reader val) { sum += val.getUInt(); });
+				obj.skipRest();
+			});
+			bench::consume(sum);
+		});
+	}
+}
+
+BENCHMARK("ObjectIndex::find") {
+	for (std::size_t count: {16, 64, 256}) {
+		auto keys = gen::keys(count);
+		sbon::ObjectIndex index(16);
+		auto data = sortedObject(keys, &index);
+		std::istringstream is(data);
+
+		std::sort(keys.begin(), keys.end());
+		std::string middle = keys[count / 2];
+
+		std::string variant = std::to_string(count) + " keys";
+		bench.measure(variant.c_str(), 1, data.size(), [&] {
+			std::uint64_t sum = 0;
+			index.find(&is, middle, [&](sbon::Reader val) { sum += val.getUInt(); });
+			bench::consume(sum);
+		});
+	}
+}
@@ -0,0 +1,273 @@
+#include <sbon.h>
+#include <sbon-io.h>
+
+#include <memory_resource>
+#include <sstream>
+
+#include "bench.h"
+#include "gen.h"
+
+static constexpr std::size_t COUNT = 1000;
+
+template<typename Encode>
+static std::string encode(Encode encodeFunc) {
+	std::stringstream ss;
+	encodeFunc(sbon::Writer(&ss));
+	return ss.str();
+}
+
+template<typename Func>
+static void measureRead(
+		bench::Bench &bench, const char *variant, std::size_t count,
+		const std::string &data, Func func) {
+	bench::MemIStream is(data);
+	bench.measure(variant, count, data.size(), [&] {
+		is.rewind();
+		func(sbon::Reader(&is));
+	});
+}
+
+BENCHMARK("Reader::getBool") {
+	auto data = encode([](sbon::Writer w) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			w.writeBool(i & 1);
+		}
+	});
+
+	measureRead(bench, "", COUNT, data, [](sbon::Reader r) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			bench::consume(r.getBool());
+		}
+	});
+}
+
+BENCHMARK("Reader::getNil") {
+	auto data = encode([](sbon::Writer w) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			w.writeNull();
+		}
+	});
+
+	measureRead(bench, "", COUNT, data, [](sbon::Reader r) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			r.getNil();
+		}
+	});
+}
+
+BENCHMARK("Reader::getType") {
+	auto data = encode([](sbon::Writer w) {
+		w.writeDouble(1);
+	});
+
+	// getType only peeks, so it doesn't process any bytes
+	bench::MemIStream is(data);
+	bench.measure("", COUNT, 0, [&] {
+		is.rewind();
+		sbon::Reader r(&is);
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			bench::consume(r.getType());
+		}
+	});
+}
+
+BENCHMARK("Reader::getInt") {
+	struct Variant {
+		const char *name;
+		std::vector<std::int64_t> nums;
+	};
+
+	Variant variants[] = {
+		{"immediate", gen::ints(COUNT, 9)},
+		{"1 byte", gen::ints(COUNT, 127, true)},
+		{"4 bytes", gen::ints(COUNT, 0xfffffff, true)},
+		{"9 bytes", gen::ints(COUNT, 0x7fffffffffffffffll, true)},
+	};
+
+	for (auto &variant: variants) {
+		auto data = encode([&](sbon::Writer w) {
+			for (auto num: variant.nums) {
+				w.writeInt(num);
+			}
+		});
+
+		measureRead(bench, variant.name, COUNT, data, [](sbon::Reader r) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				bench::consume(r.getInt());
+			}
+		});
+	}
+}
+
+BENCHMARK("Reader::getUInt") {
+	auto nums = gen::ints(COUNT, 0xfffffff);
+	auto data = encode([&](sbon::Writer w) {
+		for (auto num: nums) {
+			w.writeUInt((std::uint64_t)num);
+		}
+	});
+
+	measureRead(bench, "4 bytes", COUNT, data, [](sbon::Reader r) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			bench::consume(r.getUInt());
+		}
+	});
+}
+
+BENCHMARK("Reader::getFloat") {
+	auto nums = gen::doubles(COUNT);
+	auto data = encode([&](sbon::Writer w) {
+		for (auto num: nums) {
+			w.writeFloat((float)num);
+		}
+	});
+
+	measureRead(bench, "", COUNT, data, [](sbon::Reader r) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			bench::consume(r.getFloat());
+		}
+	});
+}
+
+BENCHMARK("Reader::getDouble") {
+	auto nums = gen::doubles(COUNT);
+	auto data = encode([&](sbon::Writer w) {
+		for (auto num: nums) {
+			w.writeDouble(num);
+		}
+	});
+
+	measureRead(bench, "", COUNT, data, [](sbon::Reader r) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			bench::consume(r.getDouble());
+		}
+	});
+}
+
+BENCHMARK("Reader::getString") {
+	for (std::size_t len: {8, 64, 1024}) {
+		auto strs = gen::strings(COUNT, len);
+		auto data = encode([&](sbon::Writer w) {
+			for (auto &str: strs) {
+				w.writeString(str);
+			}
+		});
+
+		std::string variant = std::to_string(len) + " chars";
+		measureRead(bench, variant.c_str(), COUNT, data, [](sbon::Reader r) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				bench::consume(r.getString());
+			}
+		});
+
+		std::string reusedVariant = variant + ", reused buffer";
+		std::string str;
+		measureRead(bench, reusedVariant.c_str(), COUNT, data, [&](sbon::Reader r) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				r.getString(str);
+				bench::consume(str);
+			}
+		});
+
+		std::string arenaVariant = variant + ", pmr arena";
+		std::pmr::monotonic_buffer_resource mr(data.size() * 2);
+		measureRead(bench, arenaVariant.c_str(), COUNT, data, [&](sbon::Reader r) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				bench::consume(r.getString(&mr));
+			}
+			mr.release();
+		});
+	}
+}
+
+BENCHMARK("Reader::getBinary") {
+	for (std::size_t len: {8, 64, 1024}) {
+		auto strs = gen::strings(COUNT, len);
+		auto data = encode([&](sbon::Writer w) {
+			for (auto &str: strs) {
+				w.writeBinary(str.data(), str.size());
+			}
+		});
+
+		std::string variant = std::to_string(len) + " bytes";
+		measureRead(bench, variant.c_str(), COUNT, data, [](sbon::Reader r) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				bench::consume(r.getBinary());
+			}
+		});
+
+		variant += ", reused buffer";
+		std::vector<unsigned char> bin;
+		measureRead(bench, variant.c_str(), COUNT, data, [&](sbon::Reader r) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				r.getBinary(bin);
+				bench::consume(bin);
+			}
+		});
+	}
+}
+
+BENCHMARK("Reader::skip") {
+	struct Variant {
+		const char *name;
+		std::string data;
+	};
+
+	auto nums = gen::ints(COUNT, 0xfffffff, true);
+	auto strs = gen::strings(COUNT, 64);
+	Variant variants[] = {
+		{"ints", encode([&](sbon::Writer w) {
+			for (auto num: nums) {
+				w.writeInt(num);
+			}
+		})},
+		{"doubles", encode([&](sbon::Writer w) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				w.writeDouble(i);
+			}
+		})},
+		{"64 char strings", encode([&](sbon::Writer w) {
+			for (auto &str: strs) {
+				w.writeString(str);
+			}
+		})},
+		{"64 byte binaries", encode([&](sbon::Writer w) {
+			for (auto &str: strs) {
+				w.writeBinary(str.data(), str.size());
+			}
+		})},
+	};
+
+	for (auto &variant: variants) {
+		measureRead(bench, variant.name, COUNT, variant.data, [](sbon::Reader r) {
+			for (std::size_t i = 0; i < COUNT; ++i) {
+				r.skip();
+			}
+		});
+	}
+}
+
+BENCHMARK("Reader sources") {
+	auto data = gen::nested(4, 8);
+	std::size_t values = 8 * 8 * 8 * 8;
+
+	bench::MemIStream is(data);
+	bench.measure("istream", values, data.size(), [&] {
+		is.rewind();
+		sbon::Reader(&is).skip();
+	});
+
+	bench.measure("buffer", values, data.size(), [&] {
+		sbon::BufferSource src(data);
+		sbon::BufferReader(&src).skip();
+	});
+
+	std::FILE *f = std::tmpfile();
+	std::fwrite(data.data(), 1, data.size(), f);
+	bench.measure("FILE *", values, data.size(), [&] {
+		std::rewind(f);
+		sbon::FileSource src(f);
+		sbon::FileReader(&src).skip();
+	});
+	std::fclose(f);
+}
@@ -0,0 +1,204 @@
+#include <sbon.h>
+#include <sbon-io.h>
+#include <sbon-literal.h>
+
+#include "bench.h"
+#include "gen.h"
+
+static constexpr std::size_t COUNT = 1000;
+
+template<typename Func>
+static void measureWrite(
+		bench::Bench &bench, const char *variant, std::size_t count, Func func) {
+	bench::MemOStream os;
+
+	// Find out how many bytes one batch produces
+	func(sbon::Writer(&os));
+	std::size_t bytes = os.str().size();
+	os.reserve(bytes);
+
+	bench.measure(variant, count, bytes, [&] {
+		os.rewind();
+		func(sbon::Writer(&os));
+	});
+}
+
+BENCHMARK("Writer::writeBool") {
+	measureWrite(bench, "", COUNT, [](sbon::Writer w) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			w.writeBool(i & 1);
+		}
+	});
+}
+
+BENCHMARK("Writer::writeNull") {
+	measureWrite(bench, "", COUNT, [](sbon::Writer w) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			w.writeNull();
+		}
+	});
+}
+
+BENCHMARK("Writer::writeInt") {
+	struct Variant {
+		const char *name;
+		std::vector<std::int64_t> nums;
+	};
+
+	Variant variants[] = {
+		{"immediate", gen::ints(COUNT, 9)},
+		{"1 byte", gen::ints(COUNT, 127, true)},
+		{"4 bytes", gen::ints(COUNT, 0xfffffff, true)},
+		{"9 bytes", gen::ints(COUNT, 0x7fffffffffffffffll, true)},
+	};
+
+	for (auto &variant: variants) {
+		measureWrite(bench, variant.name, COUNT, [&](sbon::Writer w) {
+			for (auto num: variant.nums) {
+				w.writeInt(num);
+			}
+		});
+	}
+}
+
+BENCHMARK("Writer::writeUInt") {
+	auto nums = gen::ints(COUNT, 0xfffffff);
+	measureWrite(bench, "4 bytes", COUNT, [&](sbon::Writer w) {
+		for (auto num: nums) {
+			w.writeUInt((std::uint64_t)num);
+		}
+	});
+}
+
+BENCHMARK("Writer::writeFloat") {
+	auto nums = gen::doubles(COUNT);
+	measureWrite(bench, "", COUNT, [&](sbon::Writer w) {
+		for (auto num: nums) {
+			w.writeFloat((float)num);
+		}
+	});
+}
+
+BENCHMARK("Writer::writeDouble") {
+	auto nums = gen::doubles(COUNT);
+	measureWrite(bench, "", COUNT, [&](sbon::Writer w) {
+		for (auto num: nums) {
+			w.writeDouble(num);
+		}
+	});
+}
+
+BENCHMARK("Writer::writeString") {
+	for (std::size_t len: {8, 64, 1024}) {
+		auto strs = gen::strings(COUNT, len);
+		std::string variant = std::to_string(len) + " chars";
+		measureWrite(bench, variant.c_str(), COUNT, [&](sbon::Writer w) {
+			for (auto &str: strs) {
+				w.writeString(str);
+			}
+		});
+	}
+}
+
+BENCHMARK("Writer::writeBinary") {
+	for (std::size_t len: {8, 64, 1024}) {
+		auto strs = gen::strings(COUNT, len);
+		std::string variant = std::to_string(len) + " bytes";
+		measureWrite(bench, variant.c_str(), COUNT, [&](sbon::Writer w) {
+			for (auto &str: strs) {
+				w.writeBinary(str.data(), str.size());
+			}
+		});
+	}
+}
+
+BENCHMARK("Writer::writeArray") {
+	measureWrite(bench, "empty", COUNT, [](sbon::Writer w) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			w.writeArray([](sbon::Writer) {});
+		}
+	});
+}
+
+BENCHMARK("Writer::writeObject") {
+	for (std::size_t count: {4, 16, 64}) {
+		auto keys = gen::keys(count);
+		std::string variant = std::to_string(count) + " keys";
+		measureWrite(bench, variant.c_str(), 1, [&](sbon::Writer w) {
+			w.writeObject([&](sbon::ObjectWriter w) {
+				for (auto &key: keys) {
+					w.key(key.c_str()).writeUInt(10);
+				}
+			});
+		});
+	}
+}
+
+BENCHMARK("Writer::writeEncoded") {
+	static constexpr auto HEADER = sbon::literal<[](sbon::LiteralWriter w) {
+		w.writeObject([](sbon::LiteralObjectWriter w) {
+			w.key("protocol").writeString("sbon-rpc");
+			w.key("version").writeUInt(3);
+			w.key("compression").writeNull();
+			w.key("capabilities").writeArray([](sbon::LiteralWriter w) {
+				w.writeString("stream");
+				w.writeString("batch");
+			});
+		});
+	}>();
+
+	measureWrite(bench, "encoded at run time", COUNT, [](sbon::Writer w) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			w.writeObject([](sbon::ObjectWriter w) {
+				w.key("protocol").writeString("sbon-rpc");
+				w.key("version").writeUInt(3);
+				w.key("compression").writeNull();
+				w.key("capabilities").writeArray([](sbon::Writer w) {
+					w.writeString("stream");
+					w.writeString("batch");
+				});
+			});
+		}
+	});
+
+	measureWrite(bench, "literal", COUNT, [](sbon::Writer w) {
+		for (std::size_t i = 0; i < COUNT; ++i) {
+			w.writeEncoded(HEADER);
+		}
+	});
+}
+
+// Encoding a message into its own string, as for an RPC frame
+BENCHMARK("encodeExact") {
+	auto keys = gen::keys(16);
+	auto message = [&](auto w) {
+		w.writeObject([&](auto w) {
+			for (std::size_t i = 0; i < keys.size(); ++i) {
+				w.key(keys[i].c_str()).writeString(keys[i]);
+			}
+			w.key("ids").writeArray([](auto w) {
+				for (std::uint64_t i = 0; i < 64; ++i) {
+					w.writeUInt(i * 1000);
+				}
+			});
+		});
+	};
+	std::size_t bytes = (std::size_t)sbon::encodedSize(message);
+
+	bench.measure("stringstream", 1, bytes, [&] {
+		std::stringstream ss;
+		message(sbon::Writer(&ss));
+		bench::consume(ss.str());
+	});
+
+	bench.measure("string sink", 1, bytes, [&] {
+		std::string out;
+		sbon::StringSink sink(&out);
+		message(sbon::StringWriter(&sink));
+		bench::consume(out);
+	});
+
+	bench.measure("encodeExact", 1, bytes, [&] {
+		bench::consume(sbon::encodeExact(message));
+	});
+}
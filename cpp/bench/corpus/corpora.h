@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "gen.h"
+#include "value.h"
+
+// Representative documents for the end-to-end benchmarks.
+namespace corpora {
+
+struct Corpus {
+	const char *name;
+	Value doc;
+};
+
+// A page of user records, like a typical REST API response.
+inline Value apiResponse(std::size_t count) {
+	gen::Rng rng(1);
+	Value root = Value::object();
+	root.set("page", Value::integer(3));
+	root.set("per_page", Value::integer((std::int64_t)count));
+	root.set("total", Value::integer(48213));
+
+	Value &users = root.set("users", Value::array());
+	for (std::size_t i = 0; i < count; ++i) {
+		Value &user = users.add(Value::object());
+		user.set("id", Value::integer(100000 + (std::int64_t)rng.below(900000)));
+		user.set("name", Value::string(gen::word(rng, 6) + " " + gen::word(rng, 9)));
+		user.set("email", Value::string(gen::word(rng, 8) + "@example.com"));
+		user.set("active", Value::boolean(rng.below(4) != 0));
+		user.set("score", Value::number(rng.unit() * 100));
+
+		Value &tags = user.set("tags", Value::array());
+		for (std::uint64_t t = rng.below(4); t > 0; --t) {
+			tags.add(Value::string(gen::word(rng, 5)));
+		}
+
+		Value &address = user.set("address", Value::object());
+		address.set("street", Value::string(gen::word(rng, 10) + " street"));
+		address.set("city", Value::string(gen::word(rng, 7)));
+		address.set("zip", Value::string(std::to_string(10000 + rng.below(90000))));
+		user.set("manager", rng.below(3) == 0 ?
+			Value() : Value::integer((std::int64_t)rng.below(1000)));
+	}
+
+	return root;
+}
+
+// Sensor readings with timestamps, small integers and doubles.
+inline Value telemetry(std::size_t count) {
+	gen::Rng rng(2);
+	Value root = Value::array();
+	std::int64_t ts = 1700000000000;
+	for (std::size_t i = 0; i < count; ++i) {
+		ts += (std::int64_t)rng.below(1000);
+		Value &sample = root.add(Value::object());
+		sample.set("ts", Value::integer(ts));
+		sample.set("device", Value::string("sensor-" + std::to_string(rng.below(64))));
+		sample.set("seq", Value::integer((std::int64_t)i));
+		sample.set("temp", Value::number(15 + rng.unit() * 10));
+		sample.set("humidity", Value::number(rng.unit()));
+		sample.set("battery", Value::integer((std::int64_t)rng.below(101)));
+		sample.set("ok", Value::boolean(rng.below(100) != 0));
+	}
+
+	return root;
+}
+
+// Large arrays of plain numbers.
+inline Value numeric(std::size_t count) {
+	gen::Rng rng(3);
+	Value root = Value::object();
+	Value &ints = root.set("ints", Value::array());
+	Value &doubles = root.set("doubles", Value::array());
+	for (std::size_t i = 0; i < count; ++i) {
+		ints.add(Value::integer((std::int64_t)rng.below(2000000) - 1000000));
+		doubles.add(Value::number(rng.unit() * 2e6 - 1e6));
+	}
+
+	return root;
+}
+
+// Log lines, where most of the bytes are in strings.
+inline Value logs(std::size_t count) {
+	static const char *levels[] = {"debug", "info", "info", "info", "warn", "error"};
+	static const char *components[] = {"http", "db", "auth", "scheduler", "cache"};
+
+	gen::Rng rng(4);
+	Value root = Value::array();
+	for (std::size_t i = 0; i < count; ++i) {
+		Value &line = root.add(Value::object());
+		line.set("time", Value::string("2024-03-14T15:09:26." + std::to_string(i % 1000) + "Z"));
+		line.set("level", Value::string(levels[rng.below(6)]));
+		line.set("component", Value::string(components[rng.below(5)]));
+
+		std::string msg;
+		for (std::uint64_t w = 8 + rng.below(16); w > 0; --w) {
+			msg += gen::word(rng, 2 + rng.below(8));
+			msg += ' ';
+		}
+		if (rng.below(10) == 0) {
+			msg += "\"quoted\"\tpath=C:\\tmp\\x\n";
+		}
+		line.set("msg", Value::string(msg));
+	}
+
+	return root;
+}
+
+inline std::vector<Corpus> all() {
+	return {
+		{"api-response", apiResponse(2000)},
+		{"telemetry", telemetry(20000)},
+		{"numeric-arrays", numeric(100000)},
+		{"string-logs", logs(10000)},
+	};
+}
+
+}
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "value.h"
+
+// A small but complete JSON encoder and decoder, using std::to_chars and
+// std::from_chars for round-tripping numbers.
+class JsonFormat {
+public:
+	static constexpr const char *name = "json";
+
+	std::string_view encode(const Value &val) {
+		out_.clear();
+		write(val);
+		return out_;
+	}
+
+	Value decode(std::string_view data) {
+		cur_ = data.data();
+		end_ = data.data() + data.size();
+		Value val = read();
+		skipSpace();
+		if (cur_ != end_) {
+			throw std::runtime_error("JSON: Trailing garbage");
+		}
+		return val;
+	}
+
+private:
+	void writeString(std::string_view str) {
+		static const char hex[] = "0123456789abcdef";
+
+		out_ += '"';
+		for (char ch: str) {
+			if (ch == '"') {
+				out_ += "\\\"";
+			} else if (ch == '\\') {
+				out_ += "\\\\";
+			} else if (ch == '\n') {
+				out_ += "\\n";
+			} else if (ch == '\r') {
+				out_ += "\\r";
+			} else if (ch == '\t') {
+				out_ += "\\t";
+			} else if ((unsigned char)ch < 32) {
+				out_ += "\\u00";
+				out_ += hex[(unsigned char)ch >> 4];
+				out_ += hex[(unsigned char)ch & 0x0f];
+			} else {
+				out_ += ch;
+			}
+		}
+		out_ += '"';
+	}
+
+	void write(const Value &val) {
+		char buf[32];
+
+		switch (val.kind) {
+		case Value::Kind::NIL:
+			out_ += "null";
+			break;
+
+		case Value::Kind::BOOL:
+			out_ += val.b ? "true" : "false";
+			break;
+
+		case Value::Kind::INT: {
+			auto res = std::to_chars(buf, buf + sizeof(buf), val.i);
+			out_.append(buf, res.ptr);
+			break;
+		}
+
+		case Value::Kind::DOUBLE: {
+			auto res = std::to_chars(buf, buf + sizeof(buf), val.d);
+			std::string_view sv(buf, res.ptr - buf);
+			out_ += sv;
+
+			// Keep integral doubles distinct from integers
+			if (sv.find_first_of(".e") == sv.npos) {
+				out_ += ".0";
+			}
+			break;
+		}
+
+		case Value::Kind::STRING:
+			writeString(val.str);
+			break;
+
+		case Value::Kind::ARRAY:
+			out_ += '[';
+			for (size_t i = 0; i < val.arr.size(); ++i) {
+				if (i != 0) {
+					out_ += ',';
+				}
+				write(val.arr[i]);
+			}
+			out_ += ']';
+			break;
+
+		case Value::Kind::OBJECT:
+			out_ += '{';
+			for (size_t i = 0; i < val.obj.size(); ++i) {
+				if (i != 0) {
+					out_ += ',';
+				}
+				writeString(val.obj[i].first);
+				out_ += ':';
+				write(val.obj[i].second);
+			}
+			out_ += '}';
+			break;
+		}
+	}
+
+	void skipSpace() {
+		while (cur_ != end_ && (
+				*cur_ == ' ' || *cur_ == '\n' || *cur_ == '\r' || *cur_ == '\t')) {
+			cur_ += 1;
+		}
+	}
+
+	char peek() {
+		skipSpace();
+		if (cur_ == end_) {
+			throw std::runtime_error("JSON: Unexpected EOF");
+		}
+		return *cur_;
+	}
+
+	void expect(std::string_view lit) {
+		if ((size_t)(end_ - cur_) < lit.size() ||
+				std::string_view(cur_, lit.size()) != lit) {
+			throw std::runtime_error("JSON: Unexpected token");
+		}
+		cur_ += lit.size();
+	}
+
+	unsigned readHex4() {
+		if (end_ - cur_ < 4) {
+			throw std::runtime_error("JSON: Unexpected EOF");
+		}
+
+		unsigned num = 0;
+		auto res = std::from_chars(cur_, cur_ + 4, num, 16);
+		if (res.ptr != cur_ + 4) {
+			throw std::runtime_error("JSON: Bad unicode escape");
+		}
+		cur_ += 4;
+		return num;
+	}
+
+	void appendUtf8(std::string &str, unsigned cp) {
+		if (cp < 0x80) {
+			str += (char)cp;
+		} else if (cp < 0x800) {
+			str += (char)(0xc0 | (cp >> 6));
+			str += (char)(0x80 | (cp & 0x3f));
+		} else if (cp < 0x10000) {
+			str += (char)(0xe0 | (cp >> 12));
+			str += (char)(0x80 | ((cp >> 6) & 0x3f));
+			str += (char)(0x80 | (cp & 0x3f));
+		} else {
+			str += (char)(0xf0 | (cp >> 18));
+			str += (char)(0x80 | ((cp >> 12) & 0x3f));
+			str += (char)(0x80 | ((cp >> 6) & 0x3f));
+			str += (char)(0x80 | (cp & 0x3f));
+		}
+	}
+
+	std::string readString() {
+		expect("\"");
+
+		std::string str;
+		while (true) {
+			if (cur_ == end_) {
+				throw std::runtime_error("JSON: Unexpected EOF");
+			}
+
+			char ch = *cur_++;
+			if (ch == '"') {
+				return str;
+			} else if (ch != '\\') {
+				str += ch;
+				continue;
+			}
+
+			if (cur_ == end_) {
+				throw std::runtime_error("JSON: Unexpected EOF");
+			}
+
+			ch = *cur_++;
+			switch (ch) {
+			case 'b': str += '\b'; break;
+			case 'f': str += '\f'; break;
+			case 'n': str += '\n'; break;
+			case 'r': str += '\r'; break;
+			case 't': str += '\t'; break;
+			case 'u': {
+				unsigned cp = readHex4();
+				if (cp >= 0xd800 && cp <= 0xdbff) {
+					expect("\\u");
+					unsigned lo = readHex4();
+					cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+				}
+				appendUtf8(str, cp);
+				break;
+			}
+			default: str += ch; break;
+			}
+		}
+	}
+
+	Value readNumber() {
+		const char *start = cur_;
+		bool isDouble = false;
+		while (cur_ != end_) {
+			char ch = *cur_;
+			if (ch == '.' || ch == 'e' || ch == 'E') {
+				isDouble = true;
+			} else if (!(ch == '-' || ch == '+' || (ch >= '0' && ch <= '9'))) {
+				break;
+			}
+			cur_ += 1;
+		}
+
+		if (isDouble) {
+			double d = 0;
+			auto res = std::from_chars(start, cur_, d);
+			if (res.ptr != cur_) {
+				throw std::runtime_error("JSON: Bad number");
+			}
+			return Value::number(d);
+		} else {
+			std::int64_t i = 0;
+			auto res = std::from_chars(start, cur_, i);
+			if (res.ptr != cur_) {
+				throw std::runtime_error("JSON: Bad number");
+			}
+			return Value::integer(i);
+		}
+	}
+
+	Value read() {
+		char ch = peek();
+		if (ch == 'n') {
+			expect("null");
+			return Value();
+		} else if (ch == 't') {
+			expect("true");
+			return Value::boolean(true);
+		} else if (ch == 'f') {
+			expect("false");
+			return Value::boolean(false);
+		} else if (ch == '"') {
+			return Value::string(readString());
+		} else if (ch == '[') {
+			cur_ += 1;
+			Value val = Value::array();
+			if (peek() == ']') {
+				cur_ += 1;
+				return val;
+			}
+
+			while (true) {
+				val.add(read());
+				if (peek() == ',') {
+					cur_ += 1;
+				} else {
+					expect("]");
+					return val;
+				}
+			}
+		} else if (ch == '{') {
+			cur_ += 1;
+			Value val = Value::object();
+			if (peek() == '}') {
+				cur_ += 1;
+				return val;
+			}
+
+			while (true) {
+				peek();
+				std::string key = readString();
+				peek();
+				expect(":");
+				val.set(std::move(key), read());
+				if (peek() == ',') {
+					cur_ += 1;
+				} else {
+					expect("}");
+					return val;
+				}
+			}
+		} else {
+			return readNumber();
+		}
+	}
+
+	std::string out_;
+	const char *cur_ = nullptr;
+	const char *end_ = nullptr;
+};
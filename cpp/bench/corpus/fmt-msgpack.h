@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "value.h"
+
+// A small MessagePack encoder and decoder, always picking the most compact
+// representation like the reference implementations do.
+class MsgpackFormat {
+public:
+	static constexpr const char *name = "msgpack";
+
+	std::string_view encode(const Value &val) {
+		out_.clear();
+		write(val);
+		return out_;
+	}
+
+	Value decode(std::string_view data) {
+		cur_ = (const unsigned char *)data.data();
+		end_ = cur_ + data.size();
+		Value val = read();
+		if (cur_ != end_) {
+			throw std::runtime_error("MessagePack: Trailing garbage");
+		}
+		return val;
+	}
+
+private:
+	void put(unsigned char ch) {
+		out_ += (char)ch;
+	}
+
+	void putBE(std::uint64_t num, int bytes) {
+		char buf[8];
+		for (int i = 0; i < bytes; ++i) {
+			buf[i] = (char)(num >> ((bytes - i - 1) * 8));
+		}
+		out_.append(buf, bytes);
+	}
+
+	void writeStrHeader(std::size_t size) {
+		if (size <= 31) {
+			put(0xa0 | (unsigned char)size);
+		} else if (size <= 0xff) {
+			put(0xd9);
+			putBE(size, 1);
+		} else if (size <= 0xffff) {
+			put(0xda);
+			putBE(size, 2);
+		} else {
+			put(0xdb);
+			putBE(size, 4);
+		}
+	}
+
+	// Arrays and maps: 'fix' is the fixarray/fixmap tag,
+	// 'tag16' is the array 16/map 16 tag, which is followed by the 32-bit tag
+	void writeContainerHeader(std::size_t size, unsigned char fix, unsigned char tag16) {
+		if (size <= 15) {
+			put(fix | (unsigned char)size);
+		} else if (size <= 0xffff) {
+			put(tag16);
+			putBE(size, 2);
+		} else {
+			put(tag16 + 1);
+			putBE(size, 4);
+		}
+	}
+
+	void writeInt(std::int64_t i) {
+		if (i >= 0) {
+			auto u = (std::uint64_t)i;
+			if (u <= 0x7f) {
+				put((unsigned char)u);
+			} else if (u <= 0xff) {
+				put(0xcc);
+				putBE(u, 1);
+			} else if (u <= 0xffff) {
+				put(0xcd);
+				putBE(u, 2);
+			} else if (u <= 0xffffffff) {
+				put(0xce);
+				putBE(u, 4);
+			} else {
+				put(0xcf);
+				putBE(u, 8);
+			}
+		} else if (i >= -32) {
+			put((unsigned char)(std::int8_t)i);
+		} else if (i >= INT8_MIN) {
+			put(0xd0);
+			putBE((std::uint64_t)i, 1);
+		} else if (i >= INT16_MIN) {
+			put(0xd1);
+			putBE((std::uint64_t)i, 2);
+		} else if (i >= INT32_MIN) {
+			put(0xd2);
+			putBE((std::uint64_t)i, 4);
+		} else {
+			put(0xd3);
+			putBE((std::uint64_t)i, 8);
+		}
+	}
+
+	void write(const Value &val) {
+		switch (val.kind) {
+		case Value::Kind::NIL:
+			put(0xc0);
+			break;
+
+		case Value::Kind::BOOL:
+			put(val.b ? 0xc3 : 0xc2);
+			break;
+
+		case Value::Kind::INT:
+			writeInt(val.i);
+			break;
+
+		case Value::Kind::DOUBLE: {
+			std::uint64_t n;
+			std::memcpy(&n, &val.d, 8);
+			put(0xcb);
+			putBE(n, 8);
+			break;
+		}
+
+		case Value::Kind::STRING:
+			writeStrHeader(val.str.size());
+			out_ += val.str;
+			break;
+
+		case Value::Kind::ARRAY:
+			writeContainerHeader(val.arr.size(), 0x90, 0xdc);
+			for (auto &sub: val.arr) {
+				write(sub);
+			}
+			break;
+
+		case Value::Kind::OBJECT:
+			writeContainerHeader(val.obj.size(), 0x80, 0xde);
+			for (auto &[key, sub]: val.obj) {
+				writeStrHeader(key.size());
+				out_ += key;
+				write(sub);
+			}
+			break;
+		}
+	}
+
+	std::uint64_t getBE(int bytes) {
+		if (end_ - cur_ < bytes) {
+			throw std::runtime_error("MessagePack: Unexpected EOF");
+		}
+
+		std::uint64_t num = 0;
+		for (int i = 0; i < bytes; ++i) {
+			num = (num << 8) | *cur_++;
+		}
+		return num;
+	}
+
+	std::string readStr(std::size_t size) {
+		if ((std::size_t)(end_ - cur_) < size) {
+			throw std::runtime_error("MessagePack: Unexpected EOF");
+		}
+
+		std::string str((const char *)cur_, size);
+		cur_ += size;
+		return str;
+	}
+
+	std::string readKey() {
+		unsigned char ch = (unsigned char)getBE(1);
+		if ((ch & 0xe0) == 0xa0) {
+			return readStr(ch & 0x1f);
+		} else if (ch == 0xd9) {
+			return readStr(getBE(1));
+		} else if (ch == 0xda) {
+			return readStr(getBE(2));
+		} else if (ch == 0xdb) {
+			return readStr(getBE(4));
+		} else {
+			throw std::runtime_error("MessagePack: Expected string key");
+		}
+	}
+
+	Value readArray(std::size_t size) {
+		Value val = Value::array();
+		val.arr.reserve(size);
+		for (std::size_t i = 0; i < size; ++i) {
+			val.add(read());
+		}
+		return val;
+	}
+
+	Value readMap(std::size_t size) {
+		Value val = Value::object();
+		val.obj.reserve(size);
+		for (std::size_t i = 0; i < size; ++i) {
+			std::string key = readKey();
+			val.set(std::move(key), read());
+		}
+		return val;
+	}
+
+	Value read() {
+		unsigned char ch = (unsigned char)getBE(1);
+		if (ch <= 0x7f) {
+			return Value::integer(ch);
+		} else if (ch >= 0xe0) {
+			return Value::integer((std::int8_t)ch);
+		} else if ((ch & 0xe0) == 0xa0) {
+			return Value::string(readStr(ch & 0x1f));
+		} else if ((ch & 0xf0) == 0x90) {
+			return readArray(ch & 0x0f);
+		} else if ((ch & 0xf0) == 0x80) {
+			return readMap(ch & 0x0f);
+		}
+
+		switch (ch) {
+		case 0xc0: return Value();
+		case 0xc2: return Value::boolean(false);
+		case 0xc3: return Value::boolean(true);
+		case 0xcc: return Value::integer((std::int64_t)getBE(1));
+		case 0xcd: return Value::integer((std::int64_t)getBE(2));
+		case 0xce: return Value::integer((std::int64_t)getBE(4));
+		case 0xcf: return Value::integer((std::int64_t)getBE(8));
+		case 0xd0: return Value::integer((std::int8_t)getBE(1));
+		case 0xd1: return Value::integer((std::int16_t)getBE(2));
+		case 0xd2: return Value::integer((std::int32_t)getBE(4));
+		case 0xd3: return Value::integer((std::int64_t)getBE(8));
+		case 0xca: {
+			auto n = (std::uint32_t)getBE(4);
+			float f;
+			std::memcpy(&f, &n, 4);
+			return Value::number(f);
+		}
+		case 0xcb: {
+			std::uint64_t n = getBE(8);
+			double d;
+			std::memcpy(&d, &n, 8);
+			return Value::number(d);
+		}
+		case 0xd9: return Value::string(readStr(getBE(1)));
+		case 0xda: return Value::string(readStr(getBE(2)));
+		case 0xdb: return Value::string(readStr(getBE(4)));
+		case 0xdc: return readArray(getBE(2));
+		case 0xdd: return readArray(getBE(4));
+		case 0xde: return readMap(getBE(2));
+		case 0xdf: return readMap(getBE(4));
+		default:
+			throw std::runtime_error("MessagePack: Unsupported type");
+		}
+	}
+
+	std::string out_;
+	const unsigned char *cur_ = nullptr;
+	const unsigned char *end_ = nullptr;
+};
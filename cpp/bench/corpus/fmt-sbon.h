@@ -0,0 +1,110 @@
+#pragma once
+
+#include <sbon.h>
+
+#include <string_view>
+
+#include "bench.h"
+#include "value.h"
+
+class SbonFormat {
+public:
+	static constexpr const char *name = "sbon";
+
+	std::string_view encode(const Value &val) {
+		os_.rewind();
+		write(sbon::Writer(&os_), val);
+		return os_.str();
+	}
+
+	Value decode(std::string_view data) {
+		is_.reset(data);
+		return read(sbon::Reader(&is_));
+	}
+
+private:
+	static void write(sbon::Writer w, const Value &val) {
+		switch (val.kind) {
+		case Value::Kind::NIL:
+			w.writeNull();
+			break;
+
+		case Value::Kind::BOOL:
+			w.writeBool(val.b);
+			break;
+
+		case Value::Kind::INT:
+			w.writeInt(val.i);
+			break;
+
+		case Value::Kind::DOUBLE:
+			w.writeDouble(val.d);
+			break;
+
+		case Value::Kind::STRING:
+			w.writeString(val.str);
+			break;
+
+		case Value::Kind::ARRAY:
+			w.writeArray([&](sbon::Writer w) {
+				for (auto &sub: val.arr) {
+					write(w, sub);
+				}
+			});
+			break;
+
+		case Value::Kind::OBJECT:
+			w.writeObject([&](sbon::ObjectWriter w) {
+				for (auto &[key, sub]: val.obj) {
+					write(w.key(key.c_str()), sub);
+				}
+			});
+			break;
+		}
+	}
+
+	static Value read(sbon::Reader r) {
+		switch (r.getType()) {
+		case sbon::Type::BOOL:
+			return Value::boolean(r.getBool());
+
+		case sbon::Type::NIL:
+			r.getNil();
+			return Value();
+
+		case sbon::Type::STRING:
+			return Value::string(r.getString());
+
+		case sbon::Type::FLOAT:
+		case sbon::Type::DOUBLE:
+			return Value::number(r.getDouble());
+
+		case sbon::Type::INT:
+		case sbon::Type::UINT:
+			return Value::integer(r.getInt());
+
+		case sbon::Type::ARRAY: {
+			Value val = Value::array();
+			r.readArray([&](sbon::Reader r) {
+				val.add(read(r));
+			});
+			return val;
+		}
+
+		case sbon::Type::OBJECT: {
+			Value val = Value::object();
+			r.readObject([&](std::string &key, sbon::Reader r) {
+				val.set(key, read(r));
+			});
+			return val;
+		}
+
+		default:
+			r.skip();
+			return Value();
+		}
+	}
+
+	bench::MemOStream os_;
+	bench::MemIStream is_;
+};
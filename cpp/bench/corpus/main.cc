@@ -0,0 +1,104 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "corpora.h"
+#include "fmt-json.h"
+#include "fmt-msgpack.h"
+#include "fmt-sbon.h"
+
+struct Result {
+	std::string corpus;
+	const char *format;
+	std::size_t size;
+	double encodeSeconds;
+	double decodeSeconds;
+	double encodeAllocs;
+	double decodeAllocs;
+};
+
+template<typename Format>
+static Result run(const corpora::Corpus &corpus) {
+	Format fmt;
+	std::string encoded(fmt.encode(corpus.doc));
+
+	if (!(fmt.decode(encoded) == corpus.doc)) {
+		throw std::runtime_error(
+			std::string(Format::name) + " doesn't round-trip " + corpus.name);
+	}
+
+	auto enc = bench::run([&] {
+		bench::consume(fmt.encode(corpus.doc).size());
+	}, 0.5);
+
+	auto dec = bench::run([&] {
+		bench::consume(fmt.decode(encoded).kind);
+	}, 0.5);
+
+	return {
+		corpus.name, Format::name, encoded.size(),
+		enc.seconds / (double)enc.iters, dec.seconds / (double)dec.iters,
+		(double)enc.allocs / (double)enc.iters, (double)dec.allocs / (double)dec.iters,
+	};
+}
+
+static double mibPerSec(std::size_t size, double seconds) {
+	return (double)size / seconds / (1024.0 * 1024.0);
+}
+
+static void writeReport(const std::vector<Result> &results, std::ostream &os) {
+	os << "{\n  \"results\": [\n";
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		auto &r = results[i];
+		char buf[512];
+		std::snprintf(buf, sizeof(buf),
+			"    {\"corpus\": \"%s\", \"format\": \"%s\", \"size\": %zu, "
+			"\"encode_ns\": %.0f, \"decode_ns\": %.0f, "
+			"\"encode_mib_s\": %.2f, \"decode_mib_s\": %.2f, "
+			"\"encode_allocs\": %.1f, \"decode_allocs\": %.1f}",
+			r.corpus.c_str(), r.format, r.size,
+			r.encodeSeconds * 1e9, r.decodeSeconds * 1e9,
+			mibPerSec(r.size, r.encodeSeconds), mibPerSec(r.size, r.decodeSeconds),
+			r.encodeAllocs, r.decodeAllocs);
+		os << buf << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	os << "  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+	if (argc > 2) {
+		std::cerr << "Usage: " << argv[0] << " [report.json]\n";
+		return 1;
+	}
+
+	std::vector<Result> results;
+	for (auto &corpus: corpora::all()) {
+		std::cout << "\nCorpus " << corpus.name << "...\n";
+		for (auto result: {
+				run<SbonFormat>(corpus),
+				run<JsonFormat>(corpus),
+				run<MsgpackFormat>(corpus)}) {
+			std::printf(
+				"  %-8s %10zu bytes, encode %8.1f MiB/s (%8.3f ms), decode %8.1f MiB/s (%8.3f ms)\n",
+				result.format, result.size,
+				mibPerSec(result.size, result.encodeSeconds), result.encodeSeconds * 1e3,
+				mibPerSec(result.size, result.decodeSeconds), result.decodeSeconds * 1e3);
+			std::fflush(stdout);
+			results.push_back(result);
+		}
+	}
+
+	if (argc == 2) {
+		std::ofstream os(argv[1]);
+		if (!os) {
+			std::cerr << "Couldn't open " << argv[1] << '\n';
+			return 1;
+		}
+
+		writeReport(results, os);
+		std::cout << "\nWrote report to " << argv[1] << '\n';
+	}
+}
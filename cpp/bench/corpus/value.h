@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A format-neutral document tree, so that every format encodes and decodes
+// exactly the same data.
+struct Value {
+	enum class Kind {
+		NIL,
+		BOOL,
+		INT,
+		DOUBLE,
+		STRING,
+		ARRAY,
+		OBJECT,
+	};
+
+	Value(): kind(Kind::NIL) {}
+
+	static Value boolean(bool b) {
+		Value v;
+		v.kind = Kind::BOOL;
+		v.b = b;
+		return v;
+	}
+
+	static Value integer(std::int64_t i) {
+		Value v;
+		v.kind = Kind::INT;
+		v.i = i;
+		return v;
+	}
+
+	static Value number(double d) {
+		Value v;
+		v.kind = Kind::DOUBLE;
+		v.d = d;
+		return v;
+	}
+
+	static Value string(std::string s) {
+		Value v;
+		v.kind = Kind::STRING;
+		v.str = std::move(s);
+		return v;
+	}
+
+	static Value array() {
+		Value v;
+		v.kind = Kind::ARRAY;
+		return v;
+	}
+
+	static Value object() {
+		Value v;
+		v.kind = Kind::OBJECT;
+		return v;
+	}
+
+	Value &add(Value val) {
+		arr.push_back(std::move(val));
+		return arr.back();
+	}
+
+	Value &set(std::string key, Value val) {
+		obj.emplace_back(std::move(key), std::move(val));
+		return obj.back().second;
+	}
+
+	bool operator==(const Value &other) const = default;
+
+	Kind kind;
+	bool b = false;
+	std::int64_t i = 0;
+	double d = 0;
+	std::string str;
+	std::vector<Value> arr;
+	std::vector<std::pair<std::string, Value>> obj;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <sbon.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Deterministic synthetic data generators for the benchmarks.
+namespace gen {
+
+class Rng {
+public:
+	explicit Rng(std::uint64_t seed = 0x9e3779b97f4a7c15ull): state_(seed) {}
+
+	std::uint64_t next() {
+		state_ ^= state_ << 13;
+		state_ ^= state_ >> 7;
+		state_ ^= state_ << 17;
+		return state_;
+	}
+
+	std::uint64_t below(std::uint64_t max) {
+		return next() % max;
+	}
+
+	double unit() {
+		return (double)(next() >> 11) / (double)(1ull << 53);
+	}
+
+private:
+	std::uint64_t state_;
+};
+
+inline std::string word(Rng &rng, std::size_t len) {
+	std::string str;
+	str.reserve(len);
+	for (std::size_t i = 0; i < len; ++i) {
+		str += (char)('a' + rng.below(26));
+	}
+	return str;
+}
+
+inline std::vector<std::int64_t> ints(std::size_t count, std::int64_t max, bool negative = false) {
+	Rng rng;
+	std::vector<std::int64_t> vec;
+	vec.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		auto num = (std::int64_t)rng.below((std::uint64_t)max + 1);
+		vec.push_back(negative && (rng.next() & 1) ? -num : num);
+	}
+	return vec;
+}
+
+inline std::vector<double> doubles(std::size_t count) {
+	Rng rng;
+	std::vector<double> vec;
+	vec.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		vec.push_back(rng.unit() * 1e6 - 5e5);
+	}
+	return vec;
+}
+
+inline std::vector<std::string> strings(std::size_t count, std::size_t len) {
+	Rng rng;
+	std::vector<std::string> vec;
+	vec.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		vec.push_back(word(rng, len));
+	}
+	return vec;
+}
+
+inline std::vector<std::string> keys(std::size_t count) {
+	std::vector<std::string> vec;
+	vec.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		vec.push_back("field_" + std::to_string(i));
+	}
+	return vec;
+}
+
+// An object with the given keys, where every value is a small integer.
+inline std::string object(const std::vector<std::string> &keys) {
+	std::stringstream ss;
+	sbon::Writer w(&ss);
+	w.writeObject([&](sbon::ObjectWriter w) {
+		for (std::size_t i = 0; i < keys.size(); ++i) {
+			w.key(keys[i].c_str()).writeUInt(i * 31);
+		}
+	});
+	return ss.str();
+}
+
+inline void nestedValue(sbon::Writer w, Rng &rng, int depth, int width) {
+	if (depth == 0) {
+		switch (rng.below(4)) {
+		case 0:
+			w.writeUInt(rng.below(1000));
+			break;
+		case 1:
+			w.writeDouble(rng.unit());
+			break;
+		case 2:
+			w.writeString(word(rng, 8));
+			break;
+		default:
+			w.writeBool(rng.next() & 1);
+			break;
+		}
+	} else if (depth % 2 == 0) {
+		w.writeArray([&](sbon::Writer w) {
+			for (int i = 0; i < width; ++i) {
+				nestedValue(w, rng, depth - 1, width);
+			}
+		});
+	} else {
+		w.writeObject([&](sbon::ObjectWriter w) {
+			for (int i = 0; i < width; ++i) {
+				std::string key = "k" + std::to_string(i);
+				nestedValue(w.key(key.c_str()), rng, depth - 1, width);
+			}
+		});
+	}
+}
+
+// Alternating levels of arrays and objects, 'width' children per container.
+inline std::string nested(int depth, int width) {
+	Rng rng;
+	std::stringstream ss;
+	nestedValue(sbon::Writer(&ss), rng, depth, width);
+	return ss.str();
+}
+
+}
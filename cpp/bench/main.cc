@@ -0,0 +1,82 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static std::vector<bench::Benchmark *> &benchmarks() {
+	static std::vector<bench::Benchmark *> vec;
+	return vec;
+}
+
+bench::Benchmark::Benchmark(
+		const char *file, int line, const char *name, void (*func)(Bench &)):
+		file(file), line(line), name(name), func(func) {
+	benchmarks().push_back(this);
+}
+
+void bench::Bench::report(
+		const char *variant, std::size_t ops, std::size_t bytes,
+		std::uint64_t iters, double seconds, std::size_t allocs) {
+	std::string name = name_;
+	if (variant && variant[0]) {
+		name += " [";
+		name += variant;
+		name += ']';
+	}
+
+	double totalOps = (double)ops * (double)iters;
+	double nsPerOp = seconds * 1e9 / totalOps;
+	double mbPerSec = (double)bytes * (double)iters / seconds / (1024.0 * 1024.0);
+	double allocsPerOp = (double)allocs / totalOps;
+
+	if (bytes == 0) {
+		std::printf(
+			"  %-52s %10.2f ns/op %10s MiB/s %8.3f allocs/op\n",
+			name.c_str(), nsPerOp, "-", allocsPerOp);
+	} else {
+		std::printf(
+			"  %-52s %10.2f ns/op %10.1f MiB/s %8.3f allocs/op\n",
+			name.c_str(), nsPerOp, mbPerSec, allocsPerOp);
+	}
+	std::fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	auto &vec = benchmarks();
+	std::sort(vec.begin(), vec.end(), [](auto a, auto b) {
+		int cmp = std::strcmp(a->file, b->file);
+		if (cmp != 0) {
+			return cmp < 0;
+		}
+		return a->line < b->line;
+	});
+
+	const char *prevFile = nullptr;
+	for (auto benchmark: vec) {
+		if (argc > 1) {
+			bool selected = false;
+			for (int i = 1; i < argc; ++i) {
+				if (std::strstr(benchmark->name, argv[i])) {
+					selected = true;
+					break;
+				}
+			}
+
+			if (!selected) {
+				continue;
+			}
+		}
+
+		if (benchmark->file != prevFile) {
+			std::cout << '\n';
+			std::cout << "Running " << benchmark->file << "...\n";
+			prevFile = benchmark->file;
+		}
+
+		bench::Bench b(benchmark->name);
+		benchmark->func(b);
+	}
+}
@@ -0,0 +1,122 @@
+#include <sbon-agg.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+static void usage(const char *argv0) {
+	std::cout << "Usage: " << argv0 << " [-j threads] [-H lo:hi:bins] -p path [-p path...] [file...]\n";
+	std::cout << "  Aggregates the numbers at each path across the records in the files\n";
+	std::cout << "  (or stdin), which are streams of concatenated SBON values.\n";
+	std::cout << "  -p: A dot-separated path, like 'response.latency'\n";
+	std::cout << "  -H: Add a histogram to the paths which follow\n";
+	std::cout << "  -j: Number of threads to read files on (default: one per CPU)\n";
+}
+
+static std::optional<sbon::HistogramSpec> parseHistogram(std::string_view arg) {
+	std::string str(arg);
+	double lo, hi;
+	unsigned long bins;
+	char end;
+	if (std::sscanf(str.c_str(), "%lf:%lf:%lu%c", &lo, &hi, &bins, &end) != 3) {
+		return std::nullopt;
+	}
+
+	if (bins == 0 || !(hi > lo)) {
+		return std::nullopt;
+	}
+
+	return sbon::HistogramSpec{lo, hi, (std::size_t)bins};
+}
+
+static void printResult(const std::string &path, const sbon::Aggregate &agg) {
+	std::printf("%s:\n", path.c_str());
+	std::printf("  count %llu\n", (unsigned long long)agg.count());
+	if (agg.count() == 0) {
+		return;
+	}
+
+	std::printf("  sum   %.17g\n", agg.sum());
+	std::printf("  min   %.17g\n", agg.min());
+	std::printf("  max   %.17g\n", agg.max());
+	std::printf("  mean  %.17g\n", agg.mean());
+
+	if (!agg.hasHistogram()) {
+		return;
+	}
+
+	auto &spec = agg.histogramSpec();
+	double width = (spec.hi - spec.lo) / (double)spec.bins;
+	std::printf("  histogram:\n");
+	std::printf("    %-28s %llu\n", "below", (unsigned long long)agg.underflow());
+	for (std::size_t i = 0; i < spec.bins; ++i) {
+		char range[64];
+		std::snprintf(range, sizeof(range), "[%g, %g)",
+			spec.lo + width * (double)i, spec.lo + width * (double)(i + 1));
+		std::printf("    %-28s %llu\n", range, (unsigned long long)agg.histogram()[i]);
+	}
+	std::printf("    %-28s %llu\n", "above", (unsigned long long)agg.overflow());
+}
+
+int main(int argc, char **argv) {
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	std::optional<sbon::HistogramSpec> hist;
+	std::vector<std::string> paths;
+	std::vector<std::string> files;
+	sbon::AggregateQuery query;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "-j" && i + 1 < argc) {
+			threads = (unsigned)std::atoi(argv[++i]);
+		} else if (arg == "-H" && i + 1 < argc) {
+			hist = parseHistogram(argv[++i]);
+			if (!hist) {
+				std::cerr << "Bad histogram: " << argv[i] << '\n';
+				return 1;
+			}
+		} else if (arg == "-p" && i + 1 < argc) {
+			std::string path = argv[++i];
+			if (std::find(paths.begin(), paths.end(), path) != paths.end()) {
+				std::cerr << "Repeated path: " << path << '\n';
+				usage(argv[0]);
+				return 1;
+			}
+
+			paths.push_back(path);
+			query.add(path, hist ? sbon::Aggregate(*hist) : sbon::Aggregate());
+		} else if (arg.starts_with("-")) {
+			usage(argv[0]);
+			return 1;
+		} else {
+			files.emplace_back(arg);
+		}
+	}
+
+	if (paths.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::uint64_t records;
+	try {
+		if (files.empty()) {
+			records = query.readAll(&std::cin);
+		} else {
+			records = sbon::aggregateFiles(query, files, threads);
+		}
+	} catch (std::exception &ex) {
+		std::cerr << "Error: " << ex.what() << '\n';
+		return 1;
+	}
+
+	std::printf("records: %llu\n", (unsigned long long)records);
+	for (std::size_t i = 0; i < paths.size(); ++i) {
+		printResult(paths[i], query.result(i));
+	}
+}
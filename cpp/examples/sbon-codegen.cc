@@ -0,0 +1,727 @@
+#include <sbon.h>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Generates C++ structs with straight-line SBON encode and decode functions.
+//
+// The schema is either a small IDL:
+//
+//     # Comment
+//     struct Point {
+//         x: double;
+//         y: double;
+//         label "point-label": string;
+//     }
+//
+//     struct Shape {
+//         name: string;
+//         points: [Point];
+//         closed: bool;
+//     }
+//
+// with the types bool, int, uint, float, double, string, binary,
+// [T] for arrays and the names of previously declared structs,
+// or an example SBON document (a .sbon file), whose shape is used.
+
+struct TypeRef {
+	enum class Kind {
+		BOOL,
+		INT,
+		UINT,
+		FLOAT,
+		DOUBLE,
+		STRING,
+		BINARY,
+		STRUCT,
+		ARRAY,
+	};
+
+	Kind kind;
+	std::string name;
+	std::shared_ptr<TypeRef> elem;
+};
+
+struct Field {
+	std::string key;
+	std::string member;
+	TypeRef type;
+};
+
+struct Struct {
+	std::string name;
+	std::vector<Field> fields;
+};
+
+static bool isKeyword(std::string_view name) {
+	static const char *const keywords[] = {
+		"alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor",
+		"bool", "break", "case", "catch", "char", "char8_t", "char16_t", "char32_t",
+		"class", "compl", "concept", "const", "consteval", "constexpr", "constinit",
+		"const_cast", "continue", "co_await", "co_return", "co_yield", "decltype",
+		"default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+		"explicit", "export", "extern", "false", "float", "for", "friend", "goto",
+		"if", "inline", "int", "long", "mutable", "namespace", "new", "noexcept",
+		"not", "not_eq", "nullptr", "operator", "or", "or_eq", "private",
+		"protected", "public", "register", "reinterpret_cast", "requires", "return",
+		"short", "signed", "sizeof", "static", "static_assert", "static_cast",
+		"struct", "switch", "template", "this", "thread_local", "throw", "true",
+		"try", "typedef", "typeid", "typename", "union", "unsigned", "using",
+		"virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq",
+	};
+
+	for (auto keyword: keywords) {
+		if (name == keyword) {
+			return true;
+		}
+	}
+	return false;
+}
+
+class SchemaError: public std::runtime_error {
+public:
+	SchemaError(int line, const std::string &msg):
+		std::runtime_error("line " + std::to_string(line) + ": " + msg) {}
+};
+
+class Parser {
+public:
+	explicit Parser(std::string_view src): src_(src) {}
+
+	std::vector<Struct> parse() {
+		std::vector<Struct> structs;
+		while (true) {
+			std::string tok = next();
+			if (tok.empty()) {
+				return structs;
+			} else if (tok != "struct") {
+				throw SchemaError(line_, "Expected 'struct', got '" + tok + "'");
+			}
+
+			Struct s;
+			s.name = ident();
+			if (findStruct(structs, s.name)) {
+				throw SchemaError(line_, "Duplicate struct " + s.name);
+			}
+
+			expect("{");
+			while (peek() != "}") {
+				Field field;
+				field.member = ident();
+				for (auto &other: s.fields) {
+					if (other.member == field.member) {
+						throw SchemaError(line_, "Duplicate member " + field.member);
+					}
+				}
+				field.key = field.member;
+				if (peek()[0] == '"') {
+					std::string str = next();
+					field.key = str.substr(1, str.size() - 2);
+				}
+				expect(":");
+				field.type = type(structs);
+				expect(";");
+				s.fields.push_back(std::move(field));
+			}
+			expect("}");
+			structs.push_back(std::move(s));
+		}
+	}
+
+	static const Struct *findStruct(const std::vector<Struct> &structs, const std::string &name) {
+		for (auto &s: structs) {
+			if (s.name == name) {
+				return &s;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+	TypeRef type(const std::vector<Struct> &structs) {
+		std::string tok = next();
+		if (tok == "[") {
+			TypeRef t{TypeRef::Kind::ARRAY, "", std::make_shared<TypeRef>(type(structs))};
+			expect("]");
+			return t;
+		}
+
+		static const std::pair<const char *, TypeRef::Kind> builtins[] = {
+			{"bool", TypeRef::Kind::BOOL},
+			{"int", TypeRef::Kind::INT},
+			{"uint", TypeRef::Kind::UINT},
+			{"float", TypeRef::Kind::FLOAT},
+			{"double", TypeRef::Kind::DOUBLE},
+			{"string", TypeRef::Kind::STRING},
+			{"binary", TypeRef::Kind::BINARY},
+		};
+
+		for (auto &[name, kind]: builtins) {
+			if (tok == name) {
+				return {kind, "", nullptr};
+			}
+		}
+
+		if (!findStruct(structs, tok)) {
+			throw SchemaError(line_, "Unknown type '" + tok + "'");
+		}
+
+		return {TypeRef::Kind::STRUCT, tok, nullptr};
+	}
+
+	std::string ident() {
+		std::string tok = next();
+		if (tok.empty() || !(std::isalpha((unsigned char)tok[0]) || tok[0] == '_')) {
+			throw SchemaError(line_, "Expected identifier, got '" + tok + "'");
+		} else if (isKeyword(tok)) {
+			throw SchemaError(line_, "'" + tok + "' is a C++ keyword");
+		}
+		return tok;
+	}
+
+	void expect(std::string_view expected) {
+		std::string tok = next();
+		if (tok != expected) {
+			throw SchemaError(line_,
+				"Expected '" + std::string(expected) + "', got '" + tok + "'");
+		}
+	}
+
+	std::string peek() {
+		std::size_t pos = pos_;
+		int line = line_;
+		std::string tok = next();
+		pos_ = pos;
+		line_ = line;
+		return tok;
+	}
+
+	std::string next() {
+		while (pos_ < src_.size()) {
+			char ch = src_[pos_];
+			if (ch == '\n') {
+				line_ += 1;
+				pos_ += 1;
+			} else if (std::isspace((unsigned char)ch)) {
+				pos_ += 1;
+			} else if (ch == '#') {
+				while (pos_ < src_.size() && src_[pos_] != '\n') {
+					pos_ += 1;
+				}
+			} else {
+				break;
+			}
+		}
+
+		if (pos_ >= src_.size()) {
+			return "";
+		}
+
+		std::size_t start = pos_;
+		char ch = src_[pos_];
+		if (std::isalnum((unsigned char)ch) || ch == '_') {
+			while (pos_ < src_.size() &&
+					(std::isalnum((unsigned char)src_[pos_]) || src_[pos_] == '_')) {
+				pos_ += 1;
+			}
+		} else if (ch == '"') {
+			pos_ += 1;
+			while (pos_ < src_.size() && src_[pos_] != '"') {
+				pos_ += 1;
+			}
+			if (pos_ >= src_.size()) {
+				throw SchemaError(line_, "Unterminated string");
+			}
+			pos_ += 1;
+		} else {
+			pos_ += 1;
+		}
+
+		return std::string(src_.substr(start, pos_ - start));
+	}
+
+	std::string_view src_;
+	std::size_t pos_ = 0;
+	int line_ = 1;
+};
+
+// Infers a schema from the shape of an example document.
+class Inferrer {
+public:
+	std::vector<Struct> infer(sbon::Reader r, const std::string &rootName) {
+		if (r.getType() != sbon::Type::OBJECT) {
+			throw std::runtime_error("The example document must be an object");
+		}
+
+		names_.push_back(rootName);
+		inferStruct(r, rootName);
+		uniqueMembers();
+		return std::move(structs_);
+	}
+
+private:
+	static std::string memberName(const std::string &key) {
+		std::string name;
+		for (char ch: key) {
+			name += std::isalnum((unsigned char)ch) ? ch : '_';
+		}
+		if (name.empty() || std::isdigit((unsigned char)name[0])) {
+			name = "_" + name;
+		}
+		return name;
+	}
+
+	static std::string structName(const std::string &parent, const std::string &key) {
+		std::string name = parent;
+		bool upper = true;
+		for (char ch: key) {
+			if (!std::isalnum((unsigned char)ch)) {
+				upper = true;
+			} else if (upper) {
+				name += (char)std::toupper((unsigned char)ch);
+				upper = false;
+			} else {
+				name += ch;
+			}
+		}
+		return name;
+	}
+
+	static bool contains(const std::vector<std::string> &names, const std::string &name) {
+		for (auto &n: names) {
+			if (n == name) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Struct names are reserved before their fields are inferred,
+	// since structs are only added once they're complete
+	std::string uniqueName(std::string name) {
+		std::string candidate = name;
+		for (int i = 2; contains(names_, candidate); ++i) {
+			candidate = name + std::to_string(i);
+		}
+		names_.push_back(candidate);
+		return candidate;
+	}
+
+	// Different keys can sanitize to the same member name, or to a keyword.
+	// A member also can't share its name with a struct.
+	void uniqueMembers() {
+		for (auto &s: structs_) {
+			std::vector<std::string> members;
+			for (auto &field: s.fields) {
+				std::string name = field.member;
+				if (isKeyword(name)) {
+					name += '_';
+				}
+
+				std::string candidate = name;
+				for (int i = 2; contains(members, candidate) || contains(names_, candidate); ++i) {
+					candidate = name + std::to_string(i);
+				}
+				field.member = candidate;
+				members.push_back(candidate);
+			}
+		}
+	}
+
+	void inferStruct(sbon::Reader r, const std::string &name) {
+		Struct s;
+		s.name = name;
+		r.readObject([&](std::string &key, sbon::Reader val) {
+			Field field;
+			field.key = key;
+			field.member = memberName(key);
+			field.type = inferType(val, structName(name, key));
+			s.fields.push_back(std::move(field));
+		});
+		structs_.push_back(std::move(s));
+	}
+
+	TypeRef inferType(sbon::Reader r, const std::string &name) {
+		switch (r.getType()) {
+		case sbon::Type::BOOL:
+			r.skip();
+			return {TypeRef::Kind::BOOL, "", nullptr};
+
+		case sbon::Type::INT:
+		case sbon::Type::UINT:
+			r.skip();
+			return {TypeRef::Kind::INT, "", nullptr};
+
+		case sbon::Type::FLOAT:
+			r.skip();
+			return {TypeRef::Kind::FLOAT, "", nullptr};
+
+		case sbon::Type::DOUBLE:
+			r.skip();
+			return {TypeRef::Kind::DOUBLE, "", nullptr};
+
+		case sbon::Type::NIL:
+		case sbon::Type::STRING:
+			r.skip();
+			return {TypeRef::Kind::STRING, "", nullptr};
+
+		case sbon::Type::BINARY:
+			r.skip();
+			return {TypeRef::Kind::BINARY, "", nullptr};
+
+		case sbon::Type::OBJECT: {
+			std::string unique = uniqueName(name);
+			inferStruct(r, unique);
+			return {TypeRef::Kind::STRUCT, unique, nullptr};
+		}
+
+		case sbon::Type::ARRAY: {
+			// The first element decides the element type
+			auto elem = std::make_shared<TypeRef>(TypeRef{TypeRef::Kind::INT, "", nullptr});
+			bool first = true;
+			r.readArray([&](sbon::Reader val) {
+				if (first) {
+					*elem = inferType(val, name);
+					first = false;
+				} else {
+					val.skip();
+				}
+			});
+			return {TypeRef::Kind::ARRAY, "", elem};
+		}
+		}
+
+		throw std::runtime_error("Unknown type");
+	}
+
+	std::vector<Struct> structs_;
+	std::vector<std::string> names_;
+};
+
+class Generator {
+public:
+	explicit Generator(std::ostream &os): os_(os) {}
+
+	void generate(
+			const std::vector<Struct> &structs, const std::string &source,
+			const std::string &ns) {
+		os_ << "// Generated by sbon-codegen from " << source << ". Do not edit.\n";
+		os_ << "#pragma once\n\n";
+		os_ << "#include <sbon.h>\n";
+		os_ << "#include <cstdint>\n";
+		os_ << "#include <cstring>\n";
+		os_ << "#include <string>\n";
+		os_ << "#include <string_view>\n";
+		os_ << "#include <vector>\n\n";
+
+		if (!ns.empty()) {
+			os_ << "namespace " << ns << " {\n\n";
+		}
+
+		for (auto &s: structs) {
+			structDecl(s);
+		}
+
+		for (auto &s: structs) {
+			os_ << "inline void encode(sbon::Writer w, const " << s.name << " &val);\n";
+			os_ << "inline void decode(sbon::Reader r, " << s.name << " &val);\n";
+		}
+		os_ << '\n';
+
+		for (auto &s: structs) {
+			encodeFunc(s);
+			decodeFieldFunc(s);
+			decodeFunc(s);
+		}
+
+		if (!ns.empty()) {
+			os_ << "}\n";
+		}
+	}
+
+private:
+	static std::string cppType(const TypeRef &t) {
+		switch (t.kind) {
+		case TypeRef::Kind::BOOL: return "bool";
+		case TypeRef::Kind::INT: return "std::int64_t";
+		case TypeRef::Kind::UINT: return "std::uint64_t";
+		case TypeRef::Kind::FLOAT: return "float";
+		case TypeRef::Kind::DOUBLE: return "double";
+		case TypeRef::Kind::STRING: return "std::string";
+		case TypeRef::Kind::BINARY: return "std::vector<unsigned char>";
+		case TypeRef::Kind::STRUCT: return t.name;
+		case TypeRef::Kind::ARRAY: return "std::vector<" + cppType(*t.elem) + ">";
+		}
+		return "";
+	}
+
+	// Other bytes than printable ASCII are octal escapes, which unlike hex
+	// escapes always end after three digits
+	static std::string cppString(const std::string &str) {
+		std::string out = "\"";
+		for (char ch: str) {
+			auto byte = (unsigned char)ch;
+			if (ch == '"' || ch == '\\') {
+				out += '\\';
+				out += ch;
+			} else if (ch == '\n') {
+				out += "\\n";
+			} else if (ch == '\r') {
+				out += "\\r";
+			} else if (ch == '\t') {
+				out += "\\t";
+			} else if (byte < 0x20 || byte > 0x7e) {
+				out += '\\';
+				out += (char)('0' + (byte >> 6));
+				out += (char)('0' + ((byte >> 3) & 7));
+				out += (char)('0' + (byte & 7));
+			} else {
+				out += ch;
+			}
+		}
+		return out + '"';
+	}
+
+	void indent(int depth) {
+		for (int i = 0; i < depth; ++i) {
+			os_ << '\t';
+		}
+	}
+
+	void structDecl(const Struct &s) {
+		os_ << "struct " << s.name << " {\n";
+		for (auto &f: s.fields) {
+			os_ << '\t' << cppType(f.type) << ' ' << f.member;
+			switch (f.type.kind) {
+			case TypeRef::Kind::BOOL: os_ << " = false"; break;
+			case TypeRef::Kind::INT:
+			case TypeRef::Kind::UINT:
+			case TypeRef::Kind::FLOAT:
+			case TypeRef::Kind::DOUBLE: os_ << " = 0"; break;
+			default: break;
+			}
+			os_ << ";\n";
+		}
+		os_ << "};\n\n";
+	}
+
+	// Emit a statement which writes 'expr' with the Writer expression 'w'.
+	void encodeValue(const TypeRef &t, const std::string &w, const std::string &expr, int depth) {
+		indent(depth);
+		switch (t.kind) {
+		case TypeRef::Kind::BOOL:
+			os_ << w << ".writeBool(" << expr << ");\n";
+			break;
+		case TypeRef::Kind::INT:
+			os_ << w << ".writeInt(" << expr << ");\n";
+			break;
+		case TypeRef::Kind::UINT:
+			os_ << w << ".writeUInt(" << expr << ");\n";
+			break;
+		case TypeRef::Kind::FLOAT:
+			os_ << w << ".writeFloat(" << expr << ");\n";
+			break;
+		case TypeRef::Kind::DOUBLE:
+			os_ << w << ".writeDouble(" << expr << ");\n";
+			break;
+		case TypeRef::Kind::STRING:
+			os_ << w << ".writeString(" << expr << ");\n";
+			break;
+		case TypeRef::Kind::BINARY:
+			os_ << w << ".writeBinary(" << expr << ".data(), " << expr << ".size());\n";
+			break;
+		case TypeRef::Kind::STRUCT:
+			os_ << "encode(" << w << ", " << expr << ");\n";
+			break;
+		case TypeRef::Kind::ARRAY: {
+			std::string item = "item" + std::to_string(depth);
+			std::string wa = "w" + std::to_string(depth);
+			os_ << w << ".writeArray([&](sbon::Writer " << wa << ") {\n";
+			indent(depth + 1);
+			os_ << "for (auto &" << item << ": " << expr << ") {\n";
+			encodeValue(*t.elem, wa, item, depth + 2);
+			indent(depth + 1);
+			os_ << "}\n";
+			indent(depth);
+			os_ << "});\n";
+			break;
+		}
+		}
+	}
+
+	// Emit a statement which reads into 'lvalue' from the Reader expression 'r'.
+	void decodeValue(const TypeRef &t, const std::string &r, const std::string &lvalue, int depth) {
+		indent(depth);
+		switch (t.kind) {
+		case TypeRef::Kind::BOOL:
+			os_ << lvalue << " = " << r << ".getBool();\n";
+			break;
+		case TypeRef::Kind::INT:
+			os_ << lvalue << " = " << r << ".getInt();\n";
+			break;
+		case TypeRef::Kind::UINT:
+			os_ << lvalue << " = " << r << ".getUInt();\n";
+			break;
+		case TypeRef::Kind::FLOAT:
+			os_ << lvalue << " = " << r << ".getFloat();\n";
+			break;
+		case TypeRef::Kind::DOUBLE:
+			os_ << lvalue << " = " << r << ".getDouble();\n";
+			break;
+		case TypeRef::Kind::STRING:
+			os_ << r << ".getString(" << lvalue << ");\n";
+			break;
+		case TypeRef::Kind::BINARY:
+			os_ << r << ".getBinary(" << lvalue << ");\n";
+			break;
+		case TypeRef::Kind::STRUCT:
+			os_ << "decode(" << r << ", " << lvalue << ");\n";
+			break;
+		case TypeRef::Kind::ARRAY: {
+			std::string ra = "r" + std::to_string(depth);
+			os_ << lvalue << ".clear();\n";
+			indent(depth);
+			os_ << r << ".readArray([&](sbon::Reader " << ra << ") {\n";
+			indent(depth + 1);
+			os_ << lvalue << ".emplace_back();\n";
+			decodeValue(*t.elem, ra, lvalue + ".back()", depth + 1);
+			indent(depth);
+			os_ << "});\n";
+			break;
+		}
+		}
+	}
+
+	void keyCheck(const Field &f, bool negate) {
+		os_ << (negate ? "if (!(" : "if (") << "key.size() == " << f.key.size()
+			<< " && std::memcmp(key.data(), " << cppString(f.key) << ", "
+			<< f.key.size() << ") == 0" << (negate ? "))" : ")");
+	}
+
+	void encodeFunc(const Struct &s) {
+		os_ << "inline void encode(sbon::Writer w, const " << s.name << " &val) {\n";
+		os_ << "\tw.writeObject([&](sbon::ObjectWriter ow) {\n";
+		for (auto &f: s.fields) {
+			encodeValue(f.type, "ow.key(" + cppString(f.key) + ")", "val." + f.member, 2);
+		}
+		os_ << "\t});\n";
+		os_ << "}\n\n";
+	}
+
+	// The slow path, used for fields in an unexpected order and unknown fields.
+	void decodeFieldFunc(const Struct &s) {
+		os_ << "inline void decodeField(std::string_view key, sbon::Reader v, "
+			<< s.name << " &val) {\n";
+		for (auto &f: s.fields) {
+			os_ << '\t';
+			keyCheck(f, false);
+			os_ << " {\n";
+			decodeValue(f.type, "v", "val." + f.member, 2);
+			os_ << "\t\treturn;\n";
+			os_ << "\t}\n";
+		}
+		os_ << "\tv.skip();\n";
+		os_ << "}\n\n";
+	}
+
+	// The fast path expects the fields in declaration order.
+	void decodeFunc(const Struct &s) {
+		os_ << "inline void decode(sbon::Reader r, " << s.name << " &val) {\n";
+		os_ << "\tr.getObject([&](sbon::ObjectReader obj) {\n";
+		os_ << "\t\tstd::string key;\n";
+		os_ << "\t\tsbon::Reader v;\n";
+		os_ << "\t\tif (!obj.hasNext()) return;\n";
+		os_ << "\t\tv = obj.next(key);\n";
+		for (auto &f: s.fields) {
+			os_ << "\t\t";
+			keyCheck(f, true);
+			os_ << " goto slow;\n";
+			decodeValue(f.type, "v", "val." + f.member, 2);
+			os_ << "\t\tif (!obj.hasNext()) return;\n";
+			os_ << "\t\tv = obj.next(key);\n";
+		}
+		os_ << "\tslow:\n";
+		os_ << "\t\twhile (true) {\n";
+		os_ << "\t\t\tdecodeField(key, v, val);\n";
+		os_ << "\t\t\tif (!obj.hasNext()) return;\n";
+		os_ << "\t\t\tv = obj.next(key);\n";
+		os_ << "\t\t}\n";
+		os_ << "\t});\n";
+		os_ << "}\n\n";
+	}
+
+	std::ostream &os_;
+};
+
+static void usage(const char *argv0) {
+	std::cerr << "Usage: " << argv0 << " [-n namespace] [-r root] <schema> [outfile]\n";
+	std::cerr << "  <schema> is an IDL file, or an example document if it ends in .sbon\n";
+	std::cerr << "  -n: Put the generated code in a namespace\n";
+	std::cerr << "  -r: Name of the root struct for example documents (default: Message)\n";
+}
+
+int main(int argc, char **argv) {
+	std::string ns;
+	std::string root = "Message";
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "-n" && i + 1 < argc) {
+			ns = argv[++i];
+		} else if (arg == "-r" && i + 1 < argc) {
+			root = argv[++i];
+		} else if (arg.starts_with("-")) {
+			usage(argv[0]);
+			return 1;
+		} else {
+			paths.emplace_back(arg);
+		}
+	}
+
+	if (paths.size() < 1 || paths.size() > 2) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::ifstream infile(paths[0], std::ios::binary);
+	if (!infile) {
+		std::cerr << "Couldn't open " << paths[0] << '\n';
+		return 1;
+	}
+
+	std::vector<Struct> structs;
+	try {
+		if (paths[0].ends_with(".sbon")) {
+			structs = Inferrer().infer(sbon::Reader(&infile), root);
+		} else {
+			std::stringstream ss;
+			ss << infile.rdbuf();
+			std::string src = ss.str();
+			structs = Parser(src).parse();
+		}
+	} catch (std::exception &ex) {
+		std::cerr << paths[0] << ": " << ex.what() << '\n';
+		return 1;
+	}
+
+	std::stringstream out;
+	Generator(out).generate(structs, paths[0], ns);
+
+	if (paths.size() == 2) {
+		std::ofstream outfile(paths[1]);
+		if (!outfile) {
+			std::cerr << "Couldn't open " << paths[1] << '\n';
+			return 1;
+		}
+		outfile << out.str();
+	} else {
+		std::cout << out.str();
+	}
+}
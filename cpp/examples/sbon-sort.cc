@@ -0,0 +1,96 @@
+#include <sbon-sort.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+static void usage(const char *argv0) {
+	std::cout << "Usage: " << argv0 << " -k path [-r] [-a] [-m MiB] [-j threads] [-T dir] [-o out] [file]\n";
+	std::cout << "  Sorts the records in the file (or stdin), which is a stream of\n";
+	std::cout << "  concatenated SBON values, by the value at a path.\n";
+	std::cout << "  -k: A dot-separated path, like 'user.id'\n";
+	std::cout << "  -r: Sort in descending order\n";
+	std::cout << "  -a: The input is one top-level array of records\n";
+	std::cout << "  -m: Memory budget in MiB (default: 256)\n";
+	std::cout << "  -j: Number of threads to sort runs on (default: one per CPU)\n";
+	std::cout << "  -T: Directory for temporary files\n";
+	std::cout << "  -o: Output file (default: stdout)\n";
+}
+
+int main(int argc, char **argv) {
+	sbon::SortOptions opts;
+	bool hasKey = false;
+	const char *inPath = nullptr;
+	const char *outPath = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "-k" && i + 1 < argc) {
+			opts.path = sbon::parseSortPath(argv[++i]);
+			hasKey = true;
+		} else if (arg == "-r") {
+			opts.descending = true;
+		} else if (arg == "-a") {
+			opts.array = true;
+		} else if (arg == "-m" && i + 1 < argc) {
+			opts.memoryBudget = (std::size_t)std::atoll(argv[++i]) * 1024 * 1024;
+		} else if (arg == "-j" && i + 1 < argc) {
+			opts.threads = (unsigned)std::atoi(argv[++i]);
+		} else if (arg == "-T" && i + 1 < argc) {
+			opts.tempDir = argv[++i];
+		} else if (arg == "-o" && i + 1 < argc) {
+			outPath = argv[++i];
+		} else if (arg.starts_with("-") || inPath) {
+			usage(argv[0]);
+			return 1;
+		} else {
+			inPath = argv[i];
+		}
+	}
+
+	if (!hasKey || opts.memoryBudget == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::ifstream inFile;
+	std::istream *in = &std::cin;
+	if (inPath) {
+		inFile.open(inPath, std::ios::binary);
+		if (!inFile) {
+			std::perror(inPath);
+			return 1;
+		}
+		in = &inFile;
+	}
+
+	std::ofstream outFile;
+	std::ostream *out = &std::cout;
+	if (outPath) {
+		outFile.open(outPath, std::ios::binary);
+		if (!outFile) {
+			std::perror(outPath);
+			return 1;
+		}
+		out = &outFile;
+	}
+
+	sbon::SortStats stats;
+	try {
+		stats = sbon::sortRecords(in, out, opts);
+	} catch (std::exception &ex) {
+		std::cerr << "Error: " << ex.what() << '\n';
+		return 1;
+	}
+
+	out->flush();
+	if (!*out) {
+		std::cerr << "Error: Failed to write output\n";
+		return 1;
+	}
+
+	std::fprintf(stderr, "sorted %llu records in %llu runs\n",
+		(unsigned long long)stats.records, (unsigned long long)stats.runs);
+}
@@ -0,0 +1,178 @@
+#define SBON_STATS
+#include <sbon.h>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char *typeNames[] = {
+	"bool", "null", "string", "binary", "float",
+	"double", "int", "uint", "array", "object",
+};
+
+static void decodeValue(sbon::Reader r) {
+	switch (r.getType()) {
+	case sbon::Type::BOOL:
+		r.getBool();
+		break;
+
+	case sbon::Type::NIL:
+		r.getNil();
+		break;
+
+	case sbon::Type::STRING:
+		r.getString();
+		break;
+
+	case sbon::Type::BINARY:
+		r.getBinary();
+		break;
+
+	case sbon::Type::FLOAT:
+		r.getFloat();
+		break;
+
+	case sbon::Type::DOUBLE:
+		r.getDouble();
+		break;
+
+	case sbon::Type::INT:
+		r.getInt();
+		break;
+
+	case sbon::Type::UINT:
+		r.getUInt();
+		break;
+
+	case sbon::Type::ARRAY:
+		r.readArray([](sbon::Reader val) {
+			decodeValue(val);
+		});
+		break;
+
+	case sbon::Type::OBJECT:
+		r.readObject([](std::string &, sbon::Reader val) {
+			decodeValue(val);
+		});
+		break;
+	}
+}
+
+// With match keys, objects are read with ObjectReader::match the way
+// an application interested in only those keys would read them.
+static void readRecord(sbon::Reader r, const std::vector<sbon::ObjectMatcher> &matchers) {
+	if (matchers.empty() || r.getType() != sbon::Type::OBJECT) {
+		decodeValue(r);
+	} else {
+		r.matchObject(matchers);
+	}
+}
+
+static void readToplevel(sbon::Reader r, const std::vector<sbon::ObjectMatcher> &matchers) {
+	if (!matchers.empty() && r.getType() == sbon::Type::ARRAY) {
+		r.readArray([&](sbon::Reader val) {
+			readRecord(val, matchers);
+		});
+	} else {
+		readRecord(r, matchers);
+	}
+}
+
+static double percent(std::uint64_t part, std::uint64_t total) {
+	return total == 0 ? 0 : (double)part * 100.0 / (double)total;
+}
+
+static void printStats(const sbon::Stats &stats) {
+	std::printf("Bytes read:      %12llu\n", (unsigned long long)stats.bytesRead);
+	std::printf("Bytes skipped:   %12llu (%.1f%%)\n",
+		(unsigned long long)stats.bytesSkipped,
+		percent(stats.bytesSkipped, stats.bytesRead));
+	std::printf("Values decoded:  %12llu\n", (unsigned long long)stats.valuesDecoded);
+	std::printf("Values skipped:  %12llu\n", (unsigned long long)stats.valuesSkipped);
+	std::printf("Max depth:       %12zu\n", stats.maxDepth);
+	std::printf("Match hits:      %12llu\n", (unsigned long long)stats.matchHits);
+	std::printf("Match misses:    %12llu\n", (unsigned long long)stats.matchMisses);
+	std::printf("Allocations:     %12llu (%llu bytes)\n",
+		(unsigned long long)stats.allocations,
+		(unsigned long long)stats.allocatedBytes);
+
+	std::printf("\nBytes per type:\n");
+	for (std::size_t i = 0; i < sbon::Stats::TYPES; ++i) {
+		std::printf("  %-8s %12llu (%.1f%%)\n", typeNames[i],
+			(unsigned long long)stats.bytes[i],
+			percent(stats.bytes[i], stats.bytesRead));
+	}
+	std::printf("  %-8s %12llu (%.1f%%)\n", "keys",
+		(unsigned long long)stats.keyBytes,
+		percent(stats.keyBytes, stats.bytesRead));
+}
+
+static void usage(const char *argv0) {
+	std::cout << "Usage: " << argv0 << " [-m key[,key...]] [infile]\n";
+	std::cout << "  -m: Match only these keys in top-level objects,\n";
+	std::cout << "      or in objects in a top-level array\n";
+}
+
+int main(int argc, char **argv) {
+	std::vector<std::string> keys;
+	const char *path = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		if (arg == "-m" && i + 1 < argc) {
+			std::string_view list = argv[++i];
+			while (true) {
+				auto comma = list.find(',');
+				keys.emplace_back(list.substr(0, comma));
+				if (comma == list.npos) {
+					break;
+				}
+				list = list.substr(comma + 1);
+			}
+		} else if (arg.starts_with("-") || path) {
+			usage(argv[0]);
+			return 1;
+		} else {
+			path = argv[i];
+		}
+	}
+
+	std::istream *input = &std::cin;
+	std::ifstream infile;
+	if (path) {
+		infile.open(path, std::ios::binary);
+		if (!infile) {
+			std::cerr << "Couldn't open " << path << '\n';
+			return 1;
+		}
+		input = &infile;
+	}
+
+	auto decodeMatch = [](sbon::Reader val) {
+		decodeValue(val);
+	};
+
+	std::vector<sbon::ObjectMatcher> matchers;
+	for (auto &key: keys) {
+		matchers.emplace_back(key, decodeMatch);
+	}
+
+	sbon::Stats stats;
+	sbon::StatsScope scope(stats);
+	std::size_t values = 0;
+	try {
+		sbon::Reader reader(input);
+		while (reader.hasNext()) {
+			readToplevel(reader, matchers);
+			values += 1;
+		}
+	} catch (std::exception &ex) {
+		std::cerr << "Error after " << values << " values: " << ex.what() << '\n';
+		printStats(stats);
+		return 1;
+	}
+
+	std::printf("Top-level values: %11zu\n", values);
+	printStats(stats);
+}
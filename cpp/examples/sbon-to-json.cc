@@ -11,8 +11,7 @@ static char hexNibble(unsigned char ch) {
 	}
 }
 
-static void writeString(std::string_view sv, std::ostream &os) {
-	os << '"';
+static void writeStringChars(std::string_view sv, std::ostream &os) {
 	for (char ch: sv) {
 		if (ch == '"') {
 			os << "\\\"";
@@ -37,16 +36,33 @@ static void writeString(std::string_view sv, std::ostream &os) {
 			os << ch;
 		}
 	}
+}
+
+static void writeString(std::string_view sv, std::ostream &os) {
+	os << '"';
+	writeStringChars(sv, os);
 	os << '"';
 }
 
-static void writeBinary(const std::vector<unsigned char> &bin, std::ostream &os) {
+// Strings and binaries are streamed in chunks,
+// so that huge values don't have to fit in memory
+static void writeString(sbon::Reader r, std::ostream &os) {
+	os << '"';
+	r.readString([&](std::string_view chunk) {
+		writeStringChars(chunk, os);
+	});
+	os << '"';
+}
+
+static void writeBinary(sbon::Reader r, std::ostream &os) {
 	os << "\"HEX:";
-	for (unsigned char ch: bin) {
-		os
-			<< hexNibble(ch >> 4)
-			<< hexNibble(ch & 0x0f);
-	}
+	r.readBinary([&](const unsigned char *data, std::size_t size) {
+		for (std::size_t i = 0; i < size; ++i) {
+			os
+				<< hexNibble(data[i] >> 4)
+				<< hexNibble(data[i] & 0x0f);
+		}
+	});
 	os << '"';
 }
 
@@ -110,11 +126,11 @@ static void writeValue(sbon::Reader r, std::ostream &os, int depth) {
 		break;
 
 	case sbon::Type::STRING:
-		writeString(r.getString(), os);
+		writeString(r, os);
 		break;
 
 	case sbon::Type::BINARY:
-		writeBinary(r.getBinary(), os);
+		writeBinary(r, os);
 		break;
 
 	case sbon::Type::FLOAT:
@@ -0,0 +1,422 @@
+#ifndef SBON_AGG_H
+#define SBON_AGG_H
+
+#include "sbon.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace sbon {
+
+struct HistogramSpec {
+	double lo;
+	double hi;
+	std::size_t bins;
+};
+
+// Count, sum, min, max and optionally a histogram of a set of numbers.
+// Values are added in batches; the kernels keep several independent
+// accumulators so that the compiler can vectorize them.
+class Aggregate {
+public:
+	static constexpr std::size_t LANES = 4;
+
+	Aggregate() = default;
+
+	explicit Aggregate(HistogramSpec hist): hist_(hist), histogram_(hist.bins) {
+		if (hist.bins == 0 || !(hist.hi > hist.lo)) {
+			throw LogicError();
+		}
+	}
+
+	void add(std::span<const double> values) {
+		std::size_t n = values.size();
+		std::size_t body = n - n % LANES;
+		const double *v = values.data();
+
+		double sum[LANES] = {};
+		double min[LANES];
+		double max[LANES];
+		for (std::size_t l = 0; l < LANES; ++l) {
+			min[l] = min_;
+			max[l] = max_;
+		}
+
+		for (std::size_t i = 0; i < body; i += LANES) {
+			for (std::size_t l = 0; l < LANES; ++l) {
+				double x = v[i + l];
+				sum[l] += x;
+				min[l] = x < min[l] ? x : min[l];
+				max[l] = x > max[l] ? x : max[l];
+			}
+		}
+
+		for (std::size_t i = body; i < n; ++i) {
+			sum[0] += v[i];
+			min[0] = v[i] < min[0] ? v[i] : min[0];
+			max[0] = v[i] > max[0] ? v[i] : max[0];
+		}
+
+		for (std::size_t l = 0; l < LANES; ++l) {
+			sum_ += sum[l];
+			min_ = std::min(min_, min[l]);
+			max_ = std::max(max_, max[l]);
+		}
+		count_ += n;
+
+		if (!histogram_.empty()) {
+			addHistogram(values);
+		}
+	}
+
+	void add(double value) {
+		add(std::span<const double>(&value, 1));
+	}
+
+	// An aggregate of no values, with the same histogram spec.
+	Aggregate empty() const {
+		return hasHistogram() ? Aggregate(hist_) : Aggregate();
+	}
+
+	// Combine with an aggregate of other values, such as one from another thread.
+	// Both must have the same histogram spec.
+	void merge(const Aggregate &other) {
+		if (histogram_.size() != other.histogram_.size()) {
+			throw LogicError();
+		}
+
+		count_ += other.count_;
+		sum_ += other.sum_;
+		min_ = std::min(min_, other.min_);
+		max_ = std::max(max_, other.max_);
+		underflow_ += other.underflow_;
+		overflow_ += other.overflow_;
+		for (std::size_t i = 0; i < histogram_.size(); ++i) {
+			histogram_[i] += other.histogram_[i];
+		}
+	}
+
+	std::uint64_t count() const {
+		return count_;
+	}
+
+	double sum() const {
+		return sum_;
+	}
+
+	// min() and max() are +inf and -inf when count() is 0.
+	double min() const {
+		return min_;
+	}
+
+	double max() const {
+		return max_;
+	}
+
+	double mean() const {
+		return count_ == 0 ? 0 : sum_ / (double)count_;
+	}
+
+	bool hasHistogram() const {
+		return !histogram_.empty();
+	}
+
+	const HistogramSpec &histogramSpec() const {
+		return hist_;
+	}
+
+	// Bin 'i' counts values in [lo + i * width, lo + (i + 1) * width).
+	const std::vector<std::uint64_t> &histogram() const {
+		return histogram_;
+	}
+
+	// Values below lo, and values at or above hi (or NaN).
+	std::uint64_t underflow() const {
+		return underflow_;
+	}
+
+	std::uint64_t overflow() const {
+		return overflow_;
+	}
+
+private:
+	void addHistogram(std::span<const double> values) {
+		double scale = (double)hist_.bins / (hist_.hi - hist_.lo);
+		auto bins = (std::ptrdiff_t)hist_.bins;
+		for (double x: values) {
+			if (x < hist_.lo) {
+				underflow_ += 1;
+			} else if (x >= hist_.lo && x < hist_.hi) {
+				auto bin = (std::ptrdiff_t)((x - hist_.lo) * scale);
+				histogram_[(std::size_t)std::min(bin, bins - 1)] += 1;
+			} else {
+				overflow_ += 1;
+			}
+		}
+	}
+
+	std::uint64_t count_ = 0;
+	double sum_ = 0;
+	double min_ = std::numeric_limits<double>::infinity();
+	double max_ = -std::numeric_limits<double>::infinity();
+
+	HistogramSpec hist_{0, 0, 0};
+	std::vector<std::uint64_t> histogram_;
+	std::uint64_t underflow_ = 0;
+	std::uint64_t overflow_ = 0;
+};
+
+// Aggregates numbers at a set of paths across a stream of records.
+// A path is a dot-separated list of keys, like "response.latency".
+// Arrays along a path are traversed, so "items.price" aggregates
+// the price of every object in an "items" array; non-numbers are ignored.
+// Values are collected into batches, which are passed to Aggregate::add.
+class AggregateQuery {
+public:
+	static constexpr std::size_t BATCH_SIZE = 1024;
+
+	// Returns the index of the path's result.
+	std::size_t add(std::string_view path, Aggregate agg = Aggregate()) {
+		Node *node = &root_;
+		while (true) {
+			auto dot = path.find('.');
+			std::string_view key = path.substr(0, dot);
+
+			Node *child = nullptr;
+			for (auto &c: node->children) {
+				if (c.key == key) {
+					child = &c;
+					break;
+				}
+			}
+
+			if (!child) {
+				node->children.push_back(Node{std::string(key), {}, -1});
+				child = &node->children.back();
+			}
+
+			node = child;
+			if (dot == path.npos) {
+				break;
+			}
+			path = path.substr(dot + 1);
+		}
+
+		if (node->leaf >= 0) {
+			throw LogicError();
+		}
+
+		node->leaf = (int)results_.size();
+		results_.push_back(std::move(agg));
+		batches_.emplace_back();
+		batches_.back().reserve(BATCH_SIZE);
+		return results_.size() - 1;
+	}
+
+	// Aggregate one record.
+	void read(Reader record) {
+		walk(record, root_);
+	}
+
+	// Aggregate every record in a stream of concatenated values.
+	// Returns the number of records.
+	std::uint64_t readAll(std::istream *is) {
+		std::uint64_t records = 0;
+		Reader r(is);
+		while (r.hasNext()) {
+			walk(r, root_);
+			records += 1;
+		}
+
+		flush();
+		return records;
+	}
+
+	// Process values which are still waiting in a batch.
+	void flush() {
+		for (std::size_t i = 0; i < batches_.size(); ++i) {
+			results_[i].add(batches_[i]);
+			batches_[i].clear();
+		}
+	}
+
+	// A query for the same paths, with no values aggregated yet.
+	AggregateQuery empty() const {
+		AggregateQuery query = *this;
+		for (std::size_t i = 0; i < results_.size(); ++i) {
+			query.results_[i] = results_[i].empty();
+			query.batches_[i].clear();
+		}
+		return query;
+	}
+
+	void merge(const AggregateQuery &other) {
+		if (other.results_.size() != results_.size()) {
+			throw LogicError();
+		}
+
+		for (std::size_t i = 0; i < results_.size(); ++i) {
+			results_[i].merge(other.results_[i]);
+		}
+	}
+
+	// Call flush() first if records were added with read().
+	const Aggregate &result(std::size_t index) const {
+		return results_[index];
+	}
+
+	std::size_t size() const {
+		return results_.size();
+	}
+
+private:
+	struct Node {
+		std::string key;
+		std::vector<Node> children;
+		int leaf;
+	};
+
+	void walk(Reader r, const Node &node) {
+		Type type = r.getType();
+		if (type == Type::ARRAY) {
+			r.readArray([&](Reader val) {
+				walk(val, node);
+			});
+		} else if (type == Type::OBJECT && !node.children.empty()) {
+			r.getObject([&](ObjectReader obj) {
+				while (obj.hasNext()) {
+					Reader val = obj.next(key_);
+					const Node *child = nullptr;
+					for (auto &c: node.children) {
+						if (c.key == key_) {
+							child = &c;
+							break;
+						}
+					}
+
+					if (child) {
+						walk(val, *child);
+					} else {
+						val.skip();
+					}
+				}
+			});
+		} else if (node.leaf >= 0 && type == Type::DOUBLE) {
+			push(node.leaf, r.getDouble());
+		} else if (node.leaf >= 0 && type == Type::FLOAT) {
+			push(node.leaf, r.getFloat());
+		} else if (node.leaf >= 0 && type == Type::INT) {
+			push(node.leaf, (double)r.getInt());
+		} else if (node.leaf >= 0 && type == Type::UINT) {
+			push(node.leaf, (double)r.getUInt());
+		} else {
+			r.skip();
+		}
+	}
+
+	void push(int leaf, double value) {
+		auto &batch = batches_[(std::size_t)leaf];
+		batch.push_back(value);
+		if (batch.size() == BATCH_SIZE) {
+			results_[(std::size_t)leaf].add(batch);
+			batch.clear();
+		}
+	}
+
+	Node root_{"", {}, -1};
+	std::vector<Aggregate> results_;
+	std::vector<std::vector<double>> batches_;
+	std::string key_;
+};
+
+namespace detail {
+
+// Run a copy of 'query' over 'count' sources on up to 'threads' threads,
+// where 'read(AggregateQuery &q, std::size_t i)' aggregates source 'i'
+// into 'q' and returns its number of records.
+template<typename Read>
+inline std::uint64_t aggregateEach(
+		AggregateQuery &query, std::size_t count, unsigned threads, Read read) {
+	threads = (unsigned)std::max<std::size_t>(1, std::min<std::size_t>(threads, count));
+
+	std::vector<AggregateQuery> partials(threads, query.empty());
+	std::vector<std::exception_ptr> errors(threads);
+	std::vector<std::uint64_t> records(threads);
+	std::atomic<std::size_t> next{0};
+
+	auto work = [&](unsigned id) {
+		try {
+			std::size_t i;
+			while ((i = next.fetch_add(1)) < count) {
+				records[id] += read(partials[id], i);
+			}
+		} catch (...) {
+			errors[id] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned id = 1; id < threads; ++id) {
+		workers.emplace_back(work, id);
+	}
+	work(0);
+	for (auto &worker: workers) {
+		worker.join();
+	}
+
+	for (auto &error: errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	std::uint64_t total = 0;
+	query.flush();
+	for (unsigned id = 0; id < threads; ++id) {
+		query.merge(partials[id]);
+		total += records[id];
+	}
+
+	return total;
+}
+
+}
+
+// Run a copy of 'query' over each stream on up to 'threads' threads,
+// and merge the results into 'query'. Returns the number of records.
+inline std::uint64_t aggregateParallel(
+		AggregateQuery &query, std::span<std::istream *const> streams, unsigned threads) {
+	return detail::aggregateEach(query, streams.size(), threads,
+		[&](AggregateQuery &q, std::size_t i) {
+			return q.readAll(streams[i]);
+		});
+}
+
+// Like above, reading files. Each file is opened when a thread gets to it,
+// so only one file per thread is open at a time.
+inline std::uint64_t aggregateFiles(
+		AggregateQuery &query, const std::vector<std::string> &paths, unsigned threads) {
+	return detail::aggregateEach(query, paths.size(), threads,
+		[&](AggregateQuery &q, std::size_t i) {
+			std::ifstream file(paths[i], std::ios::binary);
+			if (!file) {
+				throw std::ios::failure("Couldn't open " + paths[i]);
+			}
+			return q.readAll(&file);
+		});
+}
+
+}
+
+#endif
@@ -0,0 +1,334 @@
+#ifndef SBON_COLUMNS_H
+#define SBON_COLUMNS_H
+
+#include "sbon.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sbon {
+
+enum class ColumnType {
+	DOUBLE,
+	INT,
+	BOOL,
+	STRING,
+};
+
+// One field of an array of objects, stored contiguously.
+// Only the vector matching the column's type is used.
+// Rows where the field is missing, null or has the wrong type are null:
+// their bit in validity() is 0 and their value is 0 or an empty string.
+// Double columns accept any number; int columns accept integers
+// which fit in an int64_t.
+class Column {
+public:
+	Column(std::string name, ColumnType type): name_(std::move(name)), type_(type) {}
+
+	const std::string &name() const {
+		return name_;
+	}
+
+	ColumnType type() const {
+		return type_;
+	}
+
+	std::size_t size() const {
+		return size_;
+	}
+
+	const std::vector<double> &doubles() const {
+		return doubles_;
+	}
+
+	const std::vector<std::int64_t> &ints() const {
+		return ints_;
+	}
+
+	const std::vector<unsigned char> &bools() const {
+		return bools_;
+	}
+
+	// String 'i' is stringData()[offsets()[i]..offsets()[i + 1]].
+	const std::vector<std::uint64_t> &offsets() const {
+		return offsets_;
+	}
+
+	const std::string &stringData() const {
+		return stringData_;
+	}
+
+	std::string_view string(std::size_t row) const {
+		return std::string_view(stringData_).substr(
+			offsets_[row], offsets_[row + 1] - offsets_[row]);
+	}
+
+	// Bit 'i % 64' of word 'i / 64' is set if row 'i' is not null.
+	const std::vector<std::uint64_t> &validity() const {
+		return validity_;
+	}
+
+	bool valid(std::size_t row) const {
+		return (validity_[row / 64] >> (row % 64)) & 1;
+	}
+
+	std::size_t nullCount() const {
+		return size_ - validCount_;
+	}
+
+	void clear() {
+		size_ = 0;
+		validCount_ = 0;
+		doubles_.clear();
+		ints_.clear();
+		bools_.clear();
+		offsets_.assign(1, 0);
+		stringData_.clear();
+		validity_.clear();
+	}
+
+private:
+	friend class ColumnExtractor;
+
+	void beginRow() {
+		if (size_ % 64 == 0) {
+			validity_.push_back(0);
+		}
+
+		switch (type_) {
+		case ColumnType::DOUBLE:
+			doubles_.push_back(0);
+			break;
+		case ColumnType::INT:
+			ints_.push_back(0);
+			break;
+		case ColumnType::BOOL:
+			bools_.push_back(0);
+			break;
+		case ColumnType::STRING:
+			offsets_.push_back(stringData_.size());
+			break;
+		}
+
+		size_ += 1;
+	}
+
+	void read(Reader val) {
+		std::size_t row = size_ - 1;
+		bool ok = true;
+		bool consumed = false;
+		Type type = val.getType();
+		switch (type_) {
+		case ColumnType::DOUBLE:
+			if (type == Type::DOUBLE) {
+				doubles_.back() = val.getDouble();
+			} else if (type == Type::FLOAT) {
+				doubles_.back() = val.getFloat();
+			} else if (type == Type::INT) {
+				doubles_.back() = (double)val.getInt();
+			} else if (type == Type::UINT) {
+				doubles_.back() = (double)val.getUInt();
+			} else {
+				ok = false;
+			}
+			break;
+
+		case ColumnType::INT:
+			if (type == Type::INT) {
+				ints_.back() = val.getInt();
+			} else if (type == Type::UINT) {
+				std::uint64_t num = val.getUInt();
+				ok = num <= (std::uint64_t)std::numeric_limits<std::int64_t>::max();
+				consumed = true;
+				if (ok) {
+					ints_.back() = (std::int64_t)num;
+				}
+			} else {
+				ok = false;
+			}
+			break;
+
+		case ColumnType::BOOL:
+			if (type == Type::BOOL) {
+				bools_.back() = val.getBool();
+			} else {
+				ok = false;
+			}
+			break;
+
+		case ColumnType::STRING:
+			if (type == Type::STRING) {
+				// A repeated key replaces the row's string
+				stringData_.resize(offsets_[row]);
+				val.readString([&](std::string_view chunk) {
+					stringData_.append(chunk);
+				});
+				offsets_.back() = stringData_.size();
+			} else {
+				ok = false;
+			}
+			break;
+		}
+
+		std::uint64_t bit = (std::uint64_t)1 << (row % 64);
+		bool wasValid = validity_.back() & bit;
+		if (ok) {
+			validity_.back() |= bit;
+			validCount_ += !wasValid;
+		} else {
+			validity_.back() &= ~bit;
+			validCount_ -= wasValid;
+			clearValue(row);
+			if (!consumed) {
+				val.skip();
+			}
+		}
+	}
+
+	// A repeated key with a bad value mustn't leave the earlier value behind
+	void clearValue(std::size_t row) {
+		switch (type_) {
+		case ColumnType::DOUBLE:
+			doubles_.back() = 0;
+			break;
+
+		case ColumnType::INT:
+			ints_.back() = 0;
+			break;
+
+		case ColumnType::BOOL:
+			bools_.back() = 0;
+			break;
+
+		case ColumnType::STRING:
+			stringData_.resize(offsets_[row]);
+			offsets_.back() = stringData_.size();
+			break;
+		}
+	}
+
+	std::string name_;
+	ColumnType type_;
+	std::size_t size_ = 0;
+	std::size_t validCount_ = 0;
+	std::vector<double> doubles_;
+	std::vector<std::int64_t> ints_;
+	std::vector<unsigned char> bools_;
+	std::vector<std::uint64_t> offsets_{0};
+	std::string stringData_;
+	std::vector<std::uint64_t> validity_;
+};
+
+// Decodes selected fields of an array of objects into columns,
+// in one pass and without a callback per value.
+//
+//     sbon::ColumnExtractor ex;
+//     ex.add("price", sbon::ColumnType::DOUBLE);
+//     ex.add("name", sbon::ColumnType::STRING);
+//     ex.extract(reader);
+//     const std::vector<double> &prices = ex.column(0).doubles();
+class ColumnExtractor {
+public:
+	// Returns the index of the new column.
+	std::size_t add(std::string name, ColumnType type) {
+		if (rows_ != 0) {
+			throw LogicError();
+		}
+
+		columns_.emplace_back(std::move(name), type);
+		return columns_.size() - 1;
+	}
+
+	std::size_t rows() const {
+		return rows_;
+	}
+
+	const std::vector<Column> &columns() const {
+		return columns_;
+	}
+
+	const Column &column(std::size_t index) const {
+		return columns_[index];
+	}
+
+	// Returns nullptr if there's no column with that name.
+	const Column *column(std::string_view name) const {
+		for (auto &col: columns_) {
+			if (col.name() == name) {
+				return &col;
+			}
+		}
+		return nullptr;
+	}
+
+	// Read an array of objects, appending one row per object.
+	// Elements which aren't objects are rows which are null in every column.
+	// Returns the number of rows read.
+	std::size_t extract(Reader r) {
+		std::size_t start = rows_;
+		r.getArray([&](ArrayReader arr) {
+			while (arr.hasNext()) {
+				readRow(arr.next());
+			}
+		});
+		return rows_ - start;
+	}
+
+	void clear() {
+		rows_ = 0;
+		for (auto &col: columns_) {
+			col.clear();
+		}
+	}
+
+private:
+	void readRow(Reader r) {
+		for (auto &col: columns_) {
+			col.beginRow();
+		}
+		rows_ += 1;
+		if (r.getType() != Type::OBJECT) {
+			r.skip();
+			return;
+		}
+
+		// Objects in an array usually share a key order, so the column
+		// after the previous match is tried first
+		std::size_t guess = 0;
+		r.getObject([&](ObjectReader obj) {
+			while (obj.hasNext()) {
+				Reader val = obj.next(key_);
+				std::size_t index = find(key_, guess);
+				if (index < columns_.size()) {
+					columns_[index].read(val);
+					guess = index + 1;
+				} else {
+					val.skip();
+				}
+			}
+		});
+	}
+
+	std::size_t find(std::string_view key, std::size_t guess) const {
+		std::size_t count = columns_.size();
+		for (std::size_t i = 0; i < count; ++i) {
+			std::size_t index = (guess + i) % count;
+			if (columns_[index].name() == key) {
+				return index;
+			}
+		}
+		return count;
+	}
+
+	std::vector<Column> columns_;
+	std::size_t rows_ = 0;
+	std::string key_;
+};
+
+}
+
+#endif
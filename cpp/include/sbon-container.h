@@ -0,0 +1,736 @@
+#ifndef SBON_CONTAINER_H
+#define SBON_CONTAINER_H
+
+#include "sbon.h"
+#include "sbon-fixed.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// A container for SBON streams, made of independently compressed blocks.
+//
+//     "SBZ1"
+//     block*: header (13 bytes), then 'storedSize' bytes of data
+//     terminator: a block header with rawSize and storedSize 0
+//     block table: one entry (29 bytes) per block
+//     trailer: table offset (8 bytes), block count (8 bytes), "SBZT"
+//
+// A block header is rawSize (4 bytes), storedSize (4 bytes),
+// the CRC-32 of the raw data (4 bytes) and flags (1 byte).
+// A table entry is the block's file offset and raw offset (8 bytes each)
+// followed by a copy of its header. All numbers are little endian.
+// Blocks are compressed with a small built-in LZ77 codec,
+// or stored uncompressed when that's smaller.
+//
+// The blocks can be read sequentially from any stream, while the table
+// lets a seekable stream be read from any position or decompressed
+// in parallel.
+
+namespace sbon {
+
+namespace lz {
+
+// The largest block a writer produces, so that a corrupt header
+// can't make a reader allocate more than this
+static constexpr std::size_t MAX_SIZE = 64 * 1024 * 1024;
+
+inline std::uint32_t read32(const unsigned char *p) {
+	std::uint32_t n;
+	std::memcpy(&n, p, 4);
+	return n;
+}
+
+inline void writeLength(std::string &out, std::size_t len) {
+	while (len >= 255) {
+		out += (char)255;
+		len -= 255;
+	}
+	out += (char)len;
+}
+
+inline void writeSequence(
+		std::string &out, const unsigned char *literals, std::size_t literalLen,
+		std::size_t offset, std::size_t matchLen) {
+	std::size_t matchCode = matchLen == 0 ? 0 : matchLen - 4;
+	unsigned char token = (unsigned char)(
+		(std::min<std::size_t>(literalLen, 15) << 4) | std::min<std::size_t>(matchCode, 15));
+	out += (char)token;
+	if (literalLen >= 15) {
+		writeLength(out, literalLen - 15);
+	}
+
+	out.append((const char *)literals, literalLen);
+	if (matchLen == 0) {
+		return;
+	}
+
+	out += (char)(offset & 0xff);
+	out += (char)(offset >> 8);
+	if (matchCode >= 15) {
+		writeLength(out, matchCode - 15);
+	}
+}
+
+// Compress with an LZ4-style format: sequences of a token
+// (literal length << 4 | match length - 4), extra length bytes,
+// literals, a 2-byte match offset and extra match length bytes.
+// The last sequence has only literals.
+inline std::string compress(std::string_view input) {
+	static constexpr int HASH_BITS = 12;
+	static constexpr std::size_t MAX_OFFSET = 65535;
+
+	auto *in = (const unsigned char *)input.data();
+	std::size_t n = input.size();
+	std::string out;
+	out.reserve(n / 2 + 16);
+
+	std::vector<std::uint32_t> table(1 << HASH_BITS, 0);
+	std::size_t anchor = 0;
+	std::size_t i = 0;
+	while (i + 4 <= n) {
+		std::uint32_t seq = read32(in + i);
+		std::uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+		std::size_t candidate = table[h];
+		table[h] = (std::uint32_t)(i + 1);
+
+		if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET ||
+				read32(in + candidate - 1) != seq) {
+			i += 1;
+			continue;
+		}
+
+		std::size_t match = candidate - 1;
+		std::size_t len = 4;
+		while (i + len < n && in[match + len] == in[i + len]) {
+			len += 1;
+		}
+
+		writeSequence(out, in + anchor, i - anchor, i - match, len);
+		i += len;
+		anchor = i;
+	}
+
+	writeSequence(out, in + anchor, n - anchor, 0, 0);
+	return out;
+}
+
+inline void corrupt() {
+	throw ParseError("Container: Corrupt block");
+}
+
+inline std::size_t readLength(const unsigned char *&ip, const unsigned char *end) {
+	std::size_t len = 0;
+	unsigned char b;
+	do {
+		if (ip >= end) {
+			corrupt();
+		}
+		b = *ip++;
+		len += b;
+	} while (b == 255);
+	return len;
+}
+
+inline void decompress(std::string_view input, std::string &out, std::size_t rawSize) {
+	if (rawSize > MAX_SIZE) {
+		corrupt();
+	}
+
+	auto *ip = (const unsigned char *)input.data();
+	auto *end = ip + input.size();
+	out.resize(rawSize);
+	auto *op = (unsigned char *)out.data();
+	auto *opEnd = op + rawSize;
+	auto *opStart = op;
+
+	while (true) {
+		if (ip >= end) {
+			corrupt();
+		}
+
+		unsigned char token = *ip++;
+		std::size_t literalLen = token >> 4;
+		if (literalLen == 15) {
+			literalLen += readLength(ip, end);
+		}
+
+		if (literalLen > (std::size_t)(end - ip) || literalLen > (std::size_t)(opEnd - op)) {
+			corrupt();
+		}
+
+		std::memcpy(op, ip, literalLen);
+		op += literalLen;
+		ip += literalLen;
+		if (ip == end) {
+			break;
+		}
+
+		if (end - ip < 2) {
+			corrupt();
+		}
+
+		std::size_t offset = (std::size_t)ip[0] | ((std::size_t)ip[1] << 8);
+		ip += 2;
+		std::size_t matchLen = (token & 0x0f);
+		if (matchLen == 15) {
+			matchLen += readLength(ip, end);
+		}
+		matchLen += 4;
+
+		if (offset == 0 || offset > (std::size_t)(op - opStart) ||
+				matchLen > (std::size_t)(opEnd - op)) {
+			corrupt();
+		}
+
+		// Byte by byte, since the match may overlap its own output
+		const unsigned char *match = op - offset;
+		for (std::size_t i = 0; i < matchLen; ++i) {
+			op[i] = match[i];
+		}
+		op += matchLen;
+	}
+
+	if (op != opEnd) {
+		corrupt();
+	}
+}
+
+}
+
+namespace detail {
+
+inline std::uint32_t crc32(std::string_view data) {
+	static const auto table = [] {
+		std::array<std::uint32_t, 256> t{};
+		for (std::uint32_t i = 0; i < 256; ++i) {
+			std::uint32_t c = i;
+			for (int k = 0; k < 8; ++k) {
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			t[i] = c;
+		}
+		return t;
+	}();
+
+	std::uint32_t crc = 0xffffffffu;
+	for (unsigned char ch: data) {
+		crc = table[(crc ^ ch) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffffu;
+}
+
+inline void putLE(std::string &out, std::uint64_t num, int size) {
+	for (int i = 0; i < size; ++i) {
+		out += (char)((num >> (i * 8)) & 0xff);
+	}
+}
+
+inline std::uint64_t getLE(const char *p, int size) {
+	std::uint64_t num = 0;
+	for (int i = 0; i < size; ++i) {
+		num |= (std::uint64_t)(unsigned char)p[i] << (i * 8);
+	}
+	return num;
+}
+
+}
+
+struct ContainerBlock {
+	static constexpr int HEADER_SIZE = 13;
+	static constexpr int ENTRY_SIZE = 16 + HEADER_SIZE;
+
+	static constexpr std::uint32_t MAX_SIZE = (std::uint32_t)lz::MAX_SIZE;
+
+	// The block's data is compressed
+	static constexpr unsigned char COMPRESSED = 1;
+	// The block starts at the start of a value
+	static constexpr unsigned char VALUE_START = 2;
+
+	std::uint64_t fileOffset = 0;
+	std::uint64_t rawOffset = 0;
+	std::uint32_t rawSize = 0;
+	std::uint32_t storedSize = 0;
+	std::uint32_t crc = 0;
+	unsigned char flags = 0;
+
+	void writeHeader(std::string &out) const {
+		detail::putLE(out, rawSize, 4);
+		detail::putLE(out, storedSize, 4);
+		detail::putLE(out, crc, 4);
+		out += (char)flags;
+	}
+
+	void readHeader(const char *p) {
+		rawSize = (std::uint32_t)detail::getLE(p, 4);
+		storedSize = (std::uint32_t)detail::getLE(p + 4, 4);
+		crc = (std::uint32_t)detail::getLE(p + 8, 4);
+		flags = (unsigned char)p[12];
+	}
+
+	// Stored data is only kept when it's smaller than the raw data
+	bool valid() const {
+		return rawSize <= MAX_SIZE && storedSize <= rawSize;
+	}
+
+	// Decompress and verify the block's stored data.
+	void decode(std::string_view stored, std::string &raw) const {
+		if (!valid()) {
+			lz::corrupt();
+		} else if (flags & COMPRESSED) {
+			lz::decompress(stored, raw, rawSize);
+		} else if (stored.size() == rawSize) {
+			raw.assign(stored);
+		} else {
+			lz::corrupt();
+		}
+
+		if (detail::crc32(raw) != crc) {
+			throw ParseError("Container: Checksum mismatch");
+		}
+	}
+};
+
+// A streambuf which writes a container to 'os'. Blocks are cut
+// when 'blockSize' bytes are buffered, or at the next value boundary
+// after that if the writer calls endValue() between values.
+// close() must be called to write the block table.
+class ContainerWriteBuf: public std::streambuf {
+public:
+	explicit ContainerWriteBuf(std::ostream *os, std::size_t blockSize = 64 * 1024):
+			os_(os), buf_(blockSize) {
+		if (blockSize == 0 || blockSize > ContainerBlock::MAX_SIZE) {
+			throw LogicError();
+		}
+
+		os_->write("SBZ1", 4);
+		fileOffset_ = 4;
+		setp(buf_.data(), buf_.data() + buf_.size());
+	}
+
+	~ContainerWriteBuf() override {
+		if (!closed_) {
+			try {
+				close();
+			} catch (...) {}
+		}
+	}
+
+	// Mark a value boundary: cut a block here if it's big enough,
+	// so that the next block starts with a whole value.
+	void endValue() {
+		if ((std::size_t)(pptr() - pbase()) * 4 >= buf_.size() * 3) {
+			emitBlock();
+			nextFlags_ = ContainerBlock::VALUE_START;
+		}
+	}
+
+	// Write the last block and the block table.
+	void close() {
+		if (closed_) {
+			return;
+		}
+
+		emitBlock();
+		closed_ = true;
+
+		std::string out;
+		ContainerBlock().writeHeader(out);
+		std::uint64_t tableOffset = fileOffset_ + ContainerBlock::HEADER_SIZE;
+		for (auto &block: blocks_) {
+			detail::putLE(out, block.fileOffset, 8);
+			detail::putLE(out, block.rawOffset, 8);
+			block.writeHeader(out);
+		}
+		detail::putLE(out, tableOffset, 8);
+		detail::putLE(out, blocks_.size(), 8);
+		out += "SBZT";
+		os_->write(out.data(), (std::streamsize)out.size());
+		os_->flush();
+	}
+
+	const std::vector<ContainerBlock> &blocks() const {
+		return blocks_;
+	}
+
+protected:
+	int_type overflow(int_type ch) override {
+		if (closed_) {
+			return traits_type::eof();
+		}
+
+		emitBlock();
+		nextFlags_ = 0;
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	pos_type seekoff(
+			off_type off, std::ios_base::seekdir dir,
+			std::ios_base::openmode) override {
+		if (off != 0 || dir != std::ios_base::cur) {
+			return pos_type(off_type(-1));
+		}
+
+		return pos_type((off_type)(rawOffset_ + (std::uint64_t)(pptr() - pbase())));
+	}
+
+private:
+	void emitBlock() {
+		std::size_t size = (std::size_t)(pptr() - pbase());
+		if (size == 0) {
+			return;
+		}
+
+		std::string_view raw(pbase(), size);
+		std::string compressed = lz::compress(raw);
+
+		ContainerBlock block;
+		block.fileOffset = fileOffset_;
+		block.rawOffset = rawOffset_;
+		block.rawSize = (std::uint32_t)size;
+		block.crc = detail::crc32(raw);
+		block.flags = nextFlags_;
+
+		std::string_view stored = raw;
+		if (compressed.size() < size) {
+			block.flags |= ContainerBlock::COMPRESSED;
+			stored = compressed;
+		}
+		block.storedSize = (std::uint32_t)stored.size();
+
+		std::string header;
+		block.writeHeader(header);
+		os_->write(header.data(), (std::streamsize)header.size());
+		os_->write(stored.data(), (std::streamsize)stored.size());
+
+		fileOffset_ += header.size() + stored.size();
+		rawOffset_ += size;
+		blocks_.push_back(block);
+		setp(buf_.data(), buf_.data() + buf_.size());
+	}
+
+	std::ostream *os_;
+	std::vector<char> buf_;
+	std::vector<ContainerBlock> blocks_;
+	std::uint64_t fileOffset_ = 0;
+	std::uint64_t rawOffset_ = 0;
+	unsigned char nextFlags_ = ContainerBlock::VALUE_START;
+	bool closed_ = false;
+};
+
+// A streambuf which reads the raw SBON stream from a container.
+// Blocks are read sequentially, so 'is' doesn't need to be seekable
+// unless seekg() or the block table is used. Seek positions
+// are offsets in the raw stream.
+class ContainerReadBuf: public std::streambuf {
+public:
+	explicit ContainerReadBuf(std::istream *is): is_(is) {
+		char magic[4];
+		is_->read(magic, 4);
+		if (is_->gcount() != 4 || std::memcmp(magic, "SBZ1", 4) != 0) {
+			throw ParseError("Container: Bad magic");
+		}
+		fileOffset_ = 4;
+	}
+
+	// The block table, which is read from the end of the stream
+	// the first time it's needed.
+	const std::vector<ContainerBlock> &blocks() {
+		std::call_once(tableOnce_, [this] {
+			loadTable();
+		});
+		return blocks_;
+	}
+
+	// Read and verify block 'index'. Safe to call from several threads.
+	void readBlock(std::size_t index, std::string &raw) {
+		auto &table = blocks();
+		if (index >= table.size()) {
+			throw LogicError();
+		}
+
+		const ContainerBlock &block = table[index];
+		std::string stored(block.storedSize, '\0');
+		{
+			std::lock_guard<std::mutex> lock(mut_);
+			is_->clear();
+			is_->seekg((std::streamoff)(block.fileOffset + ContainerBlock::HEADER_SIZE));
+			is_->read(stored.data(), (std::streamsize)stored.size());
+			if ((std::size_t)is_->gcount() != stored.size()) {
+				throw ParseError("Container: Unexpected EOF");
+			}
+			sequential_ = false;
+		}
+
+		block.decode(stored, raw);
+	}
+
+protected:
+	int_type underflow() override {
+		if (gptr() < egptr()) {
+			return traits_type::to_int_type(*gptr());
+		}
+
+		if (!nextBlock()) {
+			return traits_type::eof();
+		}
+
+		return traits_type::to_int_type(*gptr());
+	}
+
+	pos_type seekoff(
+			off_type off, std::ios_base::seekdir dir,
+			std::ios_base::openmode mode) override {
+		off_type cur = (off_type)(blockRawOffset_ + (std::uint64_t)(gptr() - eback()));
+		if (dir == std::ios_base::cur && off == 0) {
+			return pos_type(cur);
+		} else if (dir == std::ios_base::cur) {
+			return seekpos(pos_type(cur + off), mode);
+		} else if (dir == std::ios_base::beg) {
+			return seekpos(pos_type(off), mode);
+		}
+
+		return pos_type(off_type(-1));
+	}
+
+	pos_type seekpos(pos_type pos, std::ios_base::openmode) override {
+		auto target = (std::uint64_t)(off_type)pos;
+		auto &table = blocks();
+		auto it = std::upper_bound(
+			table.begin(), table.end(), target,
+			[](std::uint64_t offset, const ContainerBlock &block) {
+				return offset < block.rawOffset;
+			});
+		if (it == table.begin()) {
+			return pos_type(off_type(-1));
+		}
+
+		std::size_t index = (std::size_t)(it - table.begin()) - 1;
+		const ContainerBlock &block = table[index];
+		if (target > block.rawOffset + block.rawSize) {
+			return pos_type(off_type(-1));
+		}
+
+		readBlock(index, raw_);
+		blockIndex_ = index + 1;
+		blockRawOffset_ = block.rawOffset;
+		setg(raw_.data(), raw_.data() + (target - block.rawOffset), raw_.data() + raw_.size());
+		return pos;
+	}
+
+private:
+	bool nextBlock() {
+		if (finished_) {
+			return false;
+		}
+
+		std::uint64_t nextRawOffset = blockRawOffset_ + raw_.size();
+
+		// After a seek, continue from the table
+		if (!sequential_) {
+			if (blockIndex_ >= blocks_.size()) {
+				finished_ = true;
+				return false;
+			}
+
+			readBlock(blockIndex_, raw_);
+			blockRawOffset_ = blocks_[blockIndex_].rawOffset;
+			blockIndex_ += 1;
+			setg(raw_.data(), raw_.data(), raw_.data() + raw_.size());
+			return true;
+		}
+
+		std::lock_guard<std::mutex> lock(mut_);
+		char header[ContainerBlock::HEADER_SIZE];
+		is_->read(header, sizeof(header));
+		if (is_->gcount() != sizeof(header)) {
+			throw ParseError("Container: Unexpected EOF");
+		}
+
+		ContainerBlock block;
+		block.readHeader(header);
+		if (block.rawSize == 0 && block.storedSize == 0) {
+			finished_ = true;
+			return false;
+		} else if (!block.valid()) {
+			lz::corrupt();
+		}
+
+		std::string stored(block.storedSize, '\0');
+		is_->read(stored.data(), (std::streamsize)stored.size());
+		if ((std::size_t)is_->gcount() != stored.size()) {
+			throw ParseError("Container: Unexpected EOF");
+		}
+
+		block.decode(stored, raw_);
+		fileOffset_ += ContainerBlock::HEADER_SIZE + block.storedSize;
+		blockRawOffset_ = nextRawOffset;
+		blockIndex_ += 1;
+		setg(raw_.data(), raw_.data(), raw_.data() + raw_.size());
+		return true;
+	}
+
+	void loadTable() {
+		std::lock_guard<std::mutex> lock(mut_);
+		std::streamoff pos = is_->tellg();
+
+		char trailer[20];
+		is_->clear();
+		is_->seekg(-20, std::ios::end);
+		std::streamoff trailerOffset = is_->tellg();
+		is_->read(trailer, sizeof(trailer));
+		if (trailerOffset < 0 || is_->gcount() != sizeof(trailer) ||
+				std::memcmp(trailer + 16, "SBZT", 4) != 0) {
+			throw ParseError("Container: Bad trailer");
+		}
+
+		// The table fills the space between the blocks and the trailer,
+		// which bounds the count before anything is allocated
+		std::uint64_t tableOffset = detail::getLE(trailer, 8);
+		std::uint64_t count = detail::getLE(trailer + 8, 8);
+		auto tableEnd = (std::uint64_t)trailerOffset;
+		if (tableOffset > tableEnd ||
+				(tableEnd - tableOffset) / ContainerBlock::ENTRY_SIZE != count ||
+				(tableEnd - tableOffset) % ContainerBlock::ENTRY_SIZE != 0) {
+			throw ParseError("Container: Bad block table");
+		}
+
+		std::string table((std::size_t)(count * ContainerBlock::ENTRY_SIZE), '\0');
+		is_->seekg((std::streamoff)tableOffset);
+		is_->read(table.data(), (std::streamsize)table.size());
+		if ((std::size_t)is_->gcount() != table.size()) {
+			throw ParseError("Container: Bad block table");
+		}
+
+		std::vector<ContainerBlock> blocks((std::size_t)count);
+		std::uint64_t rawOffset = 0;
+		for (std::uint64_t i = 0; i < count; ++i) {
+			const char *p = table.data() + i * ContainerBlock::ENTRY_SIZE;
+			auto &block = blocks[(std::size_t)i];
+			block.fileOffset = detail::getLE(p, 8);
+			block.rawOffset = detail::getLE(p + 8, 8);
+			block.readHeader(p + 16);
+			if (!block.valid() || block.rawOffset != rawOffset ||
+					block.fileOffset > tableOffset) {
+				throw ParseError("Container: Bad block table");
+			}
+			rawOffset += block.rawSize;
+		}
+
+		is_->clear();
+		is_->seekg(pos);
+		blocks_ = std::move(blocks);
+	}
+
+	std::istream *is_;
+	std::mutex mut_;
+	std::once_flag tableOnce_;
+	std::vector<ContainerBlock> blocks_;
+	bool sequential_ = true;
+	bool finished_ = false;
+	std::string raw_;
+	std::size_t blockIndex_ = 0;
+	std::uint64_t blockRawOffset_ = 0;
+	std::uint64_t fileOffset_ = 0;
+};
+
+// An ostream which writes a container; pass it to a Writer.
+class ContainerOStream: private detail::BufHolder<ContainerWriteBuf>, public std::ostream {
+public:
+	explicit ContainerOStream(std::ostream *os, std::size_t blockSize = 64 * 1024):
+		detail::BufHolder<ContainerWriteBuf>(os, blockSize), std::ostream(&buf_) {}
+
+	void endValue() {
+		flush();
+		buf_.endValue();
+	}
+
+	void close() {
+		flush();
+		buf_.close();
+	}
+
+	const std::vector<ContainerBlock> &blocks() const {
+		return buf_.blocks();
+	}
+};
+
+// An istream which reads the SBON stream in a container; pass it to a Reader.
+class ContainerIStream: private detail::BufHolder<ContainerReadBuf>, public std::istream {
+public:
+	explicit ContainerIStream(std::istream *is):
+		detail::BufHolder<ContainerReadBuf>(is), std::istream(&buf_) {}
+
+	const std::vector<ContainerBlock> &blocks() {
+		return buf_.blocks();
+	}
+
+	void readBlock(std::size_t index, std::string &raw) {
+		buf_.readBlock(index, raw);
+	}
+};
+
+// Decompress every block on up to 'threads' threads, calling
+// 'func(std::size_t index, std::string_view raw)' for each block
+// from the worker threads, in no particular order.
+// Blocks with the VALUE_START flag start with a whole value,
+// so a container written with endValue() can be parsed block by block.
+template<typename Func>
+inline void forEachBlock(ContainerIStream &is, Func func, unsigned threads = 0) {
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::size_t count = is.blocks().size();
+	std::atomic<std::size_t> next{0};
+	std::vector<std::exception_ptr> errors(threads);
+
+	auto work = [&](unsigned id) {
+		try {
+			std::string raw;
+			std::size_t i;
+			while ((i = next.fetch_add(1)) < count) {
+				is.readBlock(i, raw);
+				func(i, std::string_view(raw));
+			}
+		} catch (...) {
+			errors[id] = std::current_exception();
+			next = count;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned id = 1; id < threads; ++id) {
+		workers.emplace_back(work, id);
+	}
+	work(0);
+	for (auto &worker: workers) {
+		worker.join();
+	}
+
+	for (auto &error: errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,518 @@
+#ifndef SBON_CORO_H
+#define SBON_CORO_H
+
+#include "sbon.h"
+
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sbon {
+
+// A lazily evaluated sequence of values produced by a coroutine with co_yield.
+// Yielded values are referenced, not copied, and are only valid
+// until the iterator is incremented.
+template<typename T>
+class Generator {
+public:
+	using value_type = std::remove_cvref_t<T>;
+
+	struct promise_type {
+		const value_type *value = nullptr;
+		std::exception_ptr error;
+
+		Generator get_return_object() {
+			return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_always final_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_always yield_value(const value_type &val) noexcept {
+			value = &val;
+			return {};
+		}
+
+		void return_void() {}
+
+		void unhandled_exception() {
+			error = std::current_exception();
+		}
+
+		template<typename U>
+		void await_transform(U &&) = delete;
+	};
+
+	class Iterator {
+	public:
+		using value_type = Generator::value_type;
+		using difference_type = std::ptrdiff_t;
+
+		Iterator() = default;
+		explicit Iterator(std::coroutine_handle<promise_type> handle): handle_(handle) {}
+
+		const value_type &operator*() const {
+			return *handle_.promise().value;
+		}
+
+		const value_type *operator->() const {
+			return handle_.promise().value;
+		}
+
+		Iterator &operator++() {
+			advance(handle_);
+			return *this;
+		}
+
+		void operator++(int) {
+			++*this;
+		}
+
+		bool operator==(std::default_sentinel_t) const {
+			return !handle_ || handle_.done();
+		}
+
+	private:
+		std::coroutine_handle<promise_type> handle_;
+	};
+
+	explicit Generator(std::coroutine_handle<promise_type> handle): handle_(handle) {}
+
+	Generator(Generator &&other) noexcept:
+		handle_(std::exchange(other.handle_, nullptr)) {}
+
+	Generator &operator=(Generator &&other) noexcept {
+		if (this != &other) {
+			if (handle_) {
+				handle_.destroy();
+			}
+			handle_ = std::exchange(other.handle_, nullptr);
+		}
+		return *this;
+	}
+
+	~Generator() {
+		if (handle_) {
+			handle_.destroy();
+		}
+	}
+
+	// A moved-from generator is empty
+	Iterator begin() {
+		if (handle_ && !handle_.done()) {
+			advance(handle_);
+		}
+		return Iterator(handle_);
+	}
+
+	std::default_sentinel_t end() {
+		return {};
+	}
+
+private:
+	static void advance(std::coroutine_handle<promise_type> handle) {
+		handle.resume();
+		if (handle.promise().error) {
+			std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+		}
+	}
+
+	std::coroutine_handle<promise_type> handle_;
+};
+
+enum class EventType {
+	BOOL,
+	NIL,
+	STRING,
+	BINARY,
+	FLOAT,
+	DOUBLE,
+	INT,
+	UINT,
+	ARRAY_BEGIN,
+	ARRAY_END,
+	OBJECT_BEGIN,
+	OBJECT_END,
+	KEY,
+};
+
+// A parse event. Only the member corresponding to 'type' is meaningful;
+// 'str' holds both strings and keys.
+struct Event {
+	EventType type = EventType::NIL;
+	bool boolean = false;
+	float f = 0;
+	double d = 0;
+	std::int64_t i = 0;
+	std::uint64_t u = 0;
+	std::string str;
+	std::vector<unsigned char> bin;
+};
+
+namespace detail {
+
+// The coroutine type of EventParser's parse loop. The loop suspends
+// both when it needs more input and when it has produced an event.
+struct ParseTask {
+	struct promise_type {
+		bool hasEvent = false;
+		std::exception_ptr error;
+
+		ParseTask get_return_object() {
+			return {std::coroutine_handle<promise_type>::from_promise(*this)};
+		}
+
+		std::suspend_always initial_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_always final_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_always yield_value(bool) noexcept {
+			hasEvent = true;
+			return {};
+		}
+
+		void return_void() {}
+
+		void unhandled_exception() {
+			error = std::current_exception();
+		}
+	};
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+}
+
+// An incremental parser which is fed bytes as they arrive,
+// and never blocks waiting for more.
+class EventParser {
+public:
+	EventParser(): task_(run()) {}
+
+	EventParser(const EventParser &) = delete;
+	EventParser &operator=(const EventParser &) = delete;
+
+	~EventParser() {
+		task_.handle.destroy();
+	}
+
+	void feed(std::string_view data) {
+		if (finished_) {
+			throw LogicError();
+		}
+
+		if (pos_ > 0 && pos_ * 2 >= buf_.size()) {
+			buf_.erase(0, pos_);
+			pos_ = 0;
+		}
+
+		buf_.append(data);
+	}
+
+	// Mark the end of input.
+	void finish() {
+		finished_ = true;
+	}
+
+	// Get the next event. Returns nullptr if more input is needed,
+	// or if the end of input has been reached (then done() returns true).
+	// The event is valid until the next call to next().
+	const Event *next() {
+		auto handle = task_.handle;
+		if (handle.done() || (waiting_ && pos_ >= buf_.size() && !finished_)) {
+			return nullptr;
+		}
+
+		waiting_ = false;
+		handle.promise().hasEvent = false;
+		handle.resume();
+
+		if (handle.promise().error) {
+			std::rethrow_exception(std::exchange(handle.promise().error, nullptr));
+		}
+
+		return handle.promise().hasEvent ? &event_ : nullptr;
+	}
+
+	bool done() const {
+		return task_.handle.done();
+	}
+
+	// The number of buffered bytes not yet parsed.
+	std::size_t buffered() const {
+		return buf_.size() - pos_;
+	}
+
+private:
+	struct ByteAwaiter {
+		EventParser &parser;
+		bool eofOk;
+
+		bool await_ready() {
+			return parser.pos_ < parser.buf_.size() || parser.finished_;
+		}
+
+		void await_suspend(std::coroutine_handle<>) {
+			parser.waiting_ = true;
+		}
+
+		int await_resume() {
+			if (parser.pos_ < parser.buf_.size()) {
+				return (unsigned char)parser.buf_[parser.pos_++];
+			} else if (eofOk) {
+				return EOF;
+			} else {
+				throw ParseError("EventParser: Unexpected EOF");
+			}
+		}
+	};
+
+	ByteAwaiter byte() {
+		return {*this, false};
+	}
+
+	ByteAwaiter byteOrEOF() {
+		return {*this, true};
+	}
+
+	detail::ParseTask run() {
+		std::vector<char> stack;
+		Event &ev = event_;
+
+		while (true) {
+			int ch = co_await byteOrEOF();
+			if (ch == EOF) {
+				if (!stack.empty()) {
+					throw ParseError("EventParser: Unexpected EOF");
+				}
+				co_return;
+			}
+
+			if (!stack.empty() && stack.back() == '{') {
+				if (ch == '}') {
+					stack.pop_back();
+					ev.type = EventType::OBJECT_END;
+					co_yield true;
+					continue;
+				}
+
+				ev.type = EventType::KEY;
+				ev.str.clear();
+				while (ch != 0) {
+					ev.str += (char)ch;
+					ch = co_await byte();
+				}
+				co_yield true;
+
+				ch = co_await byte();
+			} else if (!stack.empty() && ch == ']') {
+				stack.pop_back();
+				ev.type = EventType::ARRAY_END;
+				co_yield true;
+				continue;
+			}
+
+			if (ch == 'T' || ch == 'F') {
+				ev.type = EventType::BOOL;
+				ev.boolean = ch == 'T';
+			} else if (ch == 'N') {
+				ev.type = EventType::NIL;
+			} else if (ch == 'S') {
+				ev.type = EventType::STRING;
+				ev.str.clear();
+				while ((ch = co_await byte()) != 0) {
+					ev.str += (char)ch;
+				}
+			} else if (ch == 'B') {
+				std::uint64_t size = 0;
+				std::uint64_t shift = 0;
+				do {
+					ch = co_await byte();
+					size |= (std::uint64_t)(ch & 0x7f) << shift;
+					shift += 7;
+				} while (ch >= 0x80);
+
+				ev.type = EventType::BINARY;
+				ev.bin.clear();
+				while (ev.bin.size() < size) {
+					ev.bin.push_back((unsigned char)co_await byte());
+				}
+			} else if (ch == 'f' || ch == 'd') {
+				std::uint64_t n = 0;
+				int size = ch == 'f' ? 4 : 8;
+				for (int i = 0; i < size; ++i) {
+					n |= (std::uint64_t)(co_await byte()) << (i * 8);
+				}
+
+				if (size == 4) {
+					auto n32 = (std::uint32_t)n;
+					ev.type = EventType::FLOAT;
+					std::memcpy(&ev.f, &n32, 4);
+				} else {
+					ev.type = EventType::DOUBLE;
+					std::memcpy(&ev.d, &n, 8);
+				}
+			} else if (ch >= '0' && ch <= '9') {
+				ev.type = EventType::UINT;
+				ev.u = (std::uint64_t)(ch - '0');
+			} else if (ch == '+' || ch == '-') {
+				bool negative = ch == '-';
+				std::uint64_t num = 0;
+				std::uint64_t shift = 0;
+				do {
+					ch = co_await byte();
+					num |= (std::uint64_t)(ch & 0x7f) << shift;
+					shift += 7;
+				} while (ch >= 0x80);
+
+				if (!negative) {
+					ev.type = EventType::UINT;
+					ev.u = num;
+				} else if (num > (std::uint64_t)std::numeric_limits<std::int64_t>::max()) {
+					throw ParseError("EventParser: Got unrepresentable number");
+				} else {
+					ev.type = EventType::INT;
+					ev.i = -(std::int64_t)num;
+				}
+			} else if (ch == '[') {
+				stack.push_back('[');
+				ev.type = EventType::ARRAY_BEGIN;
+			} else if (ch == '{') {
+				stack.push_back('{');
+				ev.type = EventType::OBJECT_BEGIN;
+			} else {
+				throw ParseError("EventParser: Unexpected character");
+			}
+
+			co_yield true;
+		}
+	}
+
+	std::string buf_;
+	std::size_t pos_ = 0;
+	bool finished_ = false;
+	bool waiting_ = false;
+	Event event_;
+	detail::ParseTask task_;
+};
+
+// Parse events from a stream, reading it in chunks.
+inline Generator<Event> events(std::istream *is) {
+	EventParser parser;
+	char buf[4096];
+	while (true) {
+		while (const Event *ev = parser.next()) {
+			co_yield *ev;
+		}
+
+		if (parser.done()) {
+			co_return;
+		}
+
+		is->read(buf, sizeof(buf));
+		auto n = (std::size_t)is->gcount();
+		if (n > 0) {
+			parser.feed({buf, n});
+		} else {
+			parser.finish();
+		}
+	}
+}
+
+// An event reader for use from coroutines. 'co_await reader.next()'
+// suspends the awaiting coroutine until enough input has been fed
+// to produce an event, and then returns it, or nullptr at the end of input.
+// feed() and finish() resume the waiting coroutine on the caller's thread.
+class AsyncReader {
+public:
+	class Awaiter {
+	public:
+		explicit Awaiter(AsyncReader &reader): reader_(reader) {}
+
+		bool await_ready() {
+			return reader_.poll();
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) {
+			reader_.waiter_ = handle;
+		}
+
+		const Event *await_resume() {
+			if (reader_.error_) {
+				std::rethrow_exception(std::exchange(reader_.error_, nullptr));
+			}
+			return reader_.event_;
+		}
+
+	private:
+		AsyncReader &reader_;
+	};
+
+	Awaiter next() {
+		if (waiter_) {
+			throw LogicError();
+		}
+
+		return Awaiter(*this);
+	}
+
+	void feed(std::string_view data) {
+		parser_.feed(data);
+		wake();
+	}
+
+	void finish() {
+		parser_.finish();
+		wake();
+	}
+
+	bool done() const {
+		return parser_.done();
+	}
+
+private:
+	// Try to produce an event; returns true if the awaiter can continue.
+	bool poll() {
+		try {
+			event_ = parser_.next();
+		} catch (...) {
+			error_ = std::current_exception();
+			return true;
+		}
+
+		return event_ || parser_.done();
+	}
+
+	void wake() {
+		if (waiter_ && poll()) {
+			std::exchange(waiter_, nullptr).resume();
+		}
+	}
+
+	EventParser parser_;
+	const Event *event_ = nullptr;
+	std::exception_ptr error_;
+	std::coroutine_handle<> waiter_;
+};
+
+}
+
+#endif
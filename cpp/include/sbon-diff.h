@@ -0,0 +1,259 @@
+#ifndef SBON_DIFF_H
+#define SBON_DIFF_H
+
+#include "sbon.h"
+#include "sbon-hash.h"
+#include "sbon-io.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Structural diffs between encoded documents.
+//
+// A patch is itself an SBON value, shaped like a JSON merge patch
+// but able to express every change:
+//
+// * [value] replaces the target with 'value'.
+// * {key: patch, ...} patches the keys of an object. A key's patch is
+//   [] to delete it, [value] to set it, or an object patch to recurse into it.
+//   Kept keys stay in place, and keys which are new are appended in patch order.
+// * {} leaves any target unchanged.
+//
+// diff() only recurses into objects whose keys keep their relative order
+// and where new keys come last; other changes replace the whole value.
+// Arrays are replaced whole when they differ.
+
+namespace sbon {
+
+namespace detail {
+
+struct DiffEntry {
+	std::string_view key;
+	std::string_view value;
+};
+
+inline std::string_view valueHere(BufferSource &src, std::string_view doc) {
+	auto start = (std::size_t)src.offset();
+	BufferReader(&src).skip();
+	return doc.substr(start, (std::size_t)src.offset() - start);
+}
+
+// The keys and values of an encoded object. The keys point into the object,
+// so each is followed by its NUL terminator.
+inline std::vector<DiffEntry> objectEntries(std::string_view obj) {
+	std::vector<DiffEntry> entries;
+	BufferSource src(obj);
+	src.seek(1);
+	while (true) {
+		auto pos = (std::size_t)src.offset();
+		if (pos >= obj.size()) {
+			throw ParseError("diff: Unexpected EOF");
+		} else if (obj[pos] == '}') {
+			return entries;
+		}
+
+		auto nul = obj.find('\0', pos);
+		if (nul == obj.npos) {
+			throw ParseError("diff: Unexpected EOF");
+		}
+
+		src.seek(nul + 1);
+		entries.push_back(DiffEntry{obj.substr(pos, nul - pos), valueHere(src, obj)});
+	}
+}
+
+inline bool isObject(std::string_view value) {
+	return !value.empty() && value[0] == '{';
+}
+
+// Index the keys of an object. Returns false if a key is repeated,
+// since a patch can't tell the copies apart.
+inline bool indexKeys(KeyTable &table, const std::vector<DiffEntry> &entries) {
+	return table.build(entries.size(), [&](std::size_t i) {
+		return entries[i].key;
+	});
+}
+
+template<ByteSink Sink>
+void writeReplace(BasicWriter<Sink> w, std::string_view value) {
+	w.writeArray([&](BasicWriter<Sink> w) {
+		w.writeEncoded(value);
+	});
+}
+
+// Write the patch from object 'a' to object 'b' to 'out',
+// or return false if it can't be expressed as an object patch.
+inline bool diffObjects(std::string_view a, std::string_view b, std::string &out) {
+	auto aEntries = objectEntries(a);
+	auto bEntries = objectEntries(b);
+	KeyTable aIndex, bIndex;
+	if (!indexKeys(aIndex, aEntries) || !indexKeys(bIndex, bEntries)) {
+		return false;
+	}
+
+	// 'b' must be the kept keys of 'a' in their order, followed by new keys
+	std::size_t lastKept = 0;
+	bool kept = true;
+	for (auto &entry: bEntries) {
+		std::size_t i = aIndex.find(entry.key);
+		if (i == KeyTable::NONE) {
+			kept = false;
+		} else if (!kept || i + 1 <= lastKept) {
+			return false;
+		} else {
+			lastKept = i + 1;
+		}
+	}
+
+	StringSink sink(&out);
+	StringWriter w(&sink);
+	std::string nested;
+	w.writeObject([&](StringObjectWriter w) {
+		for (auto &entry: aEntries) {
+			std::size_t i = bIndex.find(entry.key);
+			if (i == KeyTable::NONE) {
+				w.key(entry.key.data()).writeArray([](StringWriter) {});
+				continue;
+			}
+
+			std::string_view value = bEntries[i].value;
+			if (value == entry.value) {
+				continue;
+			}
+
+			nested.clear();
+			if (isObject(entry.value) && isObject(value) &&
+					diffObjects(entry.value, value, nested) &&
+					nested.size() < value.size() + 2) {
+				w.key(entry.key.data()).writeEncoded(nested);
+			} else {
+				writeReplace(w.key(entry.key.data()), value);
+			}
+		}
+
+		for (auto &entry: bEntries) {
+			if (aIndex.find(entry.key) == KeyTable::NONE) {
+				writeReplace(w.key(entry.key.data()), entry.value);
+			}
+		}
+	});
+
+	return true;
+}
+
+template<ByteSink Sink>
+void applyPatch(std::string_view patch, std::string_view base, BasicWriter<Sink> w) {
+	if (patch.empty()) {
+		throw ParseError("apply: Unexpected EOF");
+	}
+
+	if (patch[0] == '[') {
+		BufferSource src(patch);
+		src.seek(1);
+		if (src.peek() == ']') {
+			throw ParseError("apply: Can't delete the root value");
+		}
+
+		w.writeEncoded(valueHere(src, patch));
+		if (src.peek() != ']') {
+			throw ParseError("apply: Expected ']'");
+		}
+		return;
+	} else if (patch[0] != '{') {
+		throw ParseError("apply: Expected '[' or '{'");
+	}
+
+	auto ops = objectEntries(patch);
+	if (ops.empty()) {
+		w.writeEncoded(base);
+		return;
+	} else if (!isObject(base)) {
+		throw ParseError("apply: Object patch on a value which isn't an object");
+	}
+
+	KeyTable opIndex;
+	if (!indexKeys(opIndex, ops)) {
+		throw ParseError("apply: Repeated key");
+	}
+
+	std::vector<bool> used(ops.size());
+	auto writeOp = [&](BasicObjectWriter<Sink> &w, std::string_view key, std::string_view op, std::string_view value) {
+		if (op == "[]") {
+			return;
+		}
+		applyPatch(op, value, w.key(key.data()));
+	};
+
+	w.writeObject([&](BasicObjectWriter<Sink> w) {
+		for (auto &entry: objectEntries(base)) {
+			std::size_t i = opIndex.find(entry.key);
+			if (i == KeyTable::NONE) {
+				w.key(entry.key.data()).writeEncoded(entry.value);
+			} else {
+				used[i] = true;
+				writeOp(w, entry.key, ops[i].value, entry.value);
+			}
+		}
+
+		// An object patch on a new key patches an empty object
+		for (std::size_t i = 0; i < ops.size(); ++i) {
+			if (!used[i]) {
+				writeOp(w, ops[i].key, ops[i].value, "{}");
+			}
+		}
+	});
+}
+
+}
+
+// Write a patch which turns the encoded document 'a' into 'b'.
+// Subtrees which are byte-for-byte identical are skipped without decoding.
+// Throws a ParseError if either document is invalid.
+template<ByteSink Sink>
+void diff(std::string_view a, std::string_view b, BasicWriter<Sink> w) {
+	BufferSource aSrc(a), bSrc(b);
+	a = detail::valueHere(aSrc, a);
+	b = detail::valueHere(bSrc, b);
+	if (a == b) {
+		w.writeObject([](BasicObjectWriter<Sink>) {});
+		return;
+	}
+
+	std::string patch;
+	if (detail::isObject(a) && detail::isObject(b) &&
+			detail::diffObjects(a, b, patch) && patch.size() < b.size() + 2) {
+		w.writeEncoded(patch);
+	} else {
+		detail::writeReplace(w, b);
+	}
+}
+
+inline std::string diff(std::string_view a, std::string_view b) {
+	std::string patch;
+	StringSink sink(&patch);
+	diff(a, b, StringWriter(&sink));
+	return patch;
+}
+
+// Write the result of applying 'patch' to the encoded document 'base'.
+// Unchanged values are copied without being decoded.
+// Throws a ParseError if the patch is invalid or doesn't fit 'base'.
+template<ByteSink Sink>
+void apply(std::string_view patch, std::string_view base, BasicWriter<Sink> w) {
+	BufferSource patchSrc(patch), baseSrc(base);
+	detail::applyPatch(detail::valueHere(patchSrc, patch), detail::valueHere(baseSrc, base), w);
+}
+
+inline std::string apply(std::string_view patch, std::string_view base) {
+	std::string out;
+	StringSink sink(&out);
+	apply(patch, base, StringWriter(&sink));
+	return out;
+}
+
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SBON_FIXED_H
+#define SBON_FIXED_H
+
+#include "sbon.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+
+namespace sbon {
+
+// A read-only streambuf over a buffer, which supports tellg/seekg.
+class SpanStreamBuf: public std::streambuf {
+public:
+	explicit SpanStreamBuf(std::string_view buf) {
+		char *begin = const_cast<char *>(buf.data());
+		setg(begin, begin, begin + buf.size());
+	}
+
+protected:
+	pos_type seekoff(
+			off_type off, std::ios_base::seekdir dir,
+			std::ios_base::openmode) override {
+		off_type pos;
+		if (dir == std::ios_base::beg) {
+			pos = off;
+		} else if (dir == std::ios_base::cur) {
+			pos = (gptr() - eback()) + off;
+		} else {
+			pos = (egptr() - eback()) + off;
+		}
+
+		if (pos < 0 || pos > egptr() - eback()) {
+			return pos_type(off_type(-1));
+		}
+
+		setg(eback(), eback() + pos, egptr());
+		return pos_type(pos);
+	}
+
+	pos_type seekpos(pos_type pos, std::ios_base::openmode mode) override {
+		return seekoff(off_type(pos), std::ios_base::beg, mode);
+	}
+};
+
+// A streambuf which writes to a fixed-size buffer.
+// Writing past the end fails, which sets badbit on the stream.
+class FixedStreamBuf: public std::streambuf {
+public:
+	FixedStreamBuf(char *buf, std::size_t size) {
+		setp(buf, buf + size);
+	}
+
+	std::string_view view() const {
+		return std::string_view(pbase(), (std::size_t)(pptr() - pbase()));
+	}
+
+	void reset() {
+		setp(pbase(), epptr());
+	}
+
+protected:
+	pos_type seekoff(
+			off_type off, std::ios_base::seekdir dir,
+			std::ios_base::openmode) override {
+		if (off != 0 || dir != std::ios_base::cur) {
+			return pos_type(off_type(-1));
+		}
+
+		return pos_type(pptr() - pbase());
+	}
+};
+
+namespace detail {
+
+// Lets the stream classes construct their streambuf before their stream base.
+template<typename Buf>
+struct BufHolder {
+	template<typename ...Args>
+	BufHolder(Args &&...args): buf_(args...) {}
+
+	Buf buf_;
+};
+
+}
+
+// An input stream over a buffer, which doesn't copy or allocate.
+class SpanIStream: private detail::BufHolder<SpanStreamBuf>, public std::istream {
+public:
+	explicit SpanIStream(std::string_view buf):
+		detail::BufHolder<SpanStreamBuf>(buf), std::istream(&buf_) {}
+};
+
+// An output stream into an internal char[N], which never allocates.
+// If a message doesn't fit, the stream goes bad and overflowed() returns true.
+template<std::size_t N>
+class FixedOStream: private detail::BufHolder<FixedStreamBuf>, public std::ostream {
+public:
+	FixedOStream():
+		detail::BufHolder<FixedStreamBuf>(storage_, N), std::ostream(&buf_) {}
+
+	FixedOStream(const FixedOStream &) = delete;
+	FixedOStream &operator=(const FixedOStream &) = delete;
+
+	// The bytes written so far.
+	std::string_view view() const {
+		return buf_.view();
+	}
+
+	bool overflowed() const {
+		return bad();
+	}
+
+	// Discard the contents, to start writing a new message.
+	void reset() {
+		buf_.reset();
+		clear();
+	}
+
+private:
+	char storage_[N];
+};
+
+}
+
+#endif
@@ -0,0 +1,393 @@
+#ifndef SBON_HASH_H
+#define SBON_HASH_H
+
+#include "sbon.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sbon {
+
+namespace detail {
+
+// A number normalized to its mathematical value: integral numbers
+// which fit in 64 bits are kept as a sign and magnitude, no matter
+// how they were encoded, and other numbers as the bits of a double.
+// Floats convert to doubles exactly. All NaNs are treated as one value.
+struct CanonicalNumber {
+	bool integral;
+	bool negative;
+	std::uint64_t bits;
+
+	static CanonicalNumber fromInt(std::int64_t num) {
+		if (num < 0) {
+			return {true, true, (std::uint64_t)0 - (std::uint64_t)num};
+		}
+		return {true, false, (std::uint64_t)num};
+	}
+
+	static CanonicalNumber fromUInt(std::uint64_t num) {
+		return {true, false, num};
+	}
+
+	static CanonicalNumber fromDouble(double d) {
+		if (std::isnan(d)) {
+			d = std::numeric_limits<double>::quiet_NaN();
+		} else if (d == std::trunc(d)) {
+			// [-2^63, 2^64) fits in a sign and a 64-bit magnitude
+			if (d >= 0 && d < 18446744073709551616.0) {
+				return {true, false, (std::uint64_t)d};
+			} else if (d < 0 && d >= -9223372036854775808.0) {
+				return {true, true, (std::uint64_t)0 - (std::uint64_t)(std::int64_t)d};
+			}
+		}
+
+		std::uint64_t bits;
+		std::memcpy(&bits, &d, sizeof(bits));
+		return {false, false, bits};
+	}
+
+	static CanonicalNumber read(Reader r) {
+		switch (r.getType()) {
+		case Type::INT:
+			return fromInt(r.getInt());
+		case Type::UINT:
+			return fromUInt(r.getUInt());
+		case Type::FLOAT:
+			return fromDouble(r.getFloat());
+		default:
+			return fromDouble(r.getDouble());
+		}
+	}
+
+	bool operator==(const CanonicalNumber &) const = default;
+};
+
+inline bool isNumber(Type type) {
+	return
+		type == Type::INT || type == Type::UINT ||
+		type == Type::FLOAT || type == Type::DOUBLE;
+}
+
+// A streaming 64-bit hash. Bytes are gathered into words,
+// so the result doesn't depend on how the input is split.
+class Hasher {
+public:
+	explicit Hasher(std::uint64_t seed): h_(seed ^ 0x9e3779b97f4a7c15ull) {}
+
+	void bytes(const void *data, std::size_t size) {
+		auto *ptr = (const unsigned char *)data;
+		for (std::size_t i = 0; i < size; ++i) {
+			word_ |= (std::uint64_t)ptr[i] << (filled_ * 8);
+			if (++filled_ == 8) {
+				mix(word_);
+				word_ = 0;
+				filled_ = 0;
+			}
+		}
+	}
+
+	void word(std::uint64_t w) {
+		flush();
+		mix(w);
+	}
+
+	std::uint64_t finish() {
+		flush();
+		std::uint64_t h = h_;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+private:
+	void mix(std::uint64_t w) {
+		w *= 0x87c37b91114253d5ull;
+		w = (w << 31) | (w >> 33);
+		h_ ^= w * 0x4cf5ad432745937full;
+		h_ = ((h_ << 27) | (h_ >> 37)) * 5 + 0x52dce729;
+	}
+
+	void flush() {
+		if (filled_ > 0) {
+			mix(word_ | ((std::uint64_t)filled_ << 56));
+			word_ = 0;
+			filled_ = 0;
+		}
+	}
+
+	std::uint64_t h_;
+	std::uint64_t word_ = 0;
+	int filled_ = 0;
+};
+
+// An open addressing hash table from the keys of an object to their indexes.
+class KeyTable {
+public:
+	static constexpr std::size_t NONE = ~(std::size_t)0;
+
+	// Index the keys 'keyAt(0)' to 'keyAt(count - 1)'. The table refers to
+	// their bytes, so they must outlive it. A repeated key keeps its first index,
+	// and makes build return false.
+	template<typename KeyAt>
+	bool build(std::size_t count, KeyAt keyAt) {
+		std::size_t size = 8;
+		while (size < count * 2) {
+			size *= 2;
+		}
+
+		mask_ = size - 1;
+		slots_.assign(size, NONE);
+		keys_.resize(count);
+		bool unique = true;
+		for (std::size_t i = 0; i < count; ++i) {
+			keys_[i] = keyAt(i);
+			std::size_t slot = hash(keys_[i]) & mask_;
+			while (slots_[slot] != NONE && keys_[slots_[slot]] != keys_[i]) {
+				slot = (slot + 1) & mask_;
+			}
+
+			if (slots_[slot] == NONE) {
+				slots_[slot] = i;
+			} else {
+				unique = false;
+			}
+		}
+
+		return unique;
+	}
+
+	bool empty() const {
+		return slots_.empty();
+	}
+
+	std::size_t find(std::string_view key) const {
+		if (slots_.empty()) {
+			return NONE;
+		}
+
+		for (std::size_t slot = hash(key) & mask_; slots_[slot] != NONE; slot = (slot + 1) & mask_) {
+			if (keys_[slots_[slot]] == key) {
+				return slots_[slot];
+			}
+		}
+		return NONE;
+	}
+
+	// FNV-1a, with the high bits folded in since the table masks off the low bits
+	static std::size_t hash(std::string_view key) {
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		for (char ch: key) {
+			h = (h ^ (unsigned char)ch) * 0x100000001b3ull;
+		}
+		return (std::size_t)(h ^ (h >> 29));
+	}
+
+private:
+	std::vector<std::size_t> slots_;
+	std::vector<std::string_view> keys_;
+	std::size_t mask_ = 0;
+};
+
+inline void hashValue(Reader r, Hasher &h, std::string &key) {
+	Type type = r.getType();
+	if (isNumber(type)) {
+		auto num = CanonicalNumber::read(r);
+		h.word(num.integral ? (num.negative ? 'I' : 'U') : 'D');
+		h.word(num.bits);
+		return;
+	}
+
+	switch (type) {
+	case Type::BOOL:
+		h.word(r.getBool() ? 'T' : 'F');
+		break;
+
+	case Type::NIL:
+		r.getNil();
+		h.word('N');
+		break;
+
+	case Type::STRING: {
+		h.word('S');
+		auto length = r.readString([&](std::string_view chunk) {
+			h.bytes(chunk.data(), chunk.size());
+		});
+		h.word(length);
+		break;
+	}
+
+	case Type::BINARY: {
+		h.word('B');
+		auto size = r.readBinary([&](const unsigned char *data, std::size_t size) {
+			h.bytes(data, size);
+		});
+		h.word(size);
+		break;
+	}
+
+	case Type::ARRAY:
+		h.word('[');
+		r.readArray([&](Reader val) {
+			hashValue(val, h, key);
+		});
+		h.word(']');
+		break;
+
+	case Type::OBJECT:
+		h.word('{');
+		r.getObject([&](ObjectReader obj) {
+			while (obj.hasNext()) {
+				Reader val = obj.next(key);
+				h.word('K');
+				h.bytes(key.data(), key.size());
+				h.word(key.size());
+				hashValue(val, h, key);
+			}
+		});
+		h.word('}');
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Keys are compared whole, and strings and binaries a chunk at a time.
+struct EqualBuffers {
+	std::string a;
+	std::string b;
+	char chunkA[Reader::CHUNK_SIZE];
+	char chunkB[Reader::CHUNK_SIZE];
+};
+
+// Always consumes both values, so that the readers stay in sync.
+inline bool equalValue(Reader a, Reader b, EqualBuffers &bufs) {
+	Type ta = a.getType();
+	Type tb = b.getType();
+	if (isNumber(ta) && isNumber(tb)) {
+		return CanonicalNumber::read(a) == CanonicalNumber::read(b);
+	} else if (ta != tb) {
+		a.skip();
+		b.skip();
+		return false;
+	}
+
+	switch (ta) {
+	case Type::BOOL:
+		return a.getBool() == b.getBool();
+
+	case Type::NIL:
+		a.getNil();
+		b.getNil();
+		return true;
+
+	case Type::STRING:
+	case Type::BINARY: {
+		ByteReader bytesA = a.readBytes();
+		ByteReader bytesB = b.readBytes();
+		bool eq = true;
+		while (eq) {
+			std::size_t n = bytesA.read(bufs.chunkA, sizeof(bufs.chunkA));
+			std::size_t m = bytesB.read(bufs.chunkB, sizeof(bufs.chunkB));
+			eq = n == m && std::memcmp(bufs.chunkA, bufs.chunkB, n) == 0;
+			if (n < sizeof(bufs.chunkA)) {
+				break;
+			}
+		}
+
+		bytesA.skipRest();
+		bytesB.skipRest();
+		return eq;
+	}
+
+	case Type::ARRAY: {
+		bool eq = true;
+		a.getArray([&](ArrayReader arrA) {
+			b.getArray([&](ArrayReader arrB) {
+				while (arrA.hasNext() && arrB.hasNext()) {
+					if (eq) {
+						eq = equalValue(arrA.next(), arrB.next(), bufs);
+					} else {
+						arrA.next().skip();
+						arrB.next().skip();
+					}
+				}
+
+				eq = eq && !arrA.hasNext() && !arrB.hasNext();
+				while (arrA.hasNext()) {
+					arrA.next().skip();
+				}
+				while (arrB.hasNext()) {
+					arrB.next().skip();
+				}
+			});
+		});
+		return eq;
+	}
+
+	case Type::OBJECT: {
+		bool eq = true;
+		a.getObject([&](ObjectReader objA) {
+			b.getObject([&](ObjectReader objB) {
+				while (objA.hasNext() && objB.hasNext()) {
+					if (eq) {
+						Reader valA = objA.next(bufs.a);
+						Reader valB = objB.next(bufs.b);
+						eq = bufs.a == bufs.b;
+						eq = equalValue(valA, valB, bufs) && eq;
+					} else {
+						objA.skipKey().skip();
+						objB.skipKey().skip();
+					}
+				}
+
+				eq = eq && !objA.hasNext() && !objB.hasNext();
+				while (objA.hasNext()) {
+					objA.skipKey().skip();
+				}
+				while (objB.hasNext()) {
+					objB.skipKey().skip();
+				}
+			});
+		});
+		return eq;
+	}
+
+	default:
+		return false;
+	}
+}
+
+}
+
+// Hash a value by its meaning rather than its encoding, according to
+// the Semantics section of the README: numbers hash by their
+// mathematical value, while array and object order are significant.
+// Values which are equal() have the same hash.
+inline std::uint64_t hash(Reader r, std::uint64_t seed = 0) {
+	detail::Hasher h(seed);
+	std::string key;
+	detail::hashValue(r, h, key);
+	return h.finish();
+}
+
+// Compare two values by their meaning, like hash().
+// Both values are always read to the end.
+inline bool equal(Reader a, Reader b) {
+	detail::EqualBuffers bufs;
+	return detail::equalValue(a, b, bufs);
+}
+
+}
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef SBON_INDEX_H
+#define SBON_INDEX_H
+
+#include "sbon.h"
+#include "sbon-io.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sbon {
+
+// An index of the byte offsets of every 'stride'th element in an array,
+// so that a reader can start reading at any element without scanning
+// the elements before it. Offsets are relative to the array's '['.
+//
+// The index can be stored in a sidecar file with write/read,
+// or appended to the file containing the array as a trailer.
+// The trailer is the index object followed by a '+' and a 9 byte padded
+// LEB128 number with the index object's length, so that a file
+// with a trailer is still a valid stream of SBON values.
+class ArrayIndex {
+public:
+	explicit ArrayIndex(std::uint64_t stride = 1024): stride_(stride) {
+		if (stride == 0) {
+			throw LogicError();
+		}
+	}
+
+	std::uint64_t stride() const {
+		return stride_;
+	}
+
+	std::uint64_t count() const {
+		return count_;
+	}
+
+	const std::vector<std::uint64_t> &offsets() const {
+		return offsets_;
+	}
+
+	// Position 'is' at element 'k' of the array which starts at 'arrayStart'.
+	// The returned ArrayReader continues from element 'k' to the end of the array.
+	ArrayReader seek(
+			std::istream *is, std::uint64_t k, std::streamoff arrayStart = 0) const;
+
+	void write(Writer w) const;
+	void read(Reader r);
+
+	void writeTrailer(std::ostream *os) const;
+	void readTrailer(std::istream *is);
+
+private:
+	static constexpr int TRAILER_LEB128_SIZE = 9;
+	static constexpr int TRAILER_SIZE = TRAILER_LEB128_SIZE + 1;
+
+	friend class IndexedArrayWriter;
+
+	std::uint64_t stride_;
+	std::uint64_t count_ = 0;
+	std::vector<std::uint64_t> offsets_;
+};
+
+// Passed to the callback of writeIndexedArray. Call next() once per element,
+// and write the element with the returned Writer.
+class IndexedArrayWriter {
+public:
+	IndexedArrayWriter(std::ostream *os, ArrayIndex &index, std::streamoff arrayStart):
+		os_(os), index_(index), arrayStart_(arrayStart) {}
+
+	Writer next() {
+		if (index_.count_ % index_.stride_ == 0) {
+			std::streamoff pos = os_->tellp();
+			if (pos < 0) {
+				throw LogicError();
+			}
+
+			index_.offsets_.push_back((std::uint64_t)(pos - arrayStart_));
+		}
+
+		index_.count_ += 1;
+		return Writer(os_);
+	}
+
+private:
+	std::ostream *os_;
+	ArrayIndex &index_;
+	std::streamoff arrayStart_;
+};
+
+// Write an array to 'os' while recording its index.
+// 'os' must support tellp(), as file and string streams do.
+template<typename Func>
+inline void writeIndexedArray(std::ostream *os, ArrayIndex &index, Func func) {
+	std::streamoff start = os->tellp();
+	if (start < 0) {
+		throw LogicError();
+	}
+
+	index = ArrayIndex(index.stride());
+	Writer(os).writeArray([&](Writer) {
+		IndexedArrayWriter arr(os, index, start);
+		func(arr);
+	});
+}
+
+inline ArrayReader ArrayIndex::seek(
+		std::istream *is, std::uint64_t k, std::streamoff arrayStart) const {
+	if (k >= count_) {
+		throw LogicError();
+	}
+
+	is->clear();
+	is->seekg(arrayStart + (std::streamoff)offsets_[k / stride_]);
+	if (!*is) {
+		throw ParseError("ArrayIndex::seek: Couldn't seek");
+	}
+
+	ArrayReader arr(is);
+	for (std::uint64_t i = 0; i < k % stride_; ++i) {
+		if (!arr.hasNext()) {
+			throw ParseError("ArrayIndex::seek: Unexpected end of array");
+		}
+
+		arr.next().skip();
+	}
+
+	return arr;
+}
+
+inline void ArrayIndex::write(Writer w) const {
+	w.writeObject([&](ObjectWriter w) {
+		w.key("stride").writeUInt(stride_);
+		w.key("count").writeUInt(count_);
+		w.key("offsets").writeArray([&](Writer w) {
+			for (auto offset: offsets_) {
+				w.writeUInt(offset);
+			}
+		});
+	});
+}
+
+namespace detail {
+
+// The number of entries recorded for every 'stride'th of 'count' elements,
+// without overflowing for a count from an untrusted index.
+inline std::uint64_t strideEntries(std::uint64_t count, std::uint64_t stride) {
+	return count / stride + (count % stride != 0);
+}
+
+}
+
+inline void ArrayIndex::read(Reader r) {
+	std::uint64_t stride = 0;
+	std::uint64_t count = 0;
+	std::vector<std::uint64_t> offsets;
+	r.matchObject({
+		{"stride", [&](Reader val) {
+			stride = val.getUInt();
+		}},
+		{"count", [&](Reader val) {
+			count = val.getUInt();
+		}},
+		{"offsets", [&](Reader val) {
+			val.readArray([&](Reader val) {
+				offsets.push_back(val.getUInt());
+			});
+		}},
+	});
+
+	if (stride == 0 || offsets.size() != detail::strideEntries(count, stride)) {
+		throw ParseError("ArrayIndex::read: Inconsistent index");
+	}
+
+	stride_ = stride;
+	count_ = count;
+	offsets_ = std::move(offsets);
+}
+
+inline void ArrayIndex::writeTrailer(std::ostream *os) const {
+	std::streamoff start = os->tellp();
+	write(Writer(os));
+	std::streamoff end = os->tellp();
+	if (start < 0 || end < 0) {
+		throw LogicError();
+	}
+
+	auto length = (std::uint64_t)(end - start);
+	*os << '+';
+	for (int i = 0; i < TRAILER_LEB128_SIZE; ++i) {
+		unsigned char hi = i < TRAILER_LEB128_SIZE - 1 ? 0x80 : 0;
+		*os << (char)(hi | (unsigned char)(length & 0x7f));
+		length >>= 7;
+	}
+}
+
+inline void ArrayIndex::readTrailer(std::istream *is) {
+	is->clear();
+	is->seekg(-TRAILER_SIZE, std::ios::end);
+	if (!*is) {
+		throw ParseError("ArrayIndex::readTrailer: Couldn't seek");
+	}
+
+	std::streamoff footer = is->tellg();
+	auto length = Reader(is).getUInt();
+	if (length > (std::uint64_t)footer) {
+		throw ParseError("ArrayIndex::readTrailer: Bad trailer");
+	}
+
+	is->seekg(footer - (std::streamoff)length);
+	read(Reader(is));
+}
+
+// Passed to the callback of writeSortedObject. Values are buffered
+// until the callback returns, and then written in the order of their keys.
+class SortedObjectWriter {
+public:
+	SortedObjectWriter() = default;
+	SortedObjectWriter(const SortedObjectWriter &) = delete;
+	SortedObjectWriter &operator=(const SortedObjectWriter &) = delete;
+
+	Writer key(const char *key) {
+		entries_.push_back(Entry{key, buffer_.size()});
+		return Writer(&os_);
+	}
+
+	// Call 'func(const std::string &key, std::string_view value)' for each entry,
+	// ordered by key. Entries with the same key keep their order.
+	template<typename Func>
+	void forEachSorted(Func func) {
+		std::vector<std::size_t> order(entries_.size());
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+			return entries_[a].key < entries_[b].key;
+		});
+
+		for (std::size_t i: order) {
+			std::size_t end = i + 1 < entries_.size() ? entries_[i + 1].start : buffer_.size();
+			func(entries_[i].key, std::string_view(buffer_).substr(entries_[i].start, end - entries_[i].start));
+		}
+	}
+
+private:
+	struct Entry {
+		std::string key;
+		std::size_t start;
+	};
+
+	std::string buffer_;
+	StringStreamBuf buf_{&buffer_};
+	std::ostream os_{&buf_};
+	std::vector<Entry> entries_;
+};
+
+// Write an object with its keys in ascending byte order, which lets
+// ObjectReader::find stop early and ObjectIndex search it.
+template<ByteSink Sink, typename Func>
+inline void writeSortedObject(BasicWriter<Sink> w, Func func) {
+	SortedObjectWriter obj;
+	func(obj);
+	w.writeObject([&](BasicObjectWriter<Sink> w) {
+		obj.forEachSorted([&](const std::string &key, std::string_view value) {
+			w.key(key.c_str()).writeEncoded(value);
+		});
+	});
+}
+
+// An index of every 'stride'th key of an object with sorted keys,
+// and the byte offsets of their entries relative to the object's '{'.
+// A lookup binary searches the keys, seeks to the closest entry before
+// the key and scans at most 'stride' entries from there,
+// instead of the whole object.
+class ObjectIndex {
+public:
+	explicit ObjectIndex(std::uint64_t stride = 16): stride_(stride) {
+		if (stride == 0) {
+			throw LogicError();
+		}
+	}
+
+	std::uint64_t stride() const {
+		return stride_;
+	}
+
+	std::uint64_t count() const {
+		return count_;
+	}
+
+	const std::vector<std::string> &keys() const {
+		return keys_;
+	}
+
+	const std::vector<std::uint64_t> &offsets() const {
+		return offsets_;
+	}
+
+	// Call 'func(Reader val)' with the value of 'key' in the object which
+	// starts at 'objectStart' in 'is', and return whether it was found.
+	template<typename Func>
+	bool find(std::istream *is, std::string_view key, Func func, std::streamoff objectStart = 0) const;
+
+	void write(Writer w) const;
+	void read(Reader r);
+
+private:
+	template<typename Func>
+	friend void writeIndexedObject(std::ostream *os, ObjectIndex &index, Func func);
+
+	std::uint64_t stride_;
+	std::uint64_t count_ = 0;
+	std::vector<std::string> keys_;
+	std::vector<std::uint64_t> offsets_;
+};
+
+// Write an object with sorted keys to 'os' while recording its index.
+// 'os' must support tellp(), as file and string streams do.
+template<typename Func>
+inline void writeIndexedObject(std::ostream *os, ObjectIndex &index, Func func) {
+	std::streamoff start = os->tellp();
+	if (start < 0) {
+		throw LogicError();
+	}
+
+	SortedObjectWriter obj;
+	func(obj);
+
+	index = ObjectIndex(index.stride());
+	Writer(os).writeObject([&](ObjectWriter w) {
+		obj.forEachSorted([&](const std::string &key, std::string_view value) {
+			if (index.count_ % index.stride_ == 0) {
+				index.keys_.push_back(key);
+				index.offsets_.push_back((std::uint64_t)(os->tellp() - start));
+			}
+
+			index.count_ += 1;
+			w.key(key.c_str()).writeEncoded(value);
+		});
+	});
+}
+
+template<typename Func>
+inline bool ObjectIndex::find(
+		std::istream *is, std::string_view key, Func func, std::streamoff objectStart) const {
+	auto it = std::upper_bound(keys_.begin(), keys_.end(), key,
+		[](std::string_view key, const std::string &sample) {
+			return key < sample;
+		});
+	if (it == keys_.begin()) {
+		return false;
+	}
+
+	is->clear();
+	is->seekg(objectStart + (std::streamoff)offsets_[(std::size_t)(it - keys_.begin() - 1)]);
+	if (!*is) {
+		throw ParseError("ObjectIndex::find: Couldn't seek");
+	}
+
+	return ObjectReader(is).find(key, func);
+}
+
+inline void ObjectIndex::write(Writer w) const {
+	w.writeObject([&](ObjectWriter w) {
+		w.key("stride").writeUInt(stride_);
+		w.key("count").writeUInt(count_);
+		w.key("keys").writeArray([&](Writer w) {
+			for (auto &key: keys_) {
+				w.writeString(key);
+			}
+		});
+		w.key("offsets").writeArray([&](Writer w) {
+			for (auto offset: offsets_) {
+				w.writeUInt(offset);
+			}
+		});
+	});
+}
+
+inline void ObjectIndex::read(Reader r) {
+	std::uint64_t stride = 0;
+	std::uint64_t count = 0;
+	std::vector<std::string> keys;
+	std::vector<std::uint64_t> offsets;
+	r.matchObject({
+		{"stride", [&](Reader val) {
+			stride = val.getUInt();
+		}},
+		{"count", [&](Reader val) {
+			count = val.getUInt();
+		}},
+		{"keys", [&](Reader val) {
+			val.readArray([&](Reader val) {
+				keys.push_back(val.getString());
+			});
+		}},
+		{"offsets", [&](Reader val) {
+			val.readArray([&](Reader val) {
+				offsets.push_back(val.getUInt());
+			});
+		}},
+	});
+
+	if (stride == 0 || offsets.size() != detail::strideEntries(count, stride) ||
+			keys.size() != offsets.size() || !std::is_sorted(keys.begin(), keys.end())) {
+		throw ParseError("ObjectIndex::read: Inconsistent index");
+	}
+
+	stride_ = stride;
+	count_ = count;
+	keys_ = std::move(keys);
+	offsets_ = std::move(offsets);
+}
+
+}
+
+#endif
@@ -0,0 +1,509 @@
+#ifndef SBON_IO_H
+#define SBON_IO_H
+
+#include "sbon.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ios>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#if __has_include(<unistd.h>) && __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SBON_HAS_POSIX 1
+#endif
+
+// Sources and sinks for BasicReader and BasicWriter, other than iostreams.
+// A reader or writer only holds a pointer to its source or sink,
+// which must outlive it.
+//
+//     sbon::BufferSource src(data);
+//     sbon::BufferReader r(&src);
+
+namespace sbon {
+
+// Reads from memory. Every operation is a few inline pointer operations.
+class BufferSource {
+public:
+	BufferSource() = default;
+
+	explicit BufferSource(std::string_view data):
+		start_(data.data()), pos_(data.data()), end_(data.data() + data.size()) {}
+
+	int get() {
+		return pos_ < end_ ? (unsigned char)*pos_++ : EOF;
+	}
+
+	int peek() {
+		return pos_ < end_ ? (unsigned char)*pos_ : EOF;
+	}
+
+	std::size_t read(char *buf, std::size_t size) {
+		std::size_t n = std::min(size, (std::size_t)(end_ - pos_));
+		std::memcpy(buf, pos_, n);
+		pos_ += n;
+		return n;
+	}
+
+	std::uint64_t offset() const {
+		return (std::uint64_t)(pos_ - start_);
+	}
+
+	void seek(std::uint64_t offset) {
+		pos_ = start_ + std::min(offset, (std::uint64_t)(end_ - start_));
+	}
+
+	// The bytes which haven't been read yet.
+	std::string_view remaining() const {
+		return std::string_view(pos_, (std::size_t)(end_ - pos_));
+	}
+
+protected:
+	const char *start_ = nullptr;
+	const char *pos_ = nullptr;
+	const char *end_ = nullptr;
+};
+
+// Reads from a FILE *, using its buffering.
+class FileSource {
+public:
+	explicit FileSource(std::FILE *f): f_(f) {}
+
+	int get() {
+		int ch = std::getc(f_);
+		offset_ += ch != EOF;
+		return ch;
+	}
+
+	int peek() {
+		int ch = std::getc(f_);
+		if (ch != EOF) {
+			std::ungetc(ch, f_);
+		}
+		return ch;
+	}
+
+	std::size_t read(char *buf, std::size_t size) {
+		std::size_t n = std::fread(buf, 1, size, f_);
+		offset_ += n;
+		return n;
+	}
+
+	std::uint64_t offset() const {
+		return offset_;
+	}
+
+private:
+	std::FILE *f_;
+	std::uint64_t offset_ = 0;
+};
+
+// Appends to a std::string.
+class StringSink {
+public:
+	explicit StringSink(std::string *str): str_(str) {}
+
+	void put(char ch) {
+		str_->push_back(ch);
+	}
+
+	void write(const char *data, std::size_t size) {
+		str_->append(data, size);
+	}
+
+	std::uint64_t offset() const {
+		return str_->size();
+	}
+
+private:
+	std::string *str_;
+};
+
+// Counts the bytes written without storing them, to measure an encoding
+// before allocating room for it. See encodedSize.
+class SizeSink {
+public:
+	constexpr void put(char) {
+		size_ += 1;
+	}
+
+	constexpr void write(const char *, std::size_t size) {
+		size_ += size;
+	}
+
+	constexpr std::uint64_t offset() const {
+		return size_;
+	}
+
+private:
+	std::uint64_t size_ = 0;
+};
+
+// Writes into a buffer of fixed size. Writing past its end throws
+// a LogicError, since the buffer is meant to be sized up front.
+class SpanSink {
+public:
+	SpanSink(char *data, std::size_t size): start_(data), pos_(data), end_(data + size) {}
+
+	void put(char ch) {
+		if (pos_ == end_) {
+			SBON_THROW(LogicError());
+		}
+		*pos_++ = ch;
+	}
+
+	void write(const char *data, std::size_t size) {
+		if (size > (std::size_t)(end_ - pos_)) {
+			SBON_THROW(LogicError());
+		}
+		std::memcpy(pos_, data, size);
+		pos_ += size;
+	}
+
+	std::uint64_t offset() const {
+		return (std::uint64_t)(pos_ - start_);
+	}
+
+private:
+	char *start_;
+	char *pos_;
+	char *end_;
+};
+
+// A streambuf which appends to a std::string, for writing
+// with a Writer into a reusable buffer.
+class StringStreamBuf: public std::streambuf {
+public:
+	explicit StringStreamBuf(std::string *str): str_(str) {}
+
+protected:
+	int_type overflow(int_type ch) override {
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+			*str_ += traits_type::to_char_type(ch);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize xsputn(const char *s, std::streamsize n) override {
+		str_->append(s, (std::size_t)n);
+		return n;
+	}
+
+	pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override {
+		return pos_type(off_type(-1));
+	}
+
+private:
+	std::string *str_;
+};
+
+// Writes to a FILE *, using its buffering. Write errors aren't reported;
+// check std::ferror (after std::fflush) when done. offset() counts
+// the bytes passed to the FILE *, including any which failed.
+class FileSink {
+public:
+	explicit FileSink(std::FILE *f): f_(f) {}
+
+	void put(char ch) {
+		std::putc(ch, f_);
+		offset_ += 1;
+	}
+
+	void write(const char *data, std::size_t size) {
+		std::fwrite(data, 1, size, f_);
+		offset_ += size;
+	}
+
+	std::uint64_t offset() const {
+		return offset_;
+	}
+
+private:
+	std::FILE *f_;
+	std::uint64_t offset_ = 0;
+};
+
+#ifdef SBON_HAS_POSIX
+
+// Reads from a file descriptor through a buffer of BUFFER_SIZE bytes.
+// A read error looks like the end of the input; check failed() afterwards.
+class FdSource {
+public:
+	static constexpr std::size_t BUFFER_SIZE = 16 * 1024;
+
+	explicit FdSource(int fd): fd_(fd) {}
+
+	FdSource(const FdSource &) = delete;
+	FdSource &operator=(const FdSource &) = delete;
+
+	int get() {
+		if (pos_ == end_ && !refill()) {
+			return EOF;
+		}
+		return (unsigned char)buf_[pos_++];
+	}
+
+	int peek() {
+		if (pos_ == end_ && !refill()) {
+			return EOF;
+		}
+		return (unsigned char)buf_[pos_];
+	}
+
+	std::size_t read(char *buf, std::size_t size) {
+		std::size_t n = 0;
+		while (n < size) {
+			if (pos_ == end_ && !refill()) {
+				break;
+			}
+
+			std::size_t chunk = std::min(size - n, end_ - pos_);
+			std::memcpy(buf + n, buf_ + pos_, chunk);
+			pos_ += chunk;
+			n += chunk;
+		}
+		return n;
+	}
+
+	std::uint64_t offset() const {
+		return consumed_ + pos_;
+	}
+
+	bool failed() const {
+		return errno_ != 0;
+	}
+
+	// The errno of the failed read, or 0.
+	int error() const {
+		return errno_;
+	}
+
+private:
+	bool refill() {
+		if (errno_ != 0) {
+			return false;
+		}
+
+		consumed_ += end_;
+		pos_ = 0;
+		end_ = 0;
+		while (true) {
+			ssize_t n = ::read(fd_, buf_, sizeof(buf_));
+			if (n < 0 && errno == EINTR) {
+				continue;
+			} else if (n < 0) {
+				errno_ = errno;
+				return false;
+			}
+
+			end_ = (std::size_t)n;
+			return n > 0;
+		}
+	}
+
+	int fd_;
+	int errno_ = 0;
+	std::size_t pos_ = 0;
+	std::size_t end_ = 0;
+	std::uint64_t consumed_ = 0;
+	char buf_[BUFFER_SIZE];
+};
+
+// Writes to a file descriptor through a buffer of BUFFER_SIZE bytes.
+// Call flush() when done; the destructor also flushes, but can't report errors.
+class FdSink {
+public:
+	static constexpr std::size_t BUFFER_SIZE = 16 * 1024;
+
+	explicit FdSink(int fd): fd_(fd) {}
+
+	FdSink(const FdSink &) = delete;
+	FdSink &operator=(const FdSink &) = delete;
+
+	~FdSink() {
+		flush();
+	}
+
+	void put(char ch) {
+		if (size_ == BUFFER_SIZE) {
+			flush();
+		}
+		buf_[size_++] = ch;
+	}
+
+	void write(const char *data, std::size_t size) {
+		if (size_ + size > BUFFER_SIZE) {
+			flush();
+		}
+
+		if (size >= BUFFER_SIZE) {
+			writeAll(data, size);
+		} else {
+			std::memcpy(buf_ + size_, data, size);
+			size_ += size;
+		}
+	}
+
+	std::uint64_t offset() const {
+		return flushed_ + size_;
+	}
+
+	// Returns false if a write failed, now or earlier.
+	bool flush() {
+		writeAll(buf_, size_);
+		size_ = 0;
+		return errno_ == 0;
+	}
+
+	int error() const {
+		return errno_;
+	}
+
+private:
+	void writeAll(const char *data, std::size_t size) {
+		while (size > 0 && errno_ == 0) {
+			ssize_t n = ::write(fd_, data, size);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			} else if (n < 0) {
+				errno_ = errno;
+				return;
+			}
+
+			data += n;
+			size -= (std::size_t)n;
+			flushed_ += (std::uint64_t)n;
+		}
+	}
+
+	int fd_;
+	int errno_ = 0;
+	std::size_t size_ = 0;
+	std::uint64_t flushed_ = 0;
+	char buf_[BUFFER_SIZE];
+};
+
+// Maps a file into memory, to be read with a BufferReader.
+// The constructor which takes a path throws std::system_error if the file
+// can't be opened or mapped; without exceptions, use open() instead.
+class MappedSource: public BufferSource {
+public:
+	MappedSource() = default;
+
+	explicit MappedSource(const char *path) {
+		int err = open(path);
+		if (err != 0) {
+			SBON_THROW(std::system_error(err, std::generic_category(), path));
+		}
+	}
+
+	// Map the file at 'path'. Returns 0, or the errno of the failure.
+	int open(const char *path) {
+		if (map_) {
+			::munmap(map_, size_);
+			map_ = nullptr;
+		}
+		size_ = 0;
+		start_ = pos_ = end_ = nullptr;
+
+		int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			return errno;
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) < 0) {
+			int e = errno;
+			::close(fd);
+			return e;
+		}
+
+		std::size_t size = (std::size_t)st.st_size;
+		if (size > 0) {
+			void *map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (map == MAP_FAILED) {
+				int e = errno;
+				::close(fd);
+				return e;
+			}
+
+			::madvise(map, size, MADV_SEQUENTIAL);
+			map_ = map;
+			size_ = size;
+		}
+		::close(fd);
+
+		start_ = pos_ = (const char *)map_;
+		end_ = start_ + size_;
+		return 0;
+	}
+
+	MappedSource(const MappedSource &) = delete;
+	MappedSource &operator=(const MappedSource &) = delete;
+
+	~MappedSource() {
+		if (map_) {
+			::munmap(map_, size_);
+		}
+	}
+
+	std::string_view data() const {
+		return std::string_view(start_, size_);
+	}
+
+private:
+	void *map_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+using FdReader = BasicReader<FdSource>;
+using FdWriter = BasicWriter<FdSink>;
+
+#endif
+
+using BufferReader = BasicReader<BufferSource>;
+using FileReader = BasicReader<FileSource>;
+using StringWriter = BasicWriter<StringSink>;
+using StringObjectWriter = BasicObjectWriter<StringSink>;
+using FileWriter = BasicWriter<FileSink>;
+using SizeWriter = BasicWriter<SizeSink>;
+using SpanWriter = BasicWriter<SpanSink>;
+
+// The exact length of what 'func(writer)' writes, computed by running it
+// with a SizeWriter. 'func' must write the same values for any writer type,
+// so it's usually a generic lambda: [&](auto w) { ... }.
+// Don't stream binaries with writeBinary(&is, length) in 'func',
+// since measuring them would consume the stream.
+template<typename Func>
+inline std::uint64_t encodedSize(Func func) {
+	SizeSink sink;
+	func(SizeWriter(&sink));
+	return sink.offset();
+}
+
+// Encode 'func(writer)' into a string with a single allocation,
+// by measuring it first and then writing it with a SpanWriter.
+template<typename Func>
+inline std::string encodeExact(Func func) {
+	std::string out((std::size_t)encodedSize(func), '\0');
+	SpanSink sink(out.data(), out.size());
+	func(SpanWriter(&sink));
+	if (sink.offset() != out.size()) {
+		SBON_THROW(LogicError());
+	}
+	return out;
+}
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef SBON_LITERAL_H
+#define SBON_LITERAL_H
+
+#include "sbon.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Values encoded at compile time, by the same BasicWriter code
+// which encodes at run time:
+//
+//     constexpr auto HELLO = sbon::literal<[](sbon::LiteralWriter w) {
+//         w.writeObject([](sbon::LiteralObjectWriter w) {
+//             w.key("type").writeString("hello");
+//             w.key("version").writeUInt(3);
+//         });
+//     }>();
+//
+//     writer.writeEncoded(HELLO);
+//
+// Misuse which would throw a LogicError at run time fails to compile.
+// Binaries can't be written at compile time.
+
+namespace sbon {
+
+// Counts the bytes written, and stores them if it has somewhere to put them.
+class LiteralSink {
+public:
+	constexpr LiteralSink() = default;
+	constexpr explicit LiteralSink(char *out): out_(out) {}
+
+	constexpr void put(char ch) {
+		if (out_) {
+			out_[size_] = ch;
+		}
+		size_ += 1;
+	}
+
+	constexpr void write(const char *data, std::size_t size) {
+		for (std::size_t i = 0; i < size; ++i) {
+			put(data[i]);
+		}
+	}
+
+	constexpr std::uint64_t offset() const {
+		return size_;
+	}
+
+private:
+	char *out_ = nullptr;
+	std::uint64_t size_ = 0;
+};
+
+using LiteralWriter = BasicWriter<LiteralSink>;
+using LiteralObjectWriter = BasicObjectWriter<LiteralSink>;
+
+// Run 'Func(LiteralWriter)' once to measure the output and once to fill it in.
+template<auto Func>
+consteval auto literal() {
+	constexpr std::size_t size = [] {
+		LiteralSink sink;
+		Func(LiteralWriter(&sink));
+		return (std::size_t)sink.offset();
+	}();
+
+	std::array<char, size> out{};
+	LiteralSink sink(out.data());
+	Func(LiteralWriter(&sink));
+	return out;
+}
+
+}
+
+#endif
@@ -0,0 +1,563 @@
+#ifndef SBON_LOG_H
+#define SBON_LOG_H
+
+#include "sbon.h"
+#include "sbon-io.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#ifdef SBON_HAS_POSIX
+
+// Append-only files of concatenated SBON records.
+//
+// A LogWriter batches records and fsyncs them by a group commit policy.
+// When it opens an existing file, it drops a torn record at the end,
+// left by a crash in the middle of a write. A clean close leaves a checkpoint
+// next to the log, so that opening it again only scans what came after.
+// A LogTailer follows a file as it grows, and only delivers complete records,
+// so its offset() is always a record boundary which it can be resumed from.
+
+namespace sbon {
+
+struct LogScan {
+	// The size of the complete records at the start of the data
+	std::uint64_t size = 0;
+	std::uint64_t records = 0;
+
+	// The data after the complete records isn't the start of a record,
+	// as opposed to being a record which was cut off or zero fill
+	bool corrupt = false;
+};
+
+namespace detail {
+
+// Skip over the complete records at the start of 'data',
+// calling 'func(start, size)' for each of them.
+template<typename Func>
+LogScan scanRecords(std::string_view data, Func func) {
+	auto nonZero = data.find_last_not_of('\0');
+	std::size_t zeros = nonZero == data.npos ? 0 : nonZero + 1;
+
+	LogScan scan;
+	BufferSource src(data.substr(0, zeros));
+	while (src.offset() < zeros) {
+		Error err;
+		BufferReader(&src, &err).skip();
+		if (err) {
+			scan.corrupt = err.code != ErrorCode::UNEXPECTED_EOF;
+			break;
+		}
+
+		func((std::size_t)scan.size, (std::size_t)(src.offset() - scan.size));
+		scan.size = src.offset();
+		scan.records += 1;
+	}
+
+	if (!scan.corrupt && scan.size < zeros) {
+		BufferSource last(data.substr((std::size_t)scan.size));
+		Error err;
+		BufferReader(&last, &err).skip();
+		if (!err && scan.size + last.offset() == data.size()) {
+			func((std::size_t)scan.size, (std::size_t)last.offset());
+			scan.size = data.size();
+			scan.records += 1;
+		}
+	}
+
+	return scan;
+}
+
+}
+
+// Find the complete records at the start of 'data',
+// by skipping over them without decoding.
+//
+// A crash while a file grows can leave zeros after the last write.
+// Since NUL ends strings and keys, the zeros could complete a torn record,
+// so the data is scanned up to the zeros, and a record which runs
+// into them only counts if it ends exactly at the end of the data.
+// A complete record which ends in zero bytes and is followed by
+// zero fill can't be told apart from a torn one, and isn't counted.
+inline LogScan scanRecords(std::string_view data) {
+	return detail::scanRecords(data, [](std::size_t, std::size_t) {});
+}
+
+struct LogOptions {
+	// Records are written to the file when this many bytes are buffered.
+	std::size_t bufferSize = 64 * 1024;
+
+	// Group commit: the file is fsynced once this many records or bytes
+	// have been appended, or this long after the oldest record which
+	// isn't synced yet, whichever comes first. 0 disables a trigger.
+	// Time is only checked on append; sync() and close() always fsync.
+	std::uint64_t syncRecords = 0;
+	std::uint64_t syncBytes = 1024 * 1024;
+	std::chrono::milliseconds syncInterval{100};
+
+	// Write a checkpoint to the file at the log's path plus ".checkpoint"
+	// on close(), and trust the records before it when opening the log.
+	// A log which is rewritten in place must have its checkpoint removed.
+	bool checkpoint = true;
+};
+
+namespace detail {
+
+[[noreturn]] inline void throwErrno(const std::string &what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Write all of 'data', removing what's written from its front,
+// so that after an error 'data' is what's left to write.
+inline void writeAll(int fd, std::string_view &data, const std::string &path) {
+	while (!data.empty()) {
+		ssize_t n = ::write(fd, data.data(), data.size());
+		if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0) {
+			throwErrno(path);
+		}
+
+		data.remove_prefix((std::size_t)n);
+	}
+}
+
+inline void syncFd(int fd, const std::string &path) {
+#ifdef __linux__
+	int ret = ::fdatasync(fd);
+#else
+	int ret = ::fsync(fd);
+#endif
+	if (ret < 0) {
+		throwErrno(path);
+	}
+}
+
+}
+
+class LogWriter {
+public:
+	// Open or create the log at 'path'. A torn record at the end, or zeros
+	// left by a crash while the file was growing, are truncated away.
+	// Throws a ParseError instead of truncating other data after a corrupt record,
+	// and std::system_error on I/O errors.
+	explicit LogWriter(std::string path, LogOptions opts = {}):
+			path_(std::move(path)), opts_(opts) {
+		bool created = ::access(path_.c_str(), F_OK) != 0;
+		fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+		if (fd_ < 0) {
+			detail::throwErrno(path_);
+		}
+
+		try {
+			recover(created);
+		} catch (...) {
+			::close(fd_);
+			throw;
+		}
+	}
+
+	LogWriter(const LogWriter &) = delete;
+	LogWriter &operator=(const LogWriter &) = delete;
+
+	~LogWriter() {
+		try {
+			close();
+		} catch (...) {}
+	}
+
+	// Append one record, which 'func(Writer w)' writes.
+	template<typename Func>
+	void append(Func func) {
+		checkOpen();
+		std::size_t start = buffer_.size();
+		try {
+			func(Writer(&os_));
+		} catch (...) {
+			buffer_.resize(start);
+			throw;
+		}
+
+		if (buffer_.size() == start) {
+			throw LogicError();
+		}
+
+		appended();
+	}
+
+	// Append a record which is already encoded. It isn't validated.
+	void appendEncoded(std::string_view record) {
+		checkOpen();
+		buffer_.append(record);
+		appended();
+	}
+
+	// Write buffered records to the file, without fsyncing.
+	void flush() {
+		checkOpen();
+		if (buffer_.empty()) {
+			return;
+		}
+
+		// After a partial write, only the rest is retried
+		std::string_view rest = buffer_;
+		try {
+			detail::writeAll(fd_, rest, path_);
+		} catch (...) {
+			dropWritten(rest.size());
+			throw;
+		}
+		dropWritten(0);
+	}
+
+	// Write and fsync buffered records.
+	void sync() {
+		flush();
+		if (committed_ == written_) {
+			return;
+		}
+
+		detail::syncFd(fd_, path_);
+		committed_ = written_;
+		unsyncedRecords_ = 0;
+		syncs_ += 1;
+	}
+
+	void close() {
+		if (fd_ < 0) {
+			return;
+		}
+
+		sync();
+		if (opts_.checkpoint) {
+			writeCheckpoint();
+		}
+		::close(fd_);
+		fd_ = -1;
+	}
+
+	// The size of the log including buffered records.
+	std::uint64_t size() const {
+		return written_ + buffer_.size();
+	}
+
+	// The size of the log which is known to be durable.
+	std::uint64_t committed() const {
+		return committed_;
+	}
+
+	// The number of fsyncs done by the group commit policy, sync() and close().
+	std::uint64_t syncs() const {
+		return syncs_;
+	}
+
+	// What was found when the log was opened. Appending started
+	// at recovered().size, and truncated() bytes after it were dropped.
+	const LogScan &recovered() const {
+		return recovered_;
+	}
+
+	std::uint64_t truncated() const {
+		return truncated_;
+	}
+
+	// Where recovery started scanning: after the records of the checkpoint
+	// left by a clean close, or 0.
+	std::uint64_t scannedFrom() const {
+		return scannedFrom_;
+	}
+
+private:
+	void recover(bool created) {
+		struct stat st;
+		if (::fstat(fd_, &st) < 0) {
+			detail::throwErrno(path_);
+		}
+
+		if (st.st_size > 0) {
+			MappedSource mapped(path_.c_str());
+			LogScan checkpoint;
+			if (opts_.checkpoint) {
+				checkpoint = readCheckpoint(mapped.data());
+			}
+
+			recovered_ = scanRecords(mapped.data().substr((std::size_t)checkpoint.size));
+			if (recovered_.corrupt) {
+				throw ParseError("LogWriter: Corrupt record");
+			}
+
+			scannedFrom_ = checkpoint.size;
+			recovered_.size += checkpoint.size;
+			recovered_.records += checkpoint.records;
+		}
+
+		truncated_ = (std::uint64_t)st.st_size - recovered_.size;
+		if (truncated_ > 0) {
+			if (::ftruncate(fd_, (off_t)recovered_.size) < 0) {
+				detail::throwErrno(path_);
+			}
+			detail::syncFd(fd_, path_);
+		}
+
+		// A new file's directory entry must be durable too
+		if (created) {
+			std::string dir = path_.substr(0, path_.rfind('/') + 1);
+			int dirFd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (dirFd >= 0) {
+				::fsync(dirFd);
+				::close(dirFd);
+			}
+		}
+
+		written_ = committed_ = recovered_.size;
+	}
+
+	static constexpr std::size_t CHECKPOINT_TAIL = 64;
+
+	std::string checkpointPath() const {
+		return path_ + ".checkpoint";
+	}
+
+	// A checkpoint holds the size of the log and the number of records at
+	// a clean close, and the bytes before that size, which must still match.
+	// An unusable checkpoint is ignored, and the whole log is scanned.
+	LogScan readCheckpoint(std::string_view data) const {
+		MappedSource mapped;
+		if (mapped.open(checkpointPath().c_str()) != 0) {
+			return {};
+		}
+
+		LogScan checkpoint;
+		std::string tail;
+		Error err;
+		BufferReader(&mapped, &err).matchObject({
+			{"size", [&](BufferReader val) {
+				checkpoint.size = val.getUInt();
+			}},
+			{"records", [&](BufferReader val) {
+				checkpoint.records = val.getUInt();
+			}},
+			{"tail", [&](BufferReader val) {
+				val.readBinary([&](const unsigned char *bytes, std::size_t size) {
+					tail.append((const char *)bytes, size);
+				});
+			}},
+		});
+
+		if (err || checkpoint.size > data.size() ||
+				tail != checkpointTail(data.substr(0, (std::size_t)checkpoint.size))) {
+			return {};
+		}
+		return checkpoint;
+	}
+
+	// Written to a temporary file which replaces the old checkpoint,
+	// after the log has been synced. If that fails, the next open scans
+	// from the old checkpoint, which is still valid.
+	void writeCheckpoint() {
+		char tail[CHECKPOINT_TAIL];
+		auto tailSize = (std::size_t)std::min<std::uint64_t>(written_, CHECKPOINT_TAIL);
+		if (::pread(fd_, tail, tailSize, (off_t)(written_ - tailSize)) != (ssize_t)tailSize) {
+			return;
+		}
+
+		std::string encoded;
+		StringSink sink(&encoded);
+		StringWriter(&sink).writeObject([&](StringObjectWriter w) {
+			w.key("size").writeUInt(written_);
+			w.key("records").writeUInt(recovered_.records + appendedRecords_);
+			w.key("tail").writeBinary(tail, tailSize);
+		});
+
+		std::string tmp = checkpointPath() + ".tmp";
+		int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			return;
+		}
+
+		std::string_view rest = encoded;
+		try {
+			detail::writeAll(fd, rest, tmp);
+			detail::syncFd(fd, tmp);
+		} catch (std::system_error &) {
+			::close(fd);
+			::unlink(tmp.c_str());
+			return;
+		}
+
+		::close(fd);
+		if (::rename(tmp.c_str(), checkpointPath().c_str()) < 0) {
+			::unlink(tmp.c_str());
+		}
+	}
+
+	static std::string_view checkpointTail(std::string_view data) {
+		return data.substr(data.size() - std::min<std::size_t>(data.size(), CHECKPOINT_TAIL));
+	}
+
+	void dropWritten(std::size_t left) {
+		written_ += buffer_.size() - left;
+		buffer_.erase(0, buffer_.size() - left);
+	}
+
+	void checkOpen() {
+		if (fd_ < 0) {
+			throw LogicError();
+		}
+	}
+
+	void appended() {
+		auto now = std::chrono::steady_clock::now();
+		if (unsyncedRecords_ == 0) {
+			oldestUnsynced_ = now;
+		}
+		unsyncedRecords_ += 1;
+		appendedRecords_ += 1;
+
+		std::uint64_t unsyncedBytes = this->size() - committed_;
+		bool syncNow =
+			(opts_.syncRecords > 0 && unsyncedRecords_ >= opts_.syncRecords) ||
+			(opts_.syncBytes > 0 && unsyncedBytes >= opts_.syncBytes) ||
+			(opts_.syncInterval.count() > 0 && now - oldestUnsynced_ >= opts_.syncInterval);
+
+		if (syncNow) {
+			sync();
+		} else if (buffer_.size() >= opts_.bufferSize) {
+			flush();
+		}
+	}
+
+	std::string path_;
+	LogOptions opts_;
+	int fd_ = -1;
+
+	std::string buffer_;
+	StringStreamBuf buf_{&buffer_};
+	std::ostream os_{&buf_};
+
+	std::uint64_t written_ = 0;
+	std::uint64_t committed_ = 0;
+	std::uint64_t unsyncedRecords_ = 0;
+	std::uint64_t syncs_ = 0;
+	std::chrono::steady_clock::time_point oldestUnsynced_;
+
+	LogScan recovered_;
+	std::uint64_t truncated_ = 0;
+	std::uint64_t scannedFrom_ = 0;
+	std::uint64_t appendedRecords_ = 0;
+};
+
+// Reads the records of a log as they're appended.
+class LogTailer {
+public:
+	static constexpr std::size_t READ_SIZE = 64 * 1024;
+
+	// Start reading at 'offset', which must be a record boundary,
+	// like a previous LogTailer's offset().
+	explicit LogTailer(std::string path, std::uint64_t offset = 0):
+			path_(std::move(path)), offset_(offset) {
+		fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd_ < 0) {
+			detail::throwErrno(path_);
+		}
+	}
+
+	LogTailer(const LogTailer &) = delete;
+	LogTailer &operator=(const LogTailer &) = delete;
+
+	~LogTailer() {
+		::close(fd_);
+	}
+
+	// Call 'func(BufferReader r)' for each complete record which has been
+	// appended since the last poll, and return the number of records.
+	// A record which is still being written is left for the next poll,
+	// and so is a record which could be a torn one completed by zero fill.
+	// If 'func' throws, the record it threw on is delivered again by the next poll.
+	// Throws a ParseError if the log contains something which isn't a record.
+	template<typename Func>
+	std::uint64_t poll(Func func) {
+		readNew();
+
+		std::uint64_t count = 0;
+		std::size_t done = 0;
+		LogScan scan;
+		try {
+			scan = detail::scanRecords(pending_, [&](std::size_t start, std::size_t size) {
+				BufferSource record(std::string_view(pending_).substr(start, size));
+				func(BufferReader(&record));
+				done = start + size;
+				offset_ += size;
+				count += 1;
+			});
+		} catch (...) {
+			pending_.erase(0, done);
+			throw;
+		}
+
+		pending_.erase(0, done);
+		if (scan.corrupt) {
+			throw ParseError("LogTailer: Corrupt record");
+		}
+
+		// Zero fill is truncated away by a recovering writer, and the file
+		// can grow past it again before the next poll, so it's read again
+		if (!pending_.empty() && pending_.back() == '\0') {
+			pending_.clear();
+		}
+		return count;
+	}
+
+	// The offset after the last record delivered by poll().
+	std::uint64_t offset() const {
+		return offset_;
+	}
+
+private:
+	void readNew() {
+		struct stat st;
+		if (::fstat(fd_, &st) < 0) {
+			detail::throwErrno(path_);
+		}
+
+		// The partial record was truncated away by a recovering writer
+		std::uint64_t readPos = offset_ + pending_.size();
+		if ((std::uint64_t)st.st_size < readPos) {
+			pending_.clear();
+			readPos = offset_;
+		}
+
+		char buf[READ_SIZE];
+		while (readPos < (std::uint64_t)st.st_size) {
+			ssize_t n = ::pread(fd_, buf, sizeof(buf), (off_t)readPos);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			} else if (n < 0) {
+				detail::throwErrno(path_);
+			} else if (n == 0) {
+				break;
+			}
+
+			pending_.append(buf, (std::size_t)n);
+			readPos += (std::uint64_t)n;
+		}
+	}
+
+	std::string path_;
+	int fd_;
+	std::uint64_t offset_;
+	std::string pending_;
+};
+
+}
+
+#endif
+
+#endif
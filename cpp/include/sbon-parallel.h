@@ -0,0 +1,163 @@
+#ifndef SBON_PARALLEL_H
+#define SBON_PARALLEL_H
+
+#include "sbon.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sbon {
+
+// Write an array of 'count' elements, where 'func(Writer w, std::size_t i)'
+// writes element 'i'. Ranges of elements are encoded into separate buffers
+// on up to 'threads' threads (0 means one per CPU), and the buffers are
+// copied into the array in order as they complete. Workers stay at most
+// a few chunks ahead of the copying, which bounds the memory used.
+// 'func' is called concurrently, so it must be safe to call from several threads.
+// Like writeArray, 'w' can't be used until the array is done.
+// If 'w' has an Error, the chunk writers record errors in their own copy,
+// and the first one is recorded in 'w's Error.
+template<typename Func>
+inline void writeArrayParallel(Writer w, std::size_t count, Func func, unsigned threads = 0) {
+	static constexpr std::size_t CHUNKS_PER_THREAD = 4;
+	static constexpr std::size_t MIN_CHUNK_SIZE = 64;
+	static constexpr std::size_t CHUNKS_AHEAD_PER_THREAD = 2;
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::size_t chunkSize = std::max(
+		MIN_CHUNK_SIZE, (count + threads * CHUNKS_PER_THREAD - 1) / (threads * CHUNKS_PER_THREAD));
+	std::size_t chunks = (count + chunkSize - 1) / chunkSize;
+	threads = (unsigned)std::min<std::size_t>(threads, chunks);
+
+	Error *err = w.error();
+	if (threads <= 1 || (err && *err)) {
+		w.writeArray([&](Writer w) {
+			for (std::size_t i = 0; i < count; ++i) {
+				func(w, i);
+			}
+		});
+		return;
+	}
+
+	struct Chunk {
+		std::string encoded;
+		std::exception_ptr error;
+		Error err;
+		bool done = false;
+	};
+
+	std::vector<Chunk> results(chunks);
+	std::mutex mut;
+	std::condition_variable cond;
+	std::atomic<std::size_t> nextChunk{0};
+	bool cancelled = false;
+	std::size_t copied = 0;
+	std::size_t ahead = threads * CHUNKS_AHEAD_PER_THREAD;
+
+	auto work = [&] {
+		std::size_t c;
+		while ((c = nextChunk.fetch_add(1)) < chunks) {
+			{
+				std::unique_lock<std::mutex> lock(mut);
+				cond.wait(lock, [&] { return cancelled || c < copied + ahead; });
+				if (cancelled) {
+					return;
+				}
+			}
+
+			std::ostringstream os;
+			std::exception_ptr error;
+			Error chunkErr;
+			try {
+				Writer elem(&os, err ? &chunkErr : nullptr);
+				std::size_t end = std::min(count, (c + 1) * chunkSize);
+				for (std::size_t i = c * chunkSize; i < end && !chunkErr; ++i) {
+					func(elem, i);
+				}
+			} catch (...) {
+				error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(mut);
+			results[c].encoded = std::move(os).str();
+			results[c].error = error;
+			results[c].err = chunkErr;
+			results[c].done = true;
+			cond.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i) {
+		workers.emplace_back(work);
+	}
+
+	// The workers must be joined even if writing fails
+	std::exception_ptr error;
+	bool failed = false;
+	try {
+		w.writeArray([&](Writer arr) {
+			for (std::size_t c = 0; c < chunks && !failed; ++c) {
+				std::string encoded;
+				Error chunkErr;
+				{
+					std::unique_lock<std::mutex> lock(mut);
+					cond.wait(lock, [&] { return results[c].done; });
+					error = results[c].error;
+					chunkErr = results[c].err;
+					encoded = std::move(results[c].encoded);
+					copied = c + 1;
+					cond.notify_all();
+				}
+
+				if (error) {
+					failed = true;
+					break;
+				}
+
+				// The chunk's encoding up to the error is valid, like a serial writer's output.
+				// A sink which can't tell its position reports offset 0 before and after.
+				std::uint64_t start = chunkErr ? arr.offset() : 0;
+				arr.writeEncoded(encoded);
+				if (chunkErr) {
+					*err = chunkErr;
+					err->offset += start;
+					failed = true;
+				} else if (err && *err) {
+					failed = true;
+				}
+			}
+		});
+	} catch (...) {
+		error = std::current_exception();
+		failed = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mut);
+		cancelled = failed;
+		cond.notify_all();
+	}
+	for (auto &worker: workers) {
+		worker.join();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+}
+
+#endif
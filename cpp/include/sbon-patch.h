@@ -0,0 +1,217 @@
+#ifndef SBON_PATCH_H
+#define SBON_PATCH_H
+
+#include "sbon.h"
+#include "sbon-fixed.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace sbon {
+
+// The location of an encoded value within a buffer.
+struct ValueSpan {
+	std::size_t offset;
+	std::size_t size;
+	Type type;
+};
+
+// One step in a path: either an object key or an array index.
+class PathElement {
+public:
+	PathElement(const char *key): key_(key), isKey_(true) {}
+	PathElement(std::string_view key): key_(key), isKey_(true) {}
+	PathElement(std::size_t index): index_(index) {}
+	PathElement(int index): index_((std::size_t)index) {}
+
+	bool isKey() const {
+		return isKey_;
+	}
+
+	std::string_view key() const {
+		return key_;
+	}
+
+	std::size_t index() const {
+		return index_;
+	}
+
+private:
+	std::string_view key_;
+	std::size_t index_ = 0;
+	bool isKey_ = false;
+};
+
+namespace detail {
+
+inline ValueSpan spanHere(std::istream &is) {
+	std::size_t start = (std::size_t)is.tellg();
+	Reader r(&is);
+	Type type = r.getType();
+	r.skip();
+	return {start, (std::size_t)is.tellg() - start, type};
+}
+
+// Re-encode the integer in 'encoded' as exactly 'size' bytes,
+// using a padded LEB128 encoding.
+inline bool padInteger(std::string_view encoded, std::size_t size, char *out) {
+	if (encoded.empty() || size < 2) {
+		return false;
+	}
+
+	char sign = encoded[0];
+	std::uint64_t num;
+	if (sign >= '0' && sign <= '9') {
+		num = (std::uint64_t)(sign - '0');
+		sign = '+';
+	} else if (sign == '+' || sign == '-') {
+		num = 0;
+		std::size_t shift = 0;
+		for (std::size_t i = 1; i < encoded.size(); ++i) {
+			num |= (std::uint64_t)((unsigned char)encoded[i] & 0x7f) << shift;
+			shift += 7;
+		}
+	} else {
+		return false;
+	}
+
+	// Padding bytes past bit 63 would overflow readers' shifts
+	std::size_t lebSize = size - 1;
+	if (lebSize > 9 || (num >> (lebSize * 7)) != 0) {
+		return false;
+	}
+
+	out[0] = sign;
+	for (std::size_t i = 0; i < lebSize; ++i) {
+		unsigned char hi = i < lebSize - 1 ? 0x80 : 0;
+		out[i + 1] = (char)(hi | (unsigned char)(num & 0x7f));
+		num >>= 7;
+	}
+
+	return true;
+}
+
+}
+
+// Find the value at 'path' in the encoded document 'doc'.
+inline std::optional<ValueSpan> findValue(
+		std::string_view doc, std::initializer_list<PathElement> path) {
+	SpanIStream is(doc);
+
+	std::string key;
+	for (auto &elem: path) {
+		Type type = Reader(&is).getType();
+		if (elem.isKey()) {
+			if (type != Type::OBJECT) {
+				return std::nullopt;
+			}
+
+			is.get();
+			ObjectReader obj(&is);
+			bool found = false;
+			while (obj.hasNext()) {
+				Reader val = obj.next(key);
+				if (key == elem.key()) {
+					found = true;
+					break;
+				}
+
+				val.skip();
+			}
+
+			if (!found) {
+				return std::nullopt;
+			}
+		} else {
+			if (type != Type::ARRAY) {
+				return std::nullopt;
+			}
+
+			is.get();
+			ArrayReader arr(&is);
+			for (std::size_t i = 0; i < elem.index(); ++i) {
+				if (!arr.hasNext()) {
+					return std::nullopt;
+				}
+
+				arr.next().skip();
+			}
+
+			if (!arr.hasNext()) {
+				return std::nullopt;
+			}
+		}
+	}
+
+	return detail::spanHere(is);
+}
+
+// Get the span of the value which starts at 'offset' in 'doc',
+// for example a position recorded with tellg while reading.
+inline ValueSpan valueAt(std::string_view doc, std::size_t offset) {
+	SpanIStream is(doc);
+	is.seekg((std::streamoff)offset);
+	return detail::spanHere(is);
+}
+
+// Overwrite the value at 'span' with an already encoded value,
+// if the new encoding has exactly the same size. Integers are padded
+// to fit when their encoding is smaller than the old one.
+// Returns false, leaving 'doc' unchanged, if the new value doesn't fit.
+inline bool patchInPlace(std::span<char> doc, const ValueSpan &span, std::string_view encoded) {
+	if (span.offset + span.size > doc.size()) {
+		throw LogicError();
+	}
+
+	char *dest = doc.data() + span.offset;
+	if (encoded.size() == span.size) {
+		std::memcpy(dest, encoded.data(), encoded.size());
+		return true;
+	}
+
+	if ((span.type == Type::INT || span.type == Type::UINT) && encoded.size() < span.size) {
+		char padded[16];
+		if (span.size <= sizeof(padded) && detail::padInteger(encoded, span.size, padded)) {
+			std::memcpy(dest, padded, span.size);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Replace the value at 'span' with an already encoded value of any size.
+inline void splice(std::string &doc, const ValueSpan &span, std::string_view encoded) {
+	if (span.offset + span.size > doc.size()) {
+		throw LogicError();
+	}
+
+	doc.replace(span.offset, span.size, encoded);
+}
+
+// Replace the value at 'span' with the value written by 'func',
+// in place if it fits, and by splicing otherwise.
+// Returns true if the value was patched in place.
+template<typename Func>
+inline bool patch(std::string &doc, const ValueSpan &span, Func func) {
+	std::stringstream ss;
+	func(Writer(&ss));
+	std::string encoded = ss.str();
+
+	if (patchInPlace(doc, span, encoded)) {
+		return true;
+	}
+
+	splice(doc, span, encoded);
+	return false;
+}
+
+}
+
+#endif
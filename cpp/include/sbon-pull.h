@@ -0,0 +1,329 @@
+#ifndef SBON_PULL_H
+#define SBON_PULL_H
+
+#include "sbon.h"
+#include "sbon-io.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace sbon {
+
+// A serializer which produces output when asked for it, for writing
+// to non-blocking sockets without encoding the whole document first.
+// Arrays and objects are described by functions which are called
+// for one element at a time, as more output is needed:
+//
+//     sbon::PullWriter pw([&](sbon::PullWriter::Value v) {
+//         v.writeArray([&, i = 0](sbon::PullWriter::Value v) mutable {
+//             if (i == count) return false;
+//             v.writeUInt(i++);
+//             return true;
+//         });
+//     });
+//     while (!pw.done()) {
+//         std::size_t n = pw.fill(buf, sizeof(buf));
+//         send(fd, buf, n, 0);
+//     }
+//
+// Memory use is the stack of open containers plus the largest scalar,
+// since each string or binary is buffered whole until it's been emitted.
+// writeStringRef and writeBinaryRef refer to the caller's bytes instead,
+// and writeBinary(&is, length) reads a binary from a stream, both only
+// as fill() asks for more, so large values aren't buffered at all.
+// The element functions are kept until their container is closed,
+// so anything they capture by reference must outlive the PullWriter.
+class PullWriter {
+public:
+	class Value;
+	class ObjectValue;
+
+	// Write the next element to the Value and return true,
+	// or write nothing and return false to close the array.
+	using ArrayFunc = std::function<bool(Value)>;
+
+	// Write the next key and value and return true,
+	// or write nothing and return false to close the object.
+	using ObjectFunc = std::function<bool(ObjectValue)>;
+
+	class Value {
+	public:
+		void writeNull() {
+			scalar().writeNull();
+		}
+
+		void writeBool(bool b) {
+			scalar().writeBool(b);
+		}
+
+		void writeInt(std::int64_t num) {
+			scalar().writeInt(num);
+		}
+
+		void writeUInt(std::uint64_t num) {
+			scalar().writeUInt(num);
+		}
+
+		void writeFloat(float f) {
+			scalar().writeFloat(f);
+		}
+
+		void writeDouble(double d) {
+			scalar().writeDouble(d);
+		}
+
+		void writeString(std::string_view str) {
+			scalar().writeString(str);
+		}
+
+		void writeBinary(const void *data, std::size_t length) {
+			scalar().writeBinary(data, length);
+		}
+
+		void writeEncoded(std::string_view encoded) {
+			scalar().writeEncoded(encoded);
+		}
+
+		// Write a string or binary without copying it. The bytes must
+		// stay valid until fill() has emitted them.
+		void writeStringRef(std::string_view str) {
+			pw_->begin(Slot::VALUE);
+			detail::statWrite(Type::STRING);
+			pw_->pending_ += 'S';
+			str = str.substr(0, str.find('\0'));
+			pw_->setBody(str, nullptr, str.size(), true);
+		}
+
+		void writeBinaryRef(const void *data, std::size_t length) {
+			pw_->begin(Slot::VALUE);
+			detail::statWrite(Type::BINARY);
+			pw_->binaryHeader(length);
+			pw_->setBody(std::string_view((const char *)data, length), nullptr, length, false);
+		}
+
+		// Write a binary of 'length' bytes, which are read from 'is'
+		// as fill() needs them. Throws a LogicError from fill()
+		// if the stream ends early, like Writer::writeBinary.
+		void writeBinary(std::istream *is, std::uint64_t length) {
+			pw_->begin(Slot::VALUE);
+			detail::statWrite(Type::BINARY);
+			pw_->binaryHeader(length);
+			pw_->setBody({}, is, length, false);
+		}
+
+		void writeArray(ArrayFunc func) {
+			pw_->begin(Slot::VALUE);
+			pw_->pending_ += '[';
+			pw_->stack_.push_back(Frame{std::move(func), nullptr, ']'});
+		}
+
+		void writeObject(ObjectFunc func) {
+			pw_->begin(Slot::VALUE);
+			pw_->pending_ += '{';
+			pw_->stack_.push_back(Frame{nullptr, std::move(func), '}'});
+		}
+
+	private:
+		friend class PullWriter;
+		explicit Value(PullWriter *pw): pw_(pw) {}
+
+		Writer scalar() {
+			pw_->begin(Slot::VALUE);
+			return Writer(&pw_->os_);
+		}
+
+		PullWriter *pw_;
+	};
+
+	class ObjectValue {
+	public:
+		Value key(std::string_view key) {
+			pw_->begin(Slot::KEY);
+			auto nul = key.find('\0');
+			pw_->pending_ += key.substr(0, nul);
+			pw_->pending_ += '\0';
+			pw_->slot_ = Slot::VALUE;
+			return Value(pw_);
+		}
+
+	private:
+		friend class PullWriter;
+		explicit ObjectValue(PullWriter *pw): pw_(pw) {}
+
+		PullWriter *pw_;
+	};
+
+	// 'root' writes the top-level value; it's called on the first fill().
+	explicit PullWriter(std::function<void(Value)> root) {
+		stack_.push_back(Frame{
+			[root = std::move(root), called = false](Value v) mutable {
+				if (called) {
+					return false;
+				}
+				called = true;
+				root(v);
+				return true;
+			},
+			nullptr, '\0'});
+	}
+
+	PullWriter(const PullWriter &) = delete;
+	PullWriter &operator=(const PullWriter &) = delete;
+
+	// Write up to 'size' bytes to 'buf', and return the number of bytes written.
+	// Less than 'size' is only written once the document is done.
+	std::size_t fill(char *buf, std::size_t size) {
+		std::size_t written = 0;
+		while (written < size) {
+			if (pendingPos_ < pending_.size()) {
+				std::size_t n = std::min(size - written, pending_.size() - pendingPos_);
+				std::memcpy(buf + written, pending_.data() + pendingPos_, n);
+				written += n;
+				pendingPos_ += n;
+				continue;
+			}
+
+			pending_.clear();
+			pendingPos_ = 0;
+			if (hasBody_) {
+				written += fillBody(buf + written, size - written);
+				continue;
+			}
+
+			if (stack_.empty()) {
+				break;
+			}
+
+			step();
+		}
+
+		return written;
+	}
+
+	bool done() const {
+		return stack_.empty() && !hasBody_ && pendingPos_ == pending_.size();
+	}
+
+	// The number of open containers, including the top-level value.
+	std::size_t depth() const {
+		return stack_.size();
+	}
+
+private:
+	enum class Slot {
+		NONE,
+		VALUE,
+		KEY,
+	};
+
+	struct Frame {
+		ArrayFunc array;
+		ObjectFunc object;
+		char close;
+	};
+
+	void begin(Slot expected) {
+		if (slot_ != expected) {
+			throw LogicError();
+		}
+		slot_ = Slot::NONE;
+	}
+
+	void binaryHeader(std::uint64_t length) {
+		pending_ += 'B';
+		while (length >= 0x80) {
+			pending_ += (char)((length & 0x7f) | 0x80);
+			length >>= 7;
+		}
+		pending_ += (char)length;
+	}
+
+	// The value's bytes follow whatever is pending. A value ends its element,
+	// so there's at most one body at a time.
+	void setBody(std::string_view data, std::istream *is, std::uint64_t length, bool nul) {
+		bodyData_ = data;
+		bodyStream_ = is;
+		bodyLeft_ = length;
+		bodyNul_ = nul;
+		hasBody_ = true;
+	}
+
+	std::size_t fillBody(char *buf, std::size_t size) {
+		auto n = (std::size_t)std::min<std::uint64_t>(size, bodyLeft_);
+		if (bodyStream_) {
+			bodyStream_->read(buf, (std::streamsize)n);
+			if ((std::size_t)bodyStream_->gcount() < n) {
+				hasBody_ = false;
+				throw LogicError();
+			}
+		} else {
+			std::memcpy(buf, bodyData_.data(), n);
+			bodyData_.remove_prefix(n);
+		}
+
+		bodyLeft_ -= n;
+		if (bodyLeft_ == 0) {
+			hasBody_ = false;
+			if (bodyNul_) {
+				pending_ += '\0';
+			}
+		}
+		return n;
+	}
+
+	// Produce the next element of the innermost container, or close it.
+	// The stack is a deque, so the frame being called stays put
+	// if the element pushes a new container.
+	void step() {
+		Frame &frame = stack_.back();
+		Slot start = frame.array ? Slot::VALUE : Slot::KEY;
+		slot_ = start;
+
+		bool more;
+		try {
+			more = frame.array ? frame.array(Value(this)) : frame.object(ObjectValue(this));
+		} catch (...) {
+			slot_ = Slot::NONE;
+			throw;
+		}
+
+		Slot end = slot_;
+		slot_ = Slot::NONE;
+		if (more ? end != Slot::NONE : end != start) {
+			throw LogicError();
+		}
+
+		if (!more) {
+			if (frame.close) {
+				pending_ += frame.close;
+			}
+			stack_.pop_back();
+		}
+	}
+
+	std::deque<Frame> stack_;
+	std::string pending_;
+	std::size_t pendingPos_ = 0;
+	StringStreamBuf buf_{&pending_};
+	std::ostream os_{&buf_};
+	Slot slot_ = Slot::NONE;
+
+	bool hasBody_ = false;
+	std::string_view bodyData_;
+	std::istream *bodyStream_ = nullptr;
+	std::uint64_t bodyLeft_ = 0;
+	bool bodyNul_ = false;
+};
+
+}
+
+#endif
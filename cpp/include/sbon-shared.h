@@ -0,0 +1,352 @@
+#ifndef SBON_SHARED_H
+#define SBON_SHARED_H
+
+#include "sbon.h"
+#include "sbon-hash.h"
+#include "sbon-io.h"
+#include "sbon-patch.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// A read-only document which any number of threads can query at once.
+//
+// The buffer is validated when the document is created and never changes.
+// Each array or object gets a table of its elements' offsets (and a hash
+// table of keys for objects) the first time it's looked into. Tables are
+// published with a compare-and-swap, so readers never take a lock; when two
+// threads build the same table at once, one of them throws its copy away.
+
+namespace sbon {
+
+class SharedValue;
+
+namespace detail {
+
+struct SharedNode {
+	struct Entry {
+		std::string_view key;
+		std::size_t offset;
+		std::size_t size;
+		mutable std::atomic<SharedNode *> child{nullptr};
+	};
+
+	explicit SharedNode(std::size_t count): entries(new Entry[count]), count(count) {}
+
+	SharedNode(const SharedNode &) = delete;
+	SharedNode &operator=(const SharedNode &) = delete;
+
+	~SharedNode() {
+		for (std::size_t i = 0; i < count; ++i) {
+			delete entries[i].child.load(std::memory_order_relaxed);
+		}
+	}
+
+	std::size_t find(std::string_view key) const {
+		if (keys.empty()) {
+			for (std::size_t i = 0; i < count; ++i) {
+				if (entries[i].key == key) {
+					return i;
+				}
+			}
+			return NONE;
+		}
+
+		return keys.find(key);
+	}
+
+	// Small objects are searched linearly; larger ones get a hash table,
+	// where a repeated key keeps its first value
+	void index() {
+		if (count > 8) {
+			keys.build(count, [&](std::size_t i) {
+				return entries[i].key;
+			});
+		}
+	}
+
+	static constexpr std::size_t NONE = KeyTable::NONE;
+
+	std::unique_ptr<Entry[]> entries;
+	std::size_t count;
+	KeyTable keys;
+};
+
+}
+
+class SharedDocument {
+public:
+	// Takes ownership of the encoded document 'data', and validates its first value.
+	// Throws a ParseError if it's invalid.
+	explicit SharedDocument(std::string data): data_(std::move(data)) {
+		BufferSource src(data_);
+		BufferReader(&src).skip();
+		rootSize_ = (std::size_t)src.offset();
+	}
+
+	SharedDocument(const SharedDocument &) = delete;
+	SharedDocument &operator=(const SharedDocument &) = delete;
+
+	~SharedDocument() {
+		delete root_.load(std::memory_order_relaxed);
+	}
+
+	// The values refer to the document, so it must outlive them.
+	SharedValue root() const;
+
+	std::string_view data() const {
+		return data_;
+	}
+
+	// The number of arrays and objects which have been indexed so far.
+	std::size_t indexed() const {
+		return indexed_.load(std::memory_order_relaxed);
+	}
+
+private:
+	friend class SharedValue;
+
+	detail::SharedNode *node(std::size_t offset, std::atomic<detail::SharedNode *> *slot) const {
+		detail::SharedNode *node = slot->load(std::memory_order_acquire);
+		if (node) {
+			return node;
+		}
+
+		auto built = build(offset);
+		if (slot->compare_exchange_strong(
+				node, built.get(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+			indexed_.fetch_add(1, std::memory_order_relaxed);
+			return built.release();
+		}
+
+		// Another thread published its table first
+		return node;
+	}
+
+	std::unique_ptr<detail::SharedNode> build(std::size_t offset) const {
+		struct Found {
+			std::string_view key;
+			std::size_t offset;
+			std::size_t size;
+		};
+
+		std::vector<Found> found;
+		bool object = data_[offset] == '{';
+		char close = object ? '}' : ']';
+		BufferSource src(data_);
+		src.seek(offset + 1);
+		while (data_[(std::size_t)src.offset()] != close) {
+			std::string_view key;
+			if (object) {
+				auto start = (std::size_t)src.offset();
+				auto nul = data_.find('\0', start);
+				key = std::string_view(data_).substr(start, nul - start);
+				src.seek(nul + 1);
+			}
+
+			auto start = (std::size_t)src.offset();
+			BufferReader(&src).skip();
+			found.push_back(Found{key, start, (std::size_t)src.offset() - start});
+		}
+
+		auto node = std::make_unique<detail::SharedNode>(found.size());
+		for (std::size_t i = 0; i < found.size(); ++i) {
+			node->entries[i].key = found[i].key;
+			node->entries[i].offset = found[i].offset;
+			node->entries[i].size = found[i].size;
+		}
+
+		if (object) {
+			node->index();
+		}
+		return node;
+	}
+
+	std::string data_;
+	std::size_t rootSize_;
+	mutable std::atomic<detail::SharedNode *> root_{nullptr};
+	mutable std::atomic<std::size_t> indexed_{0};
+};
+
+// A handle to a value in a SharedDocument. It's cheap to copy,
+// and every method is safe to call from any number of threads.
+// Getters throw a ParseError when the value has a different type,
+// like the Reader's getters.
+class SharedValue {
+public:
+	Type type() const {
+		BufferSource src(encoded());
+		return BufferReader(&src).getType();
+	}
+
+	// The value's encoding, which points into the document.
+	std::string_view encoded() const {
+		return doc_->data().substr(offset_, size_);
+	}
+
+	bool isNull() const {
+		return encoded()[0] == 'N';
+	}
+
+	bool getBool() const {
+		BufferSource src(encoded());
+		return BufferReader(&src).getBool();
+	}
+
+	std::int64_t getInt() const {
+		BufferSource src(encoded());
+		return BufferReader(&src).getInt();
+	}
+
+	std::uint64_t getUInt() const {
+		BufferSource src(encoded());
+		return BufferReader(&src).getUInt();
+	}
+
+	float getFloat() const {
+		BufferSource src(encoded());
+		return BufferReader(&src).getFloat();
+	}
+
+	double getDouble() const {
+		BufferSource src(encoded());
+		return BufferReader(&src).getDouble();
+	}
+
+	// Strings and binaries point into the document, without copying.
+	std::string_view getString() const {
+		if (type() != Type::STRING) {
+			throw ParseError("getString: Expected 'S'");
+		}
+		return encoded().substr(1, size_ - 2);
+	}
+
+	std::string_view getBinary() const {
+		if (type() != Type::BINARY) {
+			throw ParseError("getBinary: Expected 'B'");
+		}
+
+		// The bytes follow the LEB128 length
+		std::size_t last = 1;
+		while (encoded()[last] & 0x80) {
+			last += 1;
+		}
+		return encoded().substr(last + 1);
+	}
+
+	// The number of elements of an array or entries of an object, and 0 otherwise.
+	std::size_t size() const {
+		auto *n = node();
+		return n ? n->count : 0;
+	}
+
+	// The value of 'key' in an object. If a key is repeated, its first value is found.
+	std::optional<SharedValue> find(std::string_view key) const {
+		auto *n = node();
+		if (!n || encoded()[0] != '{') {
+			return std::nullopt;
+		}
+
+		std::size_t i = n->find(key);
+		if (i == detail::SharedNode::NONE) {
+			return std::nullopt;
+		}
+		return child(n, i);
+	}
+
+	// The element at 'index' of an array, or the value of the entry at 'index' of an object.
+	std::optional<SharedValue> at(std::size_t index) const {
+		auto *n = node();
+		if (!n || index >= n->count) {
+			return std::nullopt;
+		}
+		return child(n, index);
+	}
+
+	// The key of the entry at 'index' of an object.
+	std::string_view keyAt(std::size_t index) const {
+		auto *n = node();
+		if (!n || index >= n->count) {
+			throw LogicError();
+		}
+		return n->entries[index].key;
+	}
+
+	std::optional<SharedValue> find(std::initializer_list<PathElement> path) const {
+		std::optional<SharedValue> val = *this;
+		for (auto &elem: path) {
+			if (elem.isKey()) {
+				val = val->find(elem.key());
+			} else if (val->encoded()[0] == '[') {
+				val = val->at(elem.index());
+			} else {
+				val = std::nullopt;
+			}
+
+			if (!val) {
+				break;
+			}
+		}
+		return val;
+	}
+
+	// Call 'func(SharedValue val)' for each element of an array,
+	// or 'func(std::string_view key, SharedValue val)' for each entry of an object.
+	template<typename Func>
+	void forEach(Func func) const {
+		auto *n = node();
+		if (!n) {
+			return;
+		}
+
+		for (std::size_t i = 0; i < n->count; ++i) {
+			if constexpr (std::is_invocable_v<Func, std::string_view, SharedValue>) {
+				func(n->entries[i].key, child(n, i));
+			} else {
+				func(child(n, i));
+			}
+		}
+	}
+
+private:
+	friend class SharedDocument;
+
+	SharedValue(
+			const SharedDocument *doc, std::size_t offset, std::size_t size,
+			std::atomic<detail::SharedNode *> *slot):
+		doc_(doc), offset_(offset), size_(size), slot_(slot) {}
+
+	const detail::SharedNode *node() const {
+		char ch = encoded()[0];
+		if (ch != '[' && ch != '{') {
+			return nullptr;
+		}
+		return doc_->node(offset_, slot_);
+	}
+
+	SharedValue child(const detail::SharedNode *n, std::size_t i) const {
+		auto &entry = n->entries[i];
+		return SharedValue(doc_, entry.offset, entry.size, &entry.child);
+	}
+
+	const SharedDocument *doc_;
+	std::size_t offset_;
+	std::size_t size_;
+	std::atomic<detail::SharedNode *> *slot_;
+};
+
+inline SharedValue SharedDocument::root() const {
+	return SharedValue(this, 0, rootSize_, &root_);
+}
+
+}
+
+#endif
@@ -0,0 +1,652 @@
+#ifndef SBON_SORT_H
+#define SBON_SORT_H
+
+#include "sbon.h"
+#include "sbon-hash.h"
+#include "sbon-io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+// External merge sort of SBON records by the value at a key path.
+//
+// The input is read into runs of raw record spans which fill the memory budget.
+// Each run is sorted in slices on several threads, which are merged as the run
+// is written to a temporary file. The runs are then merged into the output.
+// The sort is stable, so records with equivalent keys keep their input order.
+
+namespace sbon {
+
+// The value at the sort path of a record. Values are ordered by kind first:
+// records without the path come first, then null, false, true,
+// numbers, strings, binaries, and finally arrays and objects.
+// Numbers are compared by their mathematical value, so 3, 3.0 and 3.0f
+// are equivalent, and NaN is greater than every other number.
+// Strings and binaries are compared bytewise, and arrays and objects
+// by their encoded bytes.
+struct SortKey {
+	enum Kind: unsigned char {
+		MISSING,
+		NIL,
+		FALSE,
+		TRUE,
+		NUMBER,
+		STRING,
+		BINARY,
+		OTHER,
+	};
+
+	Kind kind = MISSING;
+	detail::CanonicalNumber num{};
+
+	// The contents of a string or binary, or the encoded array or object.
+	// It points into the record.
+	std::string_view bytes;
+};
+
+namespace detail {
+
+inline int compareIntegers(const CanonicalNumber &a, const CanonicalNumber &b) {
+	if (a.negative != b.negative) {
+		return a.negative ? -1 : 1;
+	} else if (a.bits == b.bits) {
+		return 0;
+	}
+
+	// A larger magnitude is a smaller negative number
+	return (a.bits < b.bits) != a.negative ? -1 : 1;
+}
+
+// 'b' isn't integral, which means it's a fraction, out of range, infinite or NaN.
+inline int compareIntegerDouble(const CanonicalNumber &a, const CanonicalNumber &b) {
+	double d = std::bit_cast<double>(b.bits);
+	if (std::isnan(d) || d >= 18446744073709551616.0) {
+		return -1;
+	} else if (d < -9223372036854775808.0) {
+		return 1;
+	}
+
+	// 'd' has a fractional part, so it's greater than its floor
+	return compareIntegers(a, CanonicalNumber::fromDouble(std::floor(d))) <= 0 ? -1 : 1;
+}
+
+inline int compareNumbers(const CanonicalNumber &a, const CanonicalNumber &b) {
+	if (a.integral && b.integral) {
+		return compareIntegers(a, b);
+	} else if (a.integral) {
+		return compareIntegerDouble(a, b);
+	} else if (b.integral) {
+		return -compareIntegerDouble(b, a);
+	}
+
+	double x = std::bit_cast<double>(a.bits);
+	double y = std::bit_cast<double>(b.bits);
+	if (std::isnan(x) || std::isnan(y)) {
+		return (int)std::isnan(x) - (int)std::isnan(y);
+	}
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+inline int compareBytes(std::string_view a, std::string_view b) {
+	int c = a.compare(b);
+	return c < 0 ? -1 : c > 0 ? 1 : 0;
+}
+
+inline std::uint64_t decodeLength(std::string_view data) {
+	std::uint64_t num = 0;
+	for (std::size_t i = 0; i < data.size() && i < 10; ++i) {
+		num |= (std::uint64_t)(data[i] & 0x7f) << (i * 7);
+		if (!(data[i] & 0x80)) {
+			break;
+		}
+	}
+	return num;
+}
+
+inline void readSortKey(BufferSource &src, BufferReader r, std::string_view record, SortKey &key) {
+	auto start = (std::size_t)src.offset();
+	switch (r.getType()) {
+	case Type::NIL:
+		r.getNil();
+		key.kind = SortKey::NIL;
+		break;
+
+	case Type::BOOL:
+		key.kind = r.getBool() ? SortKey::TRUE : SortKey::FALSE;
+		break;
+
+	case Type::INT:
+		key.kind = SortKey::NUMBER;
+		key.num = CanonicalNumber::fromInt(r.getInt());
+		break;
+
+	case Type::UINT:
+		key.kind = SortKey::NUMBER;
+		key.num = CanonicalNumber::fromUInt(r.getUInt());
+		break;
+
+	case Type::FLOAT:
+		key.kind = SortKey::NUMBER;
+		key.num = CanonicalNumber::fromDouble(r.getFloat());
+		break;
+
+	case Type::DOUBLE:
+		key.kind = SortKey::NUMBER;
+		key.num = CanonicalNumber::fromDouble(r.getDouble());
+		break;
+
+	case Type::STRING:
+		r.skipString();
+		key.kind = SortKey::STRING;
+		key.bytes = record.substr(start + 1, (std::size_t)src.offset() - start - 2);
+		break;
+
+	case Type::BINARY: {
+		r.skipBinary();
+		auto end = (std::size_t)src.offset();
+		auto length = (std::size_t)decodeLength(record.substr(start + 1));
+		key.kind = SortKey::BINARY;
+		key.bytes = record.substr(end - length, length);
+		break;
+	}
+
+	case Type::ARRAY:
+	case Type::OBJECT:
+		r.skip();
+		key.kind = SortKey::OTHER;
+		key.bytes = record.substr(start, (std::size_t)src.offset() - start);
+		break;
+	}
+}
+
+inline void findSortKey(
+		BufferSource &src, BufferReader r, std::string_view record,
+		const std::vector<std::string> &path, std::size_t depth,
+		std::string &scratch, SortKey &key) {
+	if (depth == path.size()) {
+		readSortKey(src, r, record, key);
+		return;
+	} else if (r.getType() != Type::OBJECT) {
+		r.skip();
+		return;
+	}
+
+	bool found = false;
+	r.readObject([&](const std::string &name, BufferReader val) {
+		if (!found && name == path[depth]) {
+			found = true;
+			findSortKey(src, val, record, path, depth + 1, scratch, key);
+		} else {
+			val.skip();
+		}
+	}, scratch);
+}
+
+}
+
+inline int compareSortKeys(const SortKey &a, const SortKey &b) {
+	if (a.kind != b.kind) {
+		return a.kind < b.kind ? -1 : 1;
+	}
+
+	switch (a.kind) {
+	case SortKey::NUMBER:
+		return detail::compareNumbers(a.num, b.num);
+	case SortKey::STRING:
+	case SortKey::BINARY:
+	case SortKey::OTHER:
+		return detail::compareBytes(a.bytes, b.bytes);
+	default:
+		return 0;
+	}
+}
+
+// Split a dot-separated path like "user.id" into its keys.
+// The empty path sorts by the whole record.
+inline std::vector<std::string> parseSortPath(std::string_view path) {
+	std::vector<std::string> keys;
+	while (!path.empty()) {
+		auto dot = path.find('.');
+		keys.emplace_back(path.substr(0, dot));
+		path.remove_prefix(dot == path.npos ? path.size() : dot + 1);
+	}
+	return keys;
+}
+
+// Find the value at 'path' in an encoded record.
+// Throws a ParseError if the record is invalid.
+inline SortKey sortKey(std::string_view record, const std::vector<std::string> &path) {
+	SortKey key;
+	std::string scratch;
+	BufferSource src(record);
+	detail::findSortKey(src, BufferReader(&src), record, path, 0, scratch, key);
+	return key;
+}
+
+struct SortOptions {
+	// The keys of the path to sort by, see parseSortPath()
+	std::vector<std::string> path;
+	bool descending = false;
+
+	// The input is one top-level array instead of concatenated records,
+	// and so is the output
+	bool array = false;
+
+	// Roughly the most memory to use for records. A record which is larger
+	// than the budget still gets sorted, as a run of its own.
+	std::size_t memoryBudget = 256 * 1024 * 1024;
+
+	// Threads to sort each run on; 0 means one per CPU
+	unsigned threads = 0;
+
+	// Where runs are spilled to; empty means the system's temporary directory
+	std::filesystem::path tempDir;
+};
+
+struct SortStats {
+	std::uint64_t records = 0;
+	std::uint64_t runs = 0;
+	std::uint64_t mergePasses = 0;
+};
+
+namespace detail {
+
+// Reads complete records from a stream through a growing buffer.
+// The record returned by next() is valid until the next call.
+class RecordBuffer {
+public:
+	RecordBuffer(std::istream *is, std::size_t readSize, bool array):
+		is_(is), readSize_(readSize), array_(array) {}
+
+	bool next(std::string_view &record) {
+		while (true) {
+			std::string_view data = std::string_view(buf_).substr(pos_);
+			if (array_ && !data.empty()) {
+				if (!started_) {
+					if (data[0] != '[') {
+						throw ParseError("sortRecords: Expected '['");
+					}
+					started_ = true;
+					pos_ += 1;
+					continue;
+				} else if (data[0] == ']') {
+					return false;
+				}
+			}
+
+			if (!data.empty()) {
+				BufferSource src(data);
+				Error err;
+				BufferReader(&src, &err).skip();
+				if (!err) {
+					auto size = (std::size_t)src.offset();
+					record = data.substr(0, size);
+					pos_ += size;
+					return true;
+				} else if (err.code != ErrorCode::UNEXPECTED_EOF || eof_) {
+					throw ParseError(err.message);
+				}
+			} else if (eof_) {
+				if (array_) {
+					throw ParseError("sortRecords: Unexpected EOF");
+				}
+				return false;
+			}
+
+			fill();
+		}
+	}
+
+private:
+	// Read at least as much as is buffered, so a large record
+	// is only rescanned a logarithmic number of times
+	void fill() {
+		buf_.erase(0, pos_);
+		pos_ = 0;
+
+		std::size_t have = buf_.size();
+		std::size_t want = std::max(readSize_, have);
+		buf_.resize(have + want);
+		is_->read(buf_.data() + have, (std::streamsize)want);
+		auto got = (std::size_t)is_->gcount();
+		buf_.resize(have + got);
+		if (got < want) {
+			eof_ = true;
+		}
+	}
+
+	std::istream *is_;
+	std::size_t readSize_;
+	bool array_;
+	bool started_ = false;
+	bool eof_ = false;
+	std::string buf_;
+	std::size_t pos_ = 0;
+};
+
+class TempFile {
+public:
+	explicit TempFile(const std::filesystem::path &dir) {
+		static std::atomic<std::uint64_t> counter;
+		std::random_device rd;
+		std::uint64_t id = ((std::uint64_t)rd() << 32) ^ rd();
+		path_ = dir / ("sbon-sort-" + std::to_string(id) + "-" + std::to_string(counter++));
+
+		std::ofstream os(path_, std::ios::binary | std::ios::trunc);
+		if (!os) {
+			throw std::system_error(errno, std::generic_category(), path_.string());
+		}
+	}
+
+	TempFile(const TempFile &) = delete;
+	TempFile &operator=(const TempFile &) = delete;
+
+	~TempFile() {
+		std::error_code ec;
+		std::filesystem::remove(path_, ec);
+	}
+
+	const std::filesystem::path &path() const {
+		return path_;
+	}
+
+private:
+	std::filesystem::path path_;
+};
+
+struct SortEntry {
+	SortKey key;
+	std::size_t offset;
+	std::size_t size;
+};
+
+// Merges sorted sources, where ties go to the source with the lowest index.
+// 'next(i, entry)' fetches the next entry of source 'i'.
+template<typename Next, typename Emit>
+void mergeSorted(std::size_t count, bool descending, Next next, Emit emit) {
+	struct Head {
+		SortKey key;
+		std::string_view record;
+		std::size_t source;
+	};
+
+	auto after = [descending](const Head &a, const Head &b) {
+		int c = compareSortKeys(a.key, b.key);
+		if (descending) {
+			c = -c;
+		}
+		return c > 0 || (c == 0 && a.source > b.source);
+	};
+
+	std::priority_queue<Head, std::vector<Head>, decltype(after)> heap(after);
+	for (std::size_t i = 0; i < count; ++i) {
+		Head head{{}, {}, i};
+		if (next(i, head.key, head.record)) {
+			heap.push(head);
+		}
+	}
+
+	while (!heap.empty()) {
+		Head head = heap.top();
+		heap.pop();
+		emit(head.record);
+		if (next(head.source, head.key, head.record)) {
+			heap.push(head);
+		}
+	}
+}
+
+class Sorter {
+public:
+	Sorter(const SortOptions &opts, SortStats &stats):
+			opts_(opts), stats_(stats) {
+		threads_ = opts_.threads > 0 ? opts_.threads : std::max(1u, std::thread::hardware_concurrency());
+		tempDir_ = opts_.tempDir.empty() ? std::filesystem::temp_directory_path() : opts_.tempDir;
+	}
+
+	void sort(std::istream *in, std::ostream *out) {
+		RecordBuffer input(in, INPUT_READ_SIZE, opts_.array);
+		std::string_view record;
+		while (input.next(record)) {
+			entries_.push_back(SortEntry{{}, arena_.size(), record.size()});
+			arena_.append(record);
+			stats_.records += 1;
+			if (arena_.size() + entries_.size() * sizeof(SortEntry) >= opts_.memoryBudget) {
+				spill();
+			}
+		}
+
+		// Everything fit in memory, so nothing has to go through a file
+		if (runs_.empty()) {
+			stats_.runs = entries_.empty() ? 0 : 1;
+			output(out, [&](auto emit) {
+				sortRun(emit);
+			});
+			return;
+		}
+
+		if (!entries_.empty()) {
+			spill();
+		}
+		stats_.runs = runs_.size();
+
+		while (runs_.size() > MAX_FAN_IN) {
+			mergePass();
+		}
+
+		output(out, [&](auto emit) {
+			mergeRuns(runs_, emit);
+		});
+	}
+
+private:
+	static constexpr std::size_t MAX_FAN_IN = 64;
+	static constexpr std::size_t MIN_READ_SIZE = 64 * 1024;
+	static constexpr std::size_t INPUT_READ_SIZE = 1024 * 1024;
+
+	template<typename Func>
+	void output(std::ostream *out, Func func) {
+		auto emit = [out](std::string_view record) {
+			out->write(record.data(), (std::streamsize)record.size());
+		};
+
+		if (opts_.array) {
+			out->put('[');
+			func(emit);
+			out->put(']');
+		} else {
+			func(emit);
+		}
+	}
+
+	// Each of 'sources' streams gets an equal share of the budget to read through
+	std::size_t readSize(std::size_t sources) {
+		return std::max(MIN_READ_SIZE, opts_.memoryBudget / (sources + 1));
+	}
+
+	// Find the keys of the run and sort it in one slice per thread,
+	// then merge the slices.
+	template<typename Emit>
+	void sortRun(Emit emit) {
+		std::size_t count = entries_.size();
+		std::size_t slices = std::min<std::size_t>(threads_, std::max<std::size_t>(1, count / 1024));
+		std::vector<std::size_t> bounds;
+		for (std::size_t i = 0; i <= slices; ++i) {
+			bounds.push_back(count * i / slices);
+		}
+
+		auto sortSlice = [&](std::size_t slice) {
+			std::string scratch;
+			auto begin = entries_.begin() + (std::ptrdiff_t)bounds[slice];
+			auto end = entries_.begin() + (std::ptrdiff_t)bounds[slice + 1];
+			for (auto it = begin; it != end; ++it) {
+				std::string_view record(arena_.data() + it->offset, it->size);
+				BufferSource src(record);
+				findSortKey(src, BufferReader(&src), record, opts_.path, 0, scratch, it->key);
+			}
+
+			std::stable_sort(begin, end, [this](const SortEntry &a, const SortEntry &b) {
+				int c = compareSortKeys(a.key, b.key);
+				return opts_.descending ? c > 0 : c < 0;
+			});
+		};
+
+		std::vector<std::thread> workers;
+		std::exception_ptr error;
+		std::mutex errorMut;
+		for (std::size_t i = 1; i < slices; ++i) {
+			workers.emplace_back([&, i] {
+				try {
+					sortSlice(i);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(errorMut);
+					error = std::current_exception();
+				}
+			});
+		}
+
+		try {
+			sortSlice(0);
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(errorMut);
+			error = std::current_exception();
+		}
+
+		for (auto &worker: workers) {
+			worker.join();
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		std::vector<std::size_t> cursors(bounds.begin(), bounds.end() - 1);
+		mergeSorted(slices, opts_.descending,
+			[&](std::size_t slice, SortKey &key, std::string_view &record) {
+				if (cursors[slice] == bounds[slice + 1]) {
+					return false;
+				}
+				SortEntry &entry = entries_[cursors[slice]++];
+				key = entry.key;
+				record = std::string_view(arena_.data() + entry.offset, entry.size);
+				return true;
+			},
+			emit);
+	}
+
+	void spill() {
+		auto run = std::make_unique<TempFile>(tempDir_);
+		std::ofstream os(run->path(), std::ios::binary);
+		sortRun([&](std::string_view record) {
+			os.write(record.data(), (std::streamsize)record.size());
+		});
+
+		os.close();
+		if (!os) {
+			throw std::system_error(errno, std::generic_category(), run->path().string());
+		}
+
+		runs_.push_back(std::move(run));
+		arena_.clear();
+		entries_.clear();
+	}
+
+	template<typename Emit>
+	void mergeRuns(std::vector<std::unique_ptr<TempFile>> &runs, Emit emit) {
+		std::vector<std::ifstream> streams;
+		std::vector<RecordBuffer> inputs;
+		streams.reserve(runs.size());
+		inputs.reserve(runs.size());
+		for (auto &run: runs) {
+			streams.emplace_back(run->path(), std::ios::binary);
+			if (!streams.back()) {
+				throw std::system_error(errno, std::generic_category(), run->path().string());
+			}
+			inputs.emplace_back(&streams.back(), readSize(runs.size()), false);
+		}
+
+		std::string scratch;
+		mergeSorted(runs.size(), opts_.descending,
+			[&](std::size_t i, SortKey &key, std::string_view &record) {
+				if (!inputs[i].next(record)) {
+					return false;
+				}
+				key = SortKey();
+				BufferSource src(record);
+				findSortKey(src, BufferReader(&src), record, opts_.path, 0, scratch, key);
+				return true;
+			},
+			emit);
+	}
+
+	// Merge groups of consecutive runs, which keeps the sort stable
+	void mergePass() {
+		std::vector<std::unique_ptr<TempFile>> merged;
+		for (std::size_t i = 0; i < runs_.size(); i += MAX_FAN_IN) {
+			std::size_t end = std::min(runs_.size(), i + MAX_FAN_IN);
+			std::vector<std::unique_ptr<TempFile>> group;
+			for (std::size_t j = i; j < end; ++j) {
+				group.push_back(std::move(runs_[j]));
+			}
+
+			auto run = std::make_unique<TempFile>(tempDir_);
+			std::ofstream os(run->path(), std::ios::binary);
+			mergeRuns(group, [&](std::string_view record) {
+				os.write(record.data(), (std::streamsize)record.size());
+			});
+
+			os.close();
+			if (!os) {
+				throw std::system_error(errno, std::generic_category(), run->path().string());
+			}
+			merged.push_back(std::move(run));
+		}
+
+		runs_ = std::move(merged);
+		stats_.mergePasses += 1;
+	}
+
+	const SortOptions &opts_;
+	SortStats &stats_;
+	unsigned threads_;
+	std::filesystem::path tempDir_;
+
+	std::string arena_;
+	std::vector<SortEntry> entries_;
+	std::vector<std::unique_ptr<TempFile>> runs_;
+};
+
+}
+
+// Sort the records of 'in' by the value at opts.path, and write them to 'out'.
+// Throws a ParseError if the input isn't a stream of valid records
+// (or one array, with opts.array), and std::system_error if a run
+// can't be spilled to a temporary file.
+inline SortStats sortRecords(std::istream *in, std::ostream *out, const SortOptions &opts = {}) {
+	SortStats stats;
+	detail::Sorter(opts, stats).sort(in, out);
+	return stats;
+}
+
+}
+
+#endif
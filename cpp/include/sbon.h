@@ -1,15 +1,31 @@
 #ifndef SBON_H
 #define SBON_H
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstddef>
 #include <iostream>
 #include <limits>
+#include <memory_resource>
 #include <cstring>
 #include <cstdint>
+#include <cstdlib>
+#include <concepts>
 #include <exception>
+#include <span>
 #include <string_view>
 #include <vector>
 #include <string>
+#include <type_traits>
+
+// Without exceptions, errors which would have thrown abort instead,
+// unless the reader or writer was given an Error to record them in.
+#if defined(__cpp_exceptions) && !defined(SBON_NO_EXCEPTIONS)
+#define SBON_THROW(ex) throw ex
+#else
+#define SBON_THROW(ex) std::abort()
+#endif
 
 namespace sbon {
 
@@ -20,64 +36,475 @@ public:
 	}
 };
 
+// The message is kept in a fixed-size buffer,
+// so that rejecting malformed input never allocates.
 class ParseError: public std::exception {
 public:
 	ParseError(const char *str) {
-		str_ = "SBON parse error: ";
-		str_ += str;
+		static constexpr char prefix[] = "SBON parse error: ";
+		std::size_t prefixLen = sizeof(prefix) - 1;
+		std::size_t len = std::strlen(str);
+		if (len > sizeof(str_) - prefixLen - 1) {
+			len = sizeof(str_) - prefixLen - 1;
+		}
+
+		std::memcpy(str_, prefix, prefixLen);
+		std::memcpy(str_ + prefixLen, str, len);
+		str_[prefixLen + len] = '\0';
 	}
 
 	const char *what() const noexcept override {
-		return str_.c_str();
+		return str_;
+	}
+
+private:
+	char str_[128];
+};
+
+enum class ErrorCode {
+	NONE,
+	UNEXPECTED_EOF,
+	UNEXPECTED_CHARACTER,
+	UNREPRESENTABLE_NUMBER,
+	TOO_LONG,
+	LOGIC,
+};
+
+// Sticky error state for parsing and writing without exceptions.
+// A Reader or Writer constructed with a pointer to an Error records
+// the first error in it instead of throwing. After that, every
+// operation on it and its children does nothing, getters return zero
+// or partially read values and hasNext() returns false.
+// The offset is the stream position where the error was detected,
+// or 0 if the stream doesn't support tellg/tellp.
+struct Error {
+	ErrorCode code = ErrorCode::NONE;
+	const char *message = "";
+	std::uint64_t offset = 0;
+
+	explicit operator bool() const {
+		return code != ErrorCode::NONE;
+	}
+};
+
+// A string with a fixed capacity of N characters, which never allocates.
+// Reading a string or key which doesn't fit into one is an error
+// (ErrorCode::TOO_LONG).
+template<std::size_t N>
+class FixedString {
+public:
+	static constexpr std::size_t capacity() {
+		return N;
+	}
+
+	std::size_t size() const {
+		return size_;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	const char *data() const {
+		return buf_;
+	}
+
+	const char *c_str() const {
+		return buf_;
+	}
+
+	void clear() {
+		size_ = 0;
+		buf_[0] = '\0';
+	}
+
+	// Returns false if the string is full.
+	bool push_back(char ch) {
+		if (size_ >= N) {
+			return false;
+		}
+
+		buf_[size_++] = ch;
+		buf_[size_] = '\0';
+		return true;
+	}
+
+	operator std::string_view() const {
+		return std::string_view(buf_, size_);
+	}
+
+	bool operator==(std::string_view other) const {
+		return std::string_view(*this) == other;
+	}
+
+private:
+	char buf_[N + 1] = {};
+	std::size_t size_ = 0;
+};
+
+enum class Type {
+	BOOL,
+	NIL,
+	STRING,
+	BINARY,
+	FLOAT,
+	DOUBLE,
+	INT,
+	UINT,
+	ARRAY,
+	OBJECT,
+};
+
+// Readers and writers are templates over where their bytes come from
+// and go to, accessed through these traits, so that the byte operations
+// on the hot path can be inlined for each kind of source or sink.
+// Reader and Writer read from std::istream and write to std::ostream;
+// other sources and sinks are in sbon-io.h.
+//
+// By default, a source type has these members:
+//     int get();      // Consume a byte, or return EOF
+//     int peek();     // Look at the next byte, or return EOF
+//     std::size_t read(char *buf, std::size_t size);
+//     std::uint64_t offset();
+// and a sink type has:
+//     void put(char ch);
+//     void write(const char *data, std::size_t size);
+//     std::uint64_t offset();
+// The offsets are only used in error messages.
+template<typename Source>
+struct SourceTraits {
+	static int get(Source *src) {
+		return src->get();
+	}
+
+	static int peek(Source *src) {
+		return src->peek();
+	}
+
+	static std::size_t read(Source *src, char *buf, std::size_t size) {
+		return src->read(buf, size);
 	}
 
+	static std::uint64_t offset(Source *src) {
+		return src->offset();
+	}
+};
+
+template<>
+struct SourceTraits<std::istream> {
+	static int get(std::istream *is) {
+		return is->get();
+	}
+
+	static int peek(std::istream *is) {
+		return is->peek();
+	}
+
+	static std::size_t read(std::istream *is, char *buf, std::size_t size) {
+		is->read(buf, (std::streamsize)size);
+		return (std::size_t)is->gcount();
+	}
+
+	static std::uint64_t offset(std::istream *is) {
+		auto state = is->rdstate();
+		is->clear();
+		std::streamoff pos = is->tellg();
+		is->setstate(state);
+		return pos < 0 ? 0 : (std::uint64_t)pos;
+	}
+};
+
+template<typename Sink>
+struct SinkTraits {
+	static constexpr void put(Sink *sink, char ch) {
+		sink->put(ch);
+	}
+
+	static constexpr void write(Sink *sink, const char *data, std::size_t size) {
+		sink->write(data, size);
+	}
+
+	static constexpr std::uint64_t offset(Sink *sink) {
+		return sink->offset();
+	}
+};
+
+template<>
+struct SinkTraits<std::ostream> {
+	static void put(std::ostream *os, char ch) {
+		os->put(ch);
+	}
+
+	static void write(std::ostream *os, const char *data, std::size_t size) {
+		os->write(data, (std::streamsize)size);
+	}
+
+	static std::uint64_t offset(std::ostream *os) {
+		std::streamoff pos = os->tellp();
+		return pos < 0 ? 0 : (std::uint64_t)pos;
+	}
+};
+
+template<typename Source>
+concept ByteSource = requires(Source *src, char *buf, std::size_t size) {
+	{ SourceTraits<Source>::get(src) } -> std::same_as<int>;
+	{ SourceTraits<Source>::peek(src) } -> std::same_as<int>;
+	{ SourceTraits<Source>::read(src, buf, size) } -> std::same_as<std::size_t>;
+	{ SourceTraits<Source>::offset(src) } -> std::same_as<std::uint64_t>;
+};
+
+template<typename Sink>
+concept ByteSink = requires(Sink *sink, const char *data, std::size_t size) {
+	SinkTraits<Sink>::put(sink, 'a');
+	SinkTraits<Sink>::write(sink, data, size);
+	{ SinkTraits<Sink>::offset(sink) } -> std::same_as<std::uint64_t>;
+};
+
+// Parse statistics. The counters are only updated when the library
+// is compiled with SBON_STATS defined, and only for the threads which
+// have a StatsScope active. Without SBON_STATS, all hooks compile to nothing.
+// SBON_STATS must be defined the same way in every translation unit.
+struct Stats {
+	static constexpr std::size_t TYPES = (std::size_t)Type::OBJECT + 1;
+
+	// Bytes read per value type. Arrays and objects only count their
+	// delimiters; object keys are counted separately in 'keyBytes'.
+	std::uint64_t bytes[TYPES] = {};
+	std::uint64_t keyBytes = 0;
+	std::uint64_t bytesRead = 0;
+	std::uint64_t bytesSkipped = 0;
+
+	std::uint64_t valuesDecoded = 0;
+	std::uint64_t valuesSkipped = 0;
+	std::uint64_t valuesWritten[TYPES] = {};
+
+	std::uint64_t matchHits = 0;
+	std::uint64_t matchMisses = 0;
+
+	std::size_t depth = 0;
+	std::size_t maxDepth = 0;
+	std::size_t skipDepth = 0;
+
+	// Buffer growth in getString, getBinary and ObjectReader::next
+	std::uint64_t allocations = 0;
+	std::uint64_t allocatedBytes = 0;
+};
+
+namespace detail {
+
+#ifdef SBON_STATS
+inline thread_local Stats *currentStats = nullptr;
+#endif
+
+}
+
+class StatsScope {
+public:
+#ifdef SBON_STATS
+	explicit StatsScope(Stats &stats): prev_(detail::currentStats) {
+		detail::currentStats = &stats;
+	}
+
+	~StatsScope() {
+		detail::currentStats = prev_;
+	}
+#else
+	explicit StatsScope(Stats &) {}
+#endif
+
+	StatsScope(const StatsScope &) = delete;
+	StatsScope &operator=(const StatsScope &) = delete;
+
 private:
-	std::string str_;
+#ifdef SBON_STATS
+	Stats *prev_;
+#endif
+};
+
+namespace detail {
+
+#ifdef SBON_STATS
+inline void statByte(std::uint64_t n = 1) {
+	if (currentStats) {
+		currentStats->bytesRead += n;
+		if (currentStats->skipDepth > 0) {
+			currentStats->bytesSkipped += n;
+		}
+	}
+}
+
+inline std::uint64_t statMark() {
+	return currentStats ? currentStats->bytesRead : 0;
+}
+
+inline void statValue(Type type, std::uint64_t mark) {
+	if (currentStats) {
+		currentStats->bytes[(std::size_t)type] += currentStats->bytesRead - mark;
+		if (currentStats->skipDepth > 0) {
+			currentStats->valuesSkipped += 1;
+		} else {
+			currentStats->valuesDecoded += 1;
+		}
+	}
+}
+
+inline void statKey(std::uint64_t mark) {
+	if (currentStats) {
+		currentStats->keyBytes += currentStats->bytesRead - mark;
+	}
+}
+
+inline void statMatch(bool hit) {
+	if (currentStats) {
+		if (hit) {
+			currentStats->matchHits += 1;
+		} else {
+			currentStats->matchMisses += 1;
+		}
+	}
+}
+
+inline void statAlloc(std::size_t oldCapacity, std::size_t newCapacity) {
+	if (currentStats && newCapacity != oldCapacity) {
+		currentStats->allocations += 1;
+		currentStats->allocatedBytes += newCapacity;
+	}
+}
+
+// Writers can run at compile time, where there's nothing to count
+constexpr void statWrite(Type type) {
+	if (!std::is_constant_evaluated() && currentStats) {
+		currentStats->valuesWritten[(std::size_t)type] += 1;
+	}
+}
+
+class StatNesting {
+public:
+	StatNesting() {
+		if (currentStats) {
+			currentStats->depth += 1;
+			if (currentStats->depth > currentStats->maxDepth) {
+				currentStats->maxDepth = currentStats->depth;
+			}
+		}
+	}
+
+	~StatNesting() {
+		if (currentStats) {
+			currentStats->depth -= 1;
+		}
+	}
 };
 
-class Writer;
+class StatSkip {
+public:
+	StatSkip() {
+		if (currentStats) {
+			currentStats->skipDepth += 1;
+		}
+	}
 
-class ObjectWriter {
+	~StatSkip() {
+		if (currentStats) {
+			currentStats->skipDepth -= 1;
+		}
+	}
+};
+#else
+inline void statByte(std::uint64_t = 1) {}
+inline std::uint64_t statMark() { return 0; }
+inline void statValue(Type, std::uint64_t) {}
+inline void statKey(std::uint64_t) {}
+inline void statMatch(bool) {}
+inline void statAlloc(std::size_t, std::size_t) {}
+constexpr void statWrite(Type) {}
+struct StatNesting { StatNesting() {} };
+struct StatSkip { StatSkip() {} };
+#endif
+
+// Record an error in 'err' if it's the first one, or throw without an 'err'.
+template<typename Source>
+inline void fail(Source *src, Error *err, ErrorCode code, const char *message) {
+	if (!err) {
+		SBON_THROW(ParseError(message));
+	} else if (!*err) {
+		*err = {code, message, SourceTraits<Source>::offset(src)};
+	}
+}
+
+}
+
+template<ByteSink Sink>
+class BasicWriter;
+
+template<ByteSink Sink>
+class BasicObjectWriter {
 public:
-	explicit ObjectWriter(std::ostream *os): os_(os) {}
+	constexpr explicit BasicObjectWriter(Sink *sink, Error *err = nullptr): sink_(sink), err_(err) {}
 
-	Writer key(const char *key);
+	constexpr BasicWriter<Sink> key(const char *key);
 
 private:
-	std::ostream *os_;
+	Sink *sink_;
+	Error *err_;
 };
 
-class Writer {
+template<ByteSink Sink>
+class BasicWriter {
 public:
-	Writer() = default;
-	explicit Writer(std::ostream *os): os_(os) {}
+	constexpr BasicWriter() = default;
+	constexpr explicit BasicWriter(Sink *sink, Error *err = nullptr): sink_(sink), err_(err) {}
 
-	void writeTrue() {
-		checkReady();
+	// The Error passed to the constructor, or nullptr.
+	constexpr Error *error() const {
+		return err_;
+	}
 
-		*os_ << 'T';
+	// The sink's offset, where the next byte will be written.
+	constexpr std::uint64_t offset() const {
+		return SinkTraits<Sink>::offset(sink_);
 	}
 
-	void writeFalse() {
-		checkReady();
+	constexpr void writeTrue() {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::BOOL);
 
-		*os_ << 'F';
+		put('T');
 	}
 
-	void writeBool(bool b) {
-		checkReady();
+	constexpr void writeFalse() {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::BOOL);
+
+		put('F');
+	}
+
+	constexpr void writeBool(bool b) {
+		if (!checkReady()) {
+			return;
+		}
 
 		b ? writeTrue() : writeFalse();
 	}
 
-	void writeNull() {
-		checkReady();
+	constexpr void writeNull() {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::NIL);
 
-		*os_ << 'N';
+		put('N');
 	}
 
-	void writeString(std::string_view str) {
-		checkReady();
+	constexpr void writeString(std::string_view str) {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::STRING);
 
 		for (size_t i = 0; i < str.size(); ++i) {
 			if (str[i] == '\0') {
@@ -86,204 +513,366 @@ public:
 			}
 		}
 
-		*os_ << 'S' << str << '\0';
+		put('S');
+		write(str.data(), str.size());
+		put('\0');
 	}
 
-	void writeFloat(float f) {
-		checkReady();
+	constexpr void writeFloat(float f) {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::FLOAT);
 
 		static_assert(sizeof(float) == 4);
 		static_assert(sizeof(std::uint32_t) == 4);
-		std::uint32_t n;
-		std::memcpy(&n, &f, 4);
+		auto n = std::bit_cast<std::uint32_t>(f);
 
-		*os_ << 'f';
-		*os_ << (char)((n & 0x000000ffu) >> 0);
-		*os_ << (char)((n & 0x0000ff00u) >> 8);
-		*os_ << (char)((n & 0x00ff0000u) >> 16);
-		*os_ << (char)((n & 0xff000000u) >> 24);
+		put('f');
+		put((char)((n & 0x000000ffu) >> 0));
+		put((char)((n & 0x0000ff00u) >> 8));
+		put((char)((n & 0x00ff0000u) >> 16));
+		put((char)((n & 0xff000000u) >> 24));
 	}
 
-	void writeDouble(double d) {
-		checkReady();
+	constexpr void writeDouble(double d) {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::DOUBLE);
 
 		static_assert(sizeof(double) == 8);
 		static_assert(sizeof(std::uint64_t) == 8);
-		std::uint64_t n;
-		std::memcpy(&n, &d, 8);
-
-		*os_ << 'd';
-		*os_ << (char)((n & 0x00000000000000ffull) >> 0);
-		*os_ << (char)((n & 0x000000000000ff00ull) >> 8);
-		*os_ << (char)((n & 0x0000000000ff0000ull) >> 16);
-		*os_ << (char)((n & 0x00000000ff000000ull) >> 24);
-		*os_ << (char)((n & 0x000000ff00000000ull) >> 32);
-		*os_ << (char)((n & 0x0000ff0000000000ull) >> 40);
-		*os_ << (char)((n & 0x00ff000000000000ull) >> 48);
-		*os_ << (char)((n & 0xff00000000000000ull) >> 56);
+		auto n = std::bit_cast<std::uint64_t>(d);
+
+		put('d');
+		put((char)((n & 0x00000000000000ffull) >> 0));
+		put((char)((n & 0x000000000000ff00ull) >> 8));
+		put((char)((n & 0x0000000000ff0000ull) >> 16));
+		put((char)((n & 0x00000000ff000000ull) >> 24));
+		put((char)((n & 0x000000ff00000000ull) >> 32));
+		put((char)((n & 0x0000ff0000000000ull) >> 40));
+		put((char)((n & 0x00ff000000000000ull) >> 48));
+		put((char)((n & 0xff00000000000000ull) >> 56));
 	}
 
 	void writeBinary(const void *data, std::size_t length) {
-		checkReady();
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::BINARY);
 
-		*os_ << 'B';
+		put('B');
 		writeLEB128((uint64_t)length);
-		os_->write((const char *)data, length);
+		write((const char *)data, length);
+	}
+
+	// Write a binary of 'length' bytes read from 'is' in chunks,
+	// without holding it in memory.
+	void writeBinary(std::istream *is, std::uint64_t length) {
+		if (!checkReady()) {
+			return;
+		}
+
+		detail::statWrite(Type::BINARY);
+
+		put('B');
+		writeLEB128(length);
+
+		char buf[CHUNK_SIZE];
+		while (length > 0) {
+			auto n = (std::size_t)std::min<std::uint64_t>(length, CHUNK_SIZE);
+			is->read(buf, (std::streamsize)n);
+			auto got = (std::size_t)is->gcount();
+			write(buf, got);
+			if (got < n) {
+				// The output is now truncated, which is the caller's fault
+				fail();
+				return;
+			}
+
+			length -= n;
+		}
 	}
 
-	void writeInt(int64_t num) {
-		checkReady();
+	constexpr void writeInt(int64_t num) {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(num < 0 ? Type::INT : Type::UINT);
 
 		if (num == std::numeric_limits<int64_t>::min()) {
-			*os_ << '-';
+			put('-');
 			writeLEB128((uint64_t)std::numeric_limits<int64_t>::max() + (uint64_t)1);
 		} else if (num < 0) {
-			*os_ << '-';
+			put('-');
 			writeLEB128(-num);
 		} else if (num <= 9) {
-			*os_ << (char)('0' + num);
+			put((char)('0' + num));
 		} else {
-			*os_ << '+';
+			put('+');
 			writeLEB128(num);
 		}
 	}
 
-	void writeUInt(uint64_t num) {
-		checkReady();
+	constexpr void writeUInt(uint64_t num) {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::UINT);
 
 		if (num <= 9) {
-			*os_ << (char)('0' + num);
+			put((char)('0' + num));
 		} else {
-			*os_ << '+';
+			put('+');
 			writeLEB128(num);
 		}
 	}
 
+	// Write a value which is already encoded, such as an element encoded
+	// on another thread or copied from another document.
+	// Several values may be written at once inside an array.
+	// The bytes are not validated.
+	constexpr void writeEncoded(std::string_view encoded) {
+		if (!checkReady()) {
+			return;
+		}
+
+		write(encoded.data(), encoded.size());
+	}
+
+	template<std::size_t N>
+	constexpr void writeEncoded(const std::array<char, N> &encoded) {
+		writeEncoded(std::string_view(encoded.data(), N));
+	}
+
 	template<typename Func>
-	void writeArray(Func func) {
-		checkReady();
+	constexpr void writeArray(Func func) {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::ARRAY);
 
-		*os_ << '[';
+		put('[');
 		ready_ = false;
-		func(Writer(os_));
+		func(BasicWriter(sink_, err_));
 		ready_ = true;
-		*os_ << ']';
+		put(']');
 	}
 
 	template<typename Func>
-	void writeObject(Func func) {
-		checkReady();
+	constexpr void writeObject(Func func) {
+		if (!checkReady()) {
+			return;
+		}
+		detail::statWrite(Type::OBJECT);
 
-		*os_ << '{';
+		put('{');
 		ready_ = false;
-		func(ObjectWriter(os_));
+		func(BasicObjectWriter<Sink>(sink_, err_));
 		ready_ = true;
-		*os_ << '}';
+		put('}');
 	}
 
 private:
-	void writeLEB128(uint64_t num) {
+	constexpr void put(char ch) {
+		SinkTraits<Sink>::put(sink_, ch);
+	}
+
+	constexpr void write(const char *data, std::size_t size) {
+		SinkTraits<Sink>::write(sink_, data, size);
+	}
+
+	constexpr void writeLEB128(uint64_t num) {
 		do {
 			unsigned char hi = (unsigned char)(num > 0x7f ? 0x80 : 0);
-			*os_ << (char)(hi | (unsigned char)(num & 0x7f));
+			put((char)(hi | (unsigned char)(num & 0x7f)));
 			num >>= 7;
 		} while (num != 0);
 	}
 
-	void checkReady() {
-		if (!ready_) {
-			throw LogicError();
+	constexpr bool checkReady() {
+		if (err_ && *err_) {
+			return false;
+		} else if (ready_) {
+			return true;
+		}
+
+		fail();
+		return false;
+	}
+
+	constexpr void fail() {
+		if (!err_) {
+			SBON_THROW(LogicError());
+		} else if (!*err_) {
+			*err_ = {ErrorCode::LOGIC, "SBON logic error", SinkTraits<Sink>::offset(sink_)};
 		}
 	}
 
-	std::ostream *os_;
+	static constexpr std::size_t CHUNK_SIZE = 4096;
+
+	Sink *sink_;
+	Error *err_ = nullptr;
 	bool ready_ = true;
 };
 
-inline Writer ObjectWriter::key(const char *key) {
-	*os_ << key;
-	*os_ << '\0';
-	return Writer(os_);
+template<ByteSink Sink>
+constexpr BasicWriter<Sink> BasicObjectWriter<Sink>::key(const char *key) {
+	if (!err_ || !*err_) {
+		SinkTraits<Sink>::write(sink_, key, std::char_traits<char>::length(key) + 1);
+	}
+	return BasicWriter<Sink>(sink_, err_);
 }
 
-enum class Type {
-	BOOL,
-	NIL,
-	STRING,
-	BINARY,
-	FLOAT,
-	DOUBLE,
-	INT,
-	UINT,
-	ARRAY,
-	OBJECT,
-};
+using Writer = BasicWriter<std::ostream>;
+using ObjectWriter = BasicObjectWriter<std::ostream>;
 
-class Reader;
-class ObjectMatcher;
+template<ByteSource Source>
+class BasicReader;
+template<ByteSource Source>
+class BasicObjectMatcher;
 
-class ObjectReader {
+template<ByteSource Source>
+class BasicObjectReader {
 public:
-	explicit ObjectReader(std::istream *is): is_(is) {}
+	explicit BasicObjectReader(Source *src, Error *err = nullptr): src_(src), err_(err) {}
 
 	bool hasNext();
-	Reader next(std::string &key);
+
+	template<typename Traits, typename Alloc>
+	BasicReader<Source> next(std::basic_string<char, Traits, Alloc> &key);
+
+	template<std::size_t N>
+	BasicReader<Source> next(FixedString<N> &key);
+
+	BasicReader<Source> skipKey();
+
+	// In an object whose keys are in ascending byte order (see writeSortedObject
+	// in sbon-index.h), look for 'key' and call 'func(val)' with its value.
+	// Keys are compared as they're read, without being copied, and the search
+	// stops at the first greater key. That key is kept and its value is left
+	// unread, as the next entry, so several keys can be found by looking
+	// them up in ascending order.
+	template<typename Func>
+	bool find(std::string_view key, Func func);
+
+	// Skip the remaining entries, for example after find().
+	void skipRest();
 
 	template<typename Func>
 	void all(Func func);
 
-	void match(const std::initializer_list<ObjectMatcher> &matchers);
+	template<typename Func, typename String>
+	void all(Func func, String &key);
+
+	void match(const std::initializer_list<BasicObjectMatcher<Source>> &matchers);
+	void match(std::span<const BasicObjectMatcher<Source>> matchers);
+
+	template<typename String>
+	void match(const std::initializer_list<BasicObjectMatcher<Source>> &matchers, String &key);
+
+	template<typename String>
+	void match(std::span<const BasicObjectMatcher<Source>> matchers, String &key);
 
 private:
-	std::istream *is_;
+	Source *src_;
+	Error *err_;
+
+	// The key where find() stopped, whose value is next in the source
+	std::string stopped_;
+	bool hasStopped_ = false;
 };
 
-class ObjectMatcher {
+template<ByteSource Source>
+class BasicObjectMatcher {
 public:
 	template<typename Func>
-	ObjectMatcher(std::string_view key, const Func &func);
+	BasicObjectMatcher(std::string_view key, const Func &func);
 
 	const std::string_view key() const {
 		return key_;
 	}
 
-	void call(Reader val) const;
+	void call(BasicReader<Source> val) const;
 
 private:
 	std::string_view key_;
 	void (*func_)();
-	void (*invoker_)(void (*func)(), Reader);
+	void (*invoker_)(void (*func)(), BasicReader<Source>);
 };
 
-class ArrayReader {
+template<ByteSource Source>
+class BasicArrayReader {
 public:
-	explicit ArrayReader(std::istream *is): is_(is) {}
+	explicit BasicArrayReader(Source *src, Error *err = nullptr): src_(src), err_(err) {}
 
 	bool hasNext();
-	Reader next();
+	BasicReader<Source> next();
 
 	template<typename Func>
 	void all(Func func);
 
 private:
-	std::istream *is_;
+	Source *src_;
+	Error *err_;
 };
 
-class Reader {
+// Reads the bytes of a string or binary in pieces as they're asked for,
+// unlike Reader::readString and Reader::readBinary, which push them to
+// a callback, so that two values can be read in step.
+// Made by Reader::readBytes().
+template<ByteSource Source>
+class BasicByteReader {
 public:
-	Reader() = default;
-	explicit Reader(std::istream *is): is_(is) {}
+	// A reader at the end of a value
+	explicit BasicByteReader(Source *src, Error *err = nullptr): src_(src), err_(err) {}
+
+	// A reader of a string, or of a binary of 'size' bytes,
+	// whose type and size have been read
+	BasicByteReader(Source *src, Error *err, bool string, std::uint64_t size):
+		src_(src), err_(err), string_(string), remaining_(size), done_(!string && size == 0) {}
+
+	// Read up to 'capacity' bytes into 'buf'. Fewer bytes are only read
+	// at the end of the value, after which 0 is returned.
+	std::size_t read(char *buf, std::size_t capacity);
+
+	// Skip the rest of the value.
+	void skipRest();
+
+private:
+	Source *src_;
+	Error *err_;
+	bool string_ = false;
+	std::uint64_t remaining_ = 0;
+	bool done_ = true;
+};
+
+template<ByteSource Source>
+class BasicReader {
+public:
+	BasicReader() = default;
+	explicit BasicReader(Source *src, Error *err = nullptr): src_(src), err_(err) {}
 
 	bool hasNext() {
-		return is_->peek() != EOF;
+		return !(err_ && *err_) && SourceTraits<Source>::peek(src_) != EOF;
+	}
+
+	// The Error passed to the constructor, or nullptr.
+	Error *error() const {
+		return err_;
 	}
 
+	// Returns NIL if the reader is in an error state.
 	Type getType() {
-		checkReady();
+		if (!checkReady()) {
+			return Type::NIL;
+		}
 
-		int ch = is_->peek();
+		int ch = SourceTraits<Source>::peek(src_);
 		if (ch == EOF) {
-			throw ParseError("Unexpected EOF");
+			fail(ErrorCode::UNEXPECTED_EOF, "Unexpected EOF");
+			return Type::NIL;
 		}
 
 		if (ch == 'T' || ch == 'F') {
@@ -307,43 +896,66 @@ public:
 		} else if (ch == '{') {
 			return Type::OBJECT;
 		} else {
-			throw ParseError("Unexpected character");
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "Unexpected character");
+			return Type::NIL;
 		}
 	}
 
 	bool getBool() {
-		checkReady();
+		if (!checkReady()) {
+			return false;
+		}
 
-		int ch = is_->get();
+		auto mark = detail::statMark();
+
+		int ch = get();
 		if (ch == 'T') {
+			detail::statValue(Type::BOOL, mark);
 			return true;
 		} else if (ch == 'F') {
+			detail::statValue(Type::BOOL, mark);
 			return false;
 		} else {
-			throw ParseError("getBool: Expected 'T' or 'F'");
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getBool: Expected 'T' or 'F'");
+			return false;
 		}
 	}
 
 	void getNil() {
-		checkReady();
+		if (!checkReady()) {
+			return;
+		}
 
-		if (is_->get() != 'N') {
-			throw ParseError("skipNil: Expected 'N'");
+		auto mark = detail::statMark();
+		if (get() != 'N') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "skipNil: Expected 'N'");
+			return;
 		}
+
+		detail::statValue(Type::NIL, mark);
 	}
 
-	void getString(std::string &s) {
-		checkReady();
+	template<typename Traits, typename Alloc>
+	void getString(std::basic_string<char, Traits, Alloc> &s) {
+		s.clear();
+		if (!checkReady()) {
+			return;
+		}
 
-		if (is_->get() != 'S') {
-			throw ParseError("getString: Expected 'S'");
+		auto mark = detail::statMark();
+		if (get() != 'S') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getString: Expected 'S'");
+			return;
 		}
 
-		s.clear();
 		int ch;
 		while ((ch = next())) {
+			std::size_t capacity = s.capacity();
 			s += ch;
+			detail::statAlloc(capacity, s.capacity());
 		}
+
+		detail::statValue(Type::STRING, mark);
 	}
 
 	std::string getString() {
@@ -352,29 +964,78 @@ public:
 		return str;
 	}
 
+	std::pmr::string getString(std::pmr::memory_resource *mr) {
+		std::pmr::string str(mr);
+		getString(str);
+		return str;
+	}
+
+	template<std::size_t N>
+	void getString(FixedString<N> &s) {
+		s.clear();
+		if (!checkReady()) {
+			return;
+		}
+
+		auto mark = detail::statMark();
+		if (get() != 'S') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getString: Expected 'S'");
+			return;
+		}
+
+		char ch;
+		while ((ch = next())) {
+			if (!s.push_back(ch)) {
+				fail(ErrorCode::TOO_LONG, "getString: String too long");
+				return;
+			}
+		}
+
+		detail::statValue(Type::STRING, mark);
+	}
+
 	void skipString() {
-		checkReady();
+		if (!checkReady()) {
+			return;
+		}
 
-		if (is_->get() != 'S') {
-			throw ParseError("skipString: Expected 'S'");
+		auto mark = detail::statMark();
+		if (get() != 'S') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "skipString: Expected 'S'");
+			return;
 		}
 
 		while (next());
+		detail::statValue(Type::STRING, mark);
 	}
 
-	void getBinary(std::vector<unsigned char> &bin) {
-		checkReady();
+	template<typename Alloc>
+	void getBinary(std::vector<unsigned char, Alloc> &bin) {
+		bin.clear();
+		if (!checkReady()) {
+			return;
+		}
 
-		if (is_->get() != 'B') {
-			throw ParseError("getString: Expected 'B'");
+		auto mark = detail::statMark();
+		if (get() != 'B') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getString: Expected 'B'");
+			return;
 		}
 
 		size_t size = (size_t)nextLEB128();
-
-		bin.clear();
 		while (bin.size() < size) {
-			bin.push_back(next());
+			int ch = get();
+			if (ch == EOF) {
+				fail(ErrorCode::UNEXPECTED_EOF, "Unexpected EOF");
+				return;
+			}
+
+			std::size_t capacity = bin.capacity();
+			bin.push_back((unsigned char)ch);
+			detail::statAlloc(capacity, bin.capacity());
 		}
+
+		detail::statValue(Type::BINARY, mark);
 	}
 
 	std::vector<unsigned char> getBinary() {
@@ -383,18 +1044,173 @@ public:
 		return bin;
 	}
 
+	std::pmr::vector<unsigned char> getBinary(std::pmr::memory_resource *mr) {
+		std::pmr::vector<unsigned char> bin(mr);
+		getBinary(bin);
+		return bin;
+	}
+
+	// Read a binary into a buffer with room for 'capacity' bytes.
+	// Returns the size of the binary.
+	std::size_t getBinary(unsigned char *buf, std::size_t capacity) {
+		if (!checkReady()) {
+			return 0;
+		}
+
+		auto mark = detail::statMark();
+		if (get() != 'B') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getBinary: Expected 'B'");
+			return 0;
+		}
+
+		std::uint64_t size = nextLEB128();
+		if (size > capacity) {
+			fail(ErrorCode::TOO_LONG, "getBinary: Binary too long");
+			return 0;
+		}
+
+		std::size_t got = SourceTraits<Source>::read(src_, (char *)buf, (std::size_t)size);
+		detail::statByte(got);
+		if (got != size) {
+			fail(ErrorCode::UNEXPECTED_EOF, "Unexpected EOF");
+			return 0;
+		}
+
+		detail::statValue(Type::BINARY, mark);
+		return (std::size_t)size;
+	}
+
 	void skipBinary() {
-		checkReady();
+		if (!checkReady()) {
+			return;
+		}
 
-		if (is_->get() != 'B') {
-			throw ParseError("skipBinary: Expected 'B'");
+		auto mark = detail::statMark();
+		if (get() != 'B') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "skipBinary: Expected 'B'");
+			return;
 		}
 
 		size_t size = (size_t)nextLEB128();
 		while (size > 0) {
-			next();
+			if (get() == EOF) {
+				fail(ErrorCode::UNEXPECTED_EOF, "Unexpected EOF");
+				return;
+			}
 			size -= 1;
 		}
+
+		detail::statValue(Type::BINARY, mark);
+	}
+
+	static constexpr std::size_t CHUNK_SIZE = 4096;
+
+	// Read a binary in chunks of at most CHUNK_SIZE bytes, without holding
+	// the whole value in memory. 'func' is called with
+	// (const unsigned char *data, std::size_t size) for each chunk.
+	// Returns the size of the binary.
+	template<typename Func>
+	requires std::invocable<Func &, const unsigned char *, std::size_t>
+	std::uint64_t readBinary(Func func) {
+		if (!checkReady()) {
+			return 0;
+		}
+
+		auto mark = detail::statMark();
+		if (get() != 'B') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "readBinary: Expected 'B'");
+			return 0;
+		}
+
+		std::uint64_t size = nextLEB128();
+		std::uint64_t remaining = size;
+		unsigned char buf[CHUNK_SIZE];
+		while (remaining > 0) {
+			auto n = (std::size_t)std::min<std::uint64_t>(remaining, CHUNK_SIZE);
+			std::size_t got = SourceTraits<Source>::read(src_, (char *)buf, n);
+			detail::statByte(got);
+			if (got < n) {
+				fail(ErrorCode::UNEXPECTED_EOF, "Unexpected EOF");
+				return 0;
+			}
+
+			func((const unsigned char *)buf, n);
+			remaining -= n;
+		}
+
+		detail::statValue(Type::BINARY, mark);
+		return size;
+	}
+
+	std::uint64_t readBinary(std::ostream *os) {
+		return readBinary([&](const unsigned char *data, std::size_t size) {
+			os->write((const char *)data, (std::streamsize)size);
+		});
+	}
+
+	// Read a string in chunks of at most CHUNK_SIZE bytes.
+	// 'func' is called with a std::string_view for each chunk.
+	// Returns the length of the string.
+	template<typename Func>
+	requires std::invocable<Func &, std::string_view>
+	std::uint64_t readString(Func func) {
+		if (!checkReady()) {
+			return 0;
+		}
+
+		auto mark = detail::statMark();
+		if (get() != 'S') {
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "readString: Expected 'S'");
+			return 0;
+		}
+
+		std::uint64_t length = 0;
+		char buf[CHUNK_SIZE];
+		std::size_t n = 0;
+		char ch;
+		while ((ch = next())) {
+			buf[n++] = ch;
+			if (n == CHUNK_SIZE) {
+				func(std::string_view(buf, n));
+				length += n;
+				n = 0;
+			}
+		}
+
+		if (err_ && *err_) {
+			return 0;
+		}
+
+		if (n > 0) {
+			func(std::string_view(buf, n));
+			length += n;
+		}
+
+		detail::statValue(Type::STRING, mark);
+		return length;
+	}
+
+	std::uint64_t readString(std::ostream *os) {
+		return readString([&](std::string_view chunk) {
+			os->write(chunk.data(), (std::streamsize)chunk.size());
+		});
+	}
+
+	// Read a string or a binary in pieces which the caller asks for.
+	BasicByteReader<Source> readBytes() {
+		if (!checkReady()) {
+			return BasicByteReader<Source>(src_, err_);
+		}
+
+		int ch = get();
+		if (ch == 'S') {
+			return BasicByteReader<Source>(src_, err_, true, 0);
+		} else if (ch == 'B') {
+			return BasicByteReader<Source>(src_, err_, false, nextLEB128());
+		}
+
+		fail(ErrorCode::UNEXPECTED_CHARACTER, "readBytes: Expected 'S' or 'B'");
+		return BasicByteReader<Source>(src_, err_);
 	}
 
 	float getFloat() {
@@ -415,115 +1231,183 @@ public:
 
 	template<typename T>
 	T getNumber() {
-		checkReady();
+		if (!checkReady()) {
+			return T();
+		}
+
+		auto mark = detail::statMark();
 
 		char ch = next();
 		if (ch >= '0' && ch <= '9') {
 			unsigned char u = ch - '0';
+			detail::statValue(Type::UINT, mark);
 			return (T)u;
 		} else if (ch == '+') {
 			uint64_t u = nextLEB128();
 			T num(u);
 			if ((uint64_t)num != u) {
-				throw ParseError("getNumber: Got unrepresentable number");
+				fail(ErrorCode::UNREPRESENTABLE_NUMBER,
+					"getNumber: Got unrepresentable number");
+				return T();
 			}
 
+			detail::statValue(Type::UINT, mark);
 			return num;
 		} else if (ch == '-') {
 			uint64_t u = nextLEB128();
 			if (u > (uint64_t)(std::numeric_limits<int64_t>::max())) {
-				throw ParseError("getNumber: Got unrepresentable number");
+				fail(ErrorCode::UNREPRESENTABLE_NUMBER,
+					"getNumber: Got unrepresentable number");
+				return T();
 			}
 
 			int64_t i = -(int64_t)u;
 			T num(i);
 			if ((int64_t)num != i) {
-				throw ParseError("getNumber: Got unrepresentable number");
+				fail(ErrorCode::UNREPRESENTABLE_NUMBER,
+					"getNumber: Got unrepresentable number");
+				return T();
 			}
 
+			detail::statValue(Type::INT, mark);
 			return num;
 		} else if (ch == 'f') {
 			float f = nextFloat();
 			T num(f);
-			if ((float)num != f) {
-				throw ParseError("getNumber: Got unrepresentable number");
+			if ((float)num != f && !(std::is_floating_point_v<T> && f != f)) {
+				fail(ErrorCode::UNREPRESENTABLE_NUMBER,
+					"getNumber: Got unrepresentable number");
+				return T();
 			}
 
+			detail::statValue(Type::FLOAT, mark);
 			return num;
 		} else if (ch == 'd') {
 			double d = nextDouble();
 			T num(d);
-			if ((double)num != d) {
-				throw ParseError("getNumber: Got unrepresentable number");
+			if ((double)num != d && !(std::is_floating_point_v<T> && d != d)) {
+				fail(ErrorCode::UNREPRESENTABLE_NUMBER,
+					"getNumber: Got unrepresentable number");
+				return T();
 			}
 
+			detail::statValue(Type::DOUBLE, mark);
 			return num;
 		} else {
-			throw ParseError("getNumber: Expected number");
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getNumber: Expected number");
+			return T();
 		}
 	}
 
 	template<typename Func>
 	void getArray(Func func) {
-		checkReady();
+		if (!checkReady()) {
+			return;
+		}
 
 		char ch = next();
 		if (ch != '[') {
-			throw ParseError("getArray: Expected '['");
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getArray: Expected '['");
+			return;
 		}
 
-		ready_ = false;
-		ArrayReader arr(is_);
-		func(arr);
-		ready_ = true;
+		{
+			detail::StatNesting nesting;
+			ready_ = false;
+			BasicArrayReader<Source> arr(src_, err_);
+			func(arr);
+			ready_ = true;
+		}
 
 		ch = next();
 		if (ch != ']') {
-			throw ParseError("getArray: Expected ']'");
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getArray: Expected ']'");
+			return;
 		}
+
+		// Only the delimiters count as array bytes
+		detail::statValue(Type::ARRAY, detail::statMark() - 2);
 	}
 
 	template<typename Func>
 	void readArray(Func func) {
-		getArray([&](ArrayReader arr) {
+		getArray([&](BasicArrayReader<Source> arr) {
 			arr.all(func);
 		});
 	}
 
 	template<typename Func>
 	void getObject(Func func) {
-		checkReady();
+		if (!checkReady()) {
+			return;
+		}
 
 		char ch = next();
 		if (ch != '{') {
-			throw ParseError("getObject: Expected '{'");
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getObject: Expected '{'");
+			return;
 		}
 
-		ready_ = false;
-		ObjectReader obj(is_);
-		func(obj);
-		ready_ = true;
+		{
+			detail::StatNesting nesting;
+			ready_ = false;
+			BasicObjectReader<Source> obj(src_, err_);
+			func(obj);
+			ready_ = true;
+		}
 
 		ch = next();
 		if (ch != '}') {
-			throw ParseError("getObject: Expected '}'");
+			fail(ErrorCode::UNEXPECTED_CHARACTER, "getObject: Expected '}'");
+			return;
 		}
+
+		detail::statValue(Type::OBJECT, detail::statMark() - 2);
 	}
 
 	template<typename Func>
 	void readObject(Func func) {
-		getObject([&](ObjectReader obj) {
+		getObject([&](BasicObjectReader<Source> obj) {
 			obj.all(func);
 		});
 	}
 
-	void matchObject(const std::initializer_list<ObjectMatcher> &matchers) {
-		getObject([&](ObjectReader obj) {
+	template<typename Func, typename String>
+	void readObject(Func func, String &key) {
+		getObject([&](BasicObjectReader<Source> obj) {
+			obj.all(func, key);
+		});
+	}
+
+	void matchObject(const std::initializer_list<BasicObjectMatcher<Source>> &matchers) {
+		getObject([&](BasicObjectReader<Source> obj) {
 			obj.match(matchers);
 		});
 	}
 
+	void matchObject(std::span<const BasicObjectMatcher<Source>> matchers) {
+		getObject([&](BasicObjectReader<Source> obj) {
+			obj.match(matchers);
+		});
+	}
+
+	template<typename String>
+	void matchObject(const std::initializer_list<BasicObjectMatcher<Source>> &matchers, String &key) {
+		getObject([&](BasicObjectReader<Source> obj) {
+			obj.match(matchers, key);
+		});
+	}
+
+	template<typename String>
+	void matchObject(std::span<const BasicObjectMatcher<Source>> matchers, String &key) {
+		getObject([&](BasicObjectReader<Source> obj) {
+			obj.match(matchers, key);
+		});
+	}
+
 	void skip() {
+		detail::StatSkip skipping;
+
 		switch (getType()) {
 		case Type::BOOL:
 			getBool();
@@ -550,23 +1434,33 @@ public:
 			getUInt();
 			break;
 		case Type::ARRAY:
-			readArray([](Reader r) {
+			readArray([](BasicReader<Source> r) {
 				r.skip();
 			});
 			break;
 		case Type::OBJECT:
-			readObject([](std::string &, Reader r) {
-				r.skip();
+			getObject([](BasicObjectReader<Source> obj) {
+				while (obj.hasNext()) {
+					obj.skipKey().skip();
+				}
 			});
 			break;
 		}
 	}
 
 private:
+	int get() {
+		detail::statByte();
+		return SourceTraits<Source>::get(src_);
+	}
+
+	// Returns 0 on EOF in the error state mode,
+	// which ends every loop reading a string or LEB128 number.
 	char next() {
-		int ch = is_->get();
+		int ch = get();
 		if (ch == EOF) {
-			throw ParseError("Unexpected EOF");
+			fail(ErrorCode::UNEXPECTED_EOF, "Unexpected EOF");
+			return 0;
 		}
 
 		return (char)ch;
@@ -618,57 +1512,290 @@ private:
 		return d;
 	}
 
-	void checkReady() {
-		if (!ready_) {
-			throw LogicError();
+	bool checkReady() {
+		if (err_ && *err_) {
+			return false;
+		} else if (ready_) {
+			return true;
 		}
+
+		if (!err_) {
+			SBON_THROW(LogicError());
+		}
+
+		*err_ = {ErrorCode::LOGIC, "SBON logic error", SourceTraits<Source>::offset(src_)};
+		return false;
 	}
 
-	std::istream *is_;
+	void fail(ErrorCode code, const char *message) {
+		detail::fail(src_, err_, code, message);
+	}
+
+	Source *src_;
+	Error *err_ = nullptr;
 	bool ready_ = true;
 };
 
-inline bool ArrayReader::hasNext() {
-	int ret = is_->peek();
+template<ByteSource Source>
+inline bool BasicArrayReader<Source>::hasNext() {
+	if (err_ && *err_) {
+		return false;
+	}
+
+	int ret = SourceTraits<Source>::peek(src_);
 	return ret != ']' && ret != EOF;
 }
 
-inline Reader ArrayReader::next() {
-	return Reader(is_);
+template<ByteSource Source>
+inline BasicReader<Source> BasicArrayReader<Source>::next() {
+	return BasicReader<Source>(src_, err_);
 }
 
+template<ByteSource Source>
 template<typename Func>
-inline void ArrayReader::all(Func func) {
+inline void BasicArrayReader<Source>::all(Func func) {
 	while (hasNext()) {
 		auto val = next();
 		func(val);
 	}
 }
 
-inline bool ObjectReader::hasNext() {
-	int ret = is_->peek();
+template<ByteSource Source>
+inline std::size_t BasicByteReader<Source>::read(char *buf, std::size_t capacity) {
+	if (done_ || (err_ && *err_)) {
+		return 0;
+	}
+
+	std::size_t n = 0;
+	if (string_) {
+		while (n < capacity) {
+			detail::statByte();
+			int ch = SourceTraits<Source>::get(src_);
+			if (ch == EOF) {
+				done_ = true;
+				detail::fail(src_, err_, ErrorCode::UNEXPECTED_EOF,
+					"ByteReader::read: Unexpected EOF");
+				return 0;
+			} else if (ch == 0) {
+				done_ = true;
+				break;
+			}
+
+			buf[n++] = (char)ch;
+		}
+		return n;
+	}
+
+	n = (std::size_t)std::min<std::uint64_t>(remaining_, capacity);
+	std::size_t got = SourceTraits<Source>::read(src_, buf, n);
+	detail::statByte(got);
+	if (got < n) {
+		done_ = true;
+		detail::fail(src_, err_, ErrorCode::UNEXPECTED_EOF,
+			"ByteReader::read: Unexpected EOF");
+		return 0;
+	}
+
+	remaining_ -= n;
+	done_ = remaining_ == 0;
+	return n;
+}
+
+template<ByteSource Source>
+inline void BasicByteReader<Source>::skipRest() {
+	char buf[BasicReader<Source>::CHUNK_SIZE];
+	while (read(buf, sizeof(buf)) > 0) {}
+}
+
+template<ByteSource Source>
+inline bool BasicObjectReader<Source>::hasNext() {
+	if (err_ && *err_) {
+		return false;
+	}
+
+	if (hasStopped_) {
+		return true;
+	}
+
+	int ret = SourceTraits<Source>::peek(src_);
 	return ret != '}' && ret != EOF;
 }
 
-inline Reader ObjectReader::next(std::string &key) {
+template<ByteSource Source>
+template<typename Traits, typename Alloc>
+inline BasicReader<Source> BasicObjectReader<Source>::next(
+		std::basic_string<char, Traits, Alloc> &key) {
+	if (hasStopped_) {
+		hasStopped_ = false;
+		key.assign(stopped_.data(), stopped_.size());
+		return BasicReader<Source>(src_, err_);
+	}
+
+	auto mark = detail::statMark();
+
 	key.clear();
 	while (true) {
-		int ch = is_->get();
+		detail::statByte();
+		int ch = SourceTraits<Source>::get(src_);
 		if (ch == EOF) {
-			throw ParseError("ObjectReader::next: Unexpected EOF");
+			detail::fail(src_, err_, ErrorCode::UNEXPECTED_EOF,
+				"ObjectReader::next: Unexpected EOF");
+			return BasicReader<Source>(src_, err_);
 		} else if (ch == 0) {
 			break;
 		}
 
+		std::size_t capacity = key.capacity();
 		key += (char)ch;
+		detail::statAlloc(capacity, key.capacity());
 	}
 
-	return Reader(is_);
+	detail::statKey(mark);
+	return BasicReader<Source>(src_, err_);
 }
 
+template<ByteSource Source>
+template<std::size_t N>
+inline BasicReader<Source> BasicObjectReader<Source>::next(FixedString<N> &key) {
+	key.clear();
+	if (hasStopped_) {
+		hasStopped_ = false;
+		for (char ch: stopped_) {
+			if (!key.push_back(ch)) {
+				detail::fail(src_, err_, ErrorCode::TOO_LONG,
+					"ObjectReader::next: Key too long");
+				break;
+			}
+		}
+		return BasicReader<Source>(src_, err_);
+	}
+
+	auto mark = detail::statMark();
+
+	while (true) {
+		detail::statByte();
+		int ch = SourceTraits<Source>::get(src_);
+		if (ch == EOF) {
+			detail::fail(src_, err_, ErrorCode::UNEXPECTED_EOF,
+				"ObjectReader::next: Unexpected EOF");
+			return BasicReader<Source>(src_, err_);
+		} else if (ch == 0) {
+			break;
+		} else if (!key.push_back((char)ch)) {
+			detail::fail(src_, err_, ErrorCode::TOO_LONG,
+				"ObjectReader::next: Key too long");
+			return BasicReader<Source>(src_, err_);
+		}
+	}
+
+	detail::statKey(mark);
+	return BasicReader<Source>(src_, err_);
+}
+
+template<ByteSource Source>
+inline BasicReader<Source> BasicObjectReader<Source>::skipKey() {
+	if (hasStopped_) {
+		hasStopped_ = false;
+		return BasicReader<Source>(src_, err_);
+	}
+
+	auto mark = detail::statMark();
+
+	while (true) {
+		detail::statByte();
+		int ch = SourceTraits<Source>::get(src_);
+		if (ch == EOF) {
+			detail::fail(src_, err_, ErrorCode::UNEXPECTED_EOF,
+				"ObjectReader::skipKey: Unexpected EOF");
+			return BasicReader<Source>(src_, err_);
+		} else if (ch == 0) {
+			break;
+		}
+	}
+
+	detail::statKey(mark);
+	return BasicReader<Source>(src_, err_);
+}
+
+template<ByteSource Source>
+template<typename Func>
+inline bool BasicObjectReader<Source>::find(std::string_view key, Func func) {
+	while (hasNext()) {
+		// Negative while the key read so far sorts before 'key', positive after
+		int cmp = 0;
+		if (hasStopped_) {
+			cmp = std::string_view(stopped_).compare(key);
+			if (cmp > 0) {
+				return false;
+			}
+			hasStopped_ = false;
+		} else {
+			auto mark = detail::statMark();
+			std::size_t length = 0;
+			while (true) {
+				detail::statByte();
+				int ch = SourceTraits<Source>::get(src_);
+				if (ch == EOF) {
+					detail::fail(src_, err_, ErrorCode::UNEXPECTED_EOF,
+						"ObjectReader::find: Unexpected EOF");
+					return false;
+				} else if (ch == 0) {
+					break;
+				}
+
+				// Only a greater key is kept, for the next find()
+				if (cmp == 0) {
+					cmp = length == key.size() ? 1 : ch - (unsigned char)key[length];
+					if (cmp > 0) {
+						stopped_.assign(key.substr(0, length));
+					}
+				}
+				if (cmp > 0) {
+					stopped_ += (char)ch;
+				}
+				length += 1;
+			}
+
+			if (cmp == 0 && length < key.size()) {
+				cmp = -1;
+			}
+
+			detail::statKey(mark);
+			detail::statMatch(cmp == 0);
+		}
+
+		BasicReader<Source> val(src_, err_);
+		if (cmp == 0) {
+			func(val);
+			return true;
+		} else if (cmp > 0) {
+			hasStopped_ = true;
+			return false;
+		}
+
+		val.skip();
+	}
+
+	return false;
+}
+
+template<ByteSource Source>
+inline void BasicObjectReader<Source>::skipRest() {
+	while (hasNext()) {
+		skipKey().skip();
+	}
+}
+
+template<ByteSource Source>
 template<typename Func>
-inline void ObjectReader::all(Func func) {
+inline void BasicObjectReader<Source>::all(Func func) {
 	std::string key;
+	all(func, key);
+}
+
+template<ByteSource Source>
+template<typename Func, typename String>
+inline void BasicObjectReader<Source>::all(Func func, String &key) {
 	while (hasNext()) {
 		auto val = next(key);
 		func(key, val);
@@ -681,38 +1808,72 @@ struct ObjectReaderMatcher {
 	Func func;
 };
 
-inline void ObjectReader::match(const std::initializer_list<ObjectMatcher> &matchers)
+template<ByteSource Source>
+inline void BasicObjectReader<Source>::match(
+		const std::initializer_list<BasicObjectMatcher<Source>> &matchers)
 {
 	std::string key;
+	match(std::span(matchers.begin(), matchers.size()), key);
+}
+
+template<ByteSource Source>
+inline void BasicObjectReader<Source>::match(std::span<const BasicObjectMatcher<Source>> matchers)
+{
+	std::string key;
+	match(matchers, key);
+}
+
+template<ByteSource Source>
+template<typename String>
+inline void BasicObjectReader<Source>::match(
+		const std::initializer_list<BasicObjectMatcher<Source>> &matchers, String &key)
+{
+	match(std::span(matchers.begin(), matchers.size()), key);
+}
+
+template<ByteSource Source>
+template<typename String>
+inline void BasicObjectReader<Source>::match(
+		std::span<const BasicObjectMatcher<Source>> matchers, String &key)
+{
 	while (hasNext()) {
 		auto val = next(key);
 		bool matched = false;
 		for (auto &matcher: matchers) {
-			if (matcher.key() == key) {
+			if (matcher.key() == std::string_view(key)) {
 				matched = true;
 				matcher.call(val);
 				break;
 			}
 		}
 
+		detail::statMatch(matched);
 		if (!matched) {
 			val.skip();
 		}
 	}
 }
 
+template<ByteSource Source>
 template<typename Func>
-inline ObjectMatcher::ObjectMatcher(std::string_view key, const Func &func):
+inline BasicObjectMatcher<Source>::BasicObjectMatcher(std::string_view key, const Func &func):
 	key_(key),
 	func_((void (*)())&func),
-	invoker_(+[](void (*func)(), Reader val) {
+	invoker_(+[](void (*func)(), BasicReader<Source> val) {
 		(*(Func *)func)(val);
 	}) {}
 
-inline void ObjectMatcher::call(Reader val) const {
+template<ByteSource Source>
+inline void BasicObjectMatcher<Source>::call(BasicReader<Source> val) const {
 	invoker_(func_, val);
 }
 
+using Reader = BasicReader<std::istream>;
+using ArrayReader = BasicArrayReader<std::istream>;
+using ObjectReader = BasicObjectReader<std::istream>;
+using ByteReader = BasicByteReader<std::istream>;
+using ObjectMatcher = BasicObjectMatcher<std::istream>;
+
 }
 
 #endif
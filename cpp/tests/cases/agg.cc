@@ -0,0 +1,144 @@
+#include <sbon-agg.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if __has_include(<sys/resource.h>)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "test.h"
+
+TEST_CASE("Aggregate kernels") {
+	std::vector<double> values;
+	for (int i = 1; i <= 11; ++i) {
+		values.push_back(i);
+	}
+
+	sbon::Aggregate agg({0, 10, 5});
+	agg.add(values);
+	agg.add(-1);
+	CHECK_EQ(agg.count(), 12);
+	CHECK_EQ(agg.sum(), 65);
+	CHECK_EQ(agg.min(), -1);
+	CHECK_EQ(agg.max(), 11);
+	CHECK(agg.histogram() == std::vector<std::uint64_t>({1, 2, 2, 2, 2}));
+	CHECK_EQ(agg.underflow(), 1);
+	CHECK_EQ(agg.overflow(), 2);
+
+	sbon::Aggregate other = agg.empty();
+	CHECK_EQ(other.count(), 0);
+	other.add(100);
+	agg.merge(other);
+	CHECK_EQ(agg.count(), 13);
+	CHECK_EQ(agg.max(), 100);
+	CHECK_EQ(agg.overflow(), 3);
+}
+
+static std::string records(int count, int offset) {
+	std::stringstream ss;
+	for (int i = 0; i < count; ++i) {
+		sbon::Writer(&ss).writeObject([&](sbon::ObjectWriter w) {
+			w.key("id").writeInt(i + offset);
+			w.key("response").writeObject([&](sbon::ObjectWriter w) {
+				w.key("status").writeString("ok");
+				w.key("latency").writeDouble(0.5);
+			});
+			w.key("items").writeArray([&](sbon::Writer w) {
+				w.writeObject([](sbon::ObjectWriter w) {
+					w.key("price").writeFloat(1.5);
+				});
+				w.writeObject([](sbon::ObjectWriter w) {
+					w.key("price").writeUInt(2);
+					w.key("other").writeNull();
+				});
+			});
+		});
+	}
+	return ss.str();
+}
+
+TEST_CASE("Aggregate query over records") {
+	sbon::AggregateQuery query;
+	auto id = query.add("id");
+	auto latency = query.add("response.latency");
+	auto price = query.add("items.price");
+	auto status = query.add("response.status");
+
+	std::stringstream ss(records(3000, 0));
+	CHECK_EQ(query.readAll(&ss), 3000);
+
+	CHECK_EQ(query.result(id).count(), 3000);
+	CHECK_EQ(query.result(id).sum(), 2999.0 * 3000 / 2);
+	CHECK_EQ(query.result(id).max(), 2999);
+	CHECK_EQ(query.result(latency).sum(), 1500);
+	CHECK_EQ(query.result(price).count(), 6000);
+	CHECK_EQ(query.result(price).mean(), 1.75);
+	CHECK_EQ(query.result(status).count(), 0);
+}
+
+TEST_CASE("Parallel aggregation") {
+	std::stringstream a(records(1000, 0));
+	std::stringstream b(records(1000, 1000));
+	std::stringstream c(records(500, 2000));
+	std::istream *streams[] = {&a, &b, &c};
+
+	sbon::AggregateQuery query;
+	auto id = query.add("id", sbon::Aggregate({0, 2500, 5}));
+	CHECK_EQ(sbon::aggregateParallel(query, streams, 2), 2500);
+
+	auto &agg = query.result(id);
+	CHECK_EQ(agg.count(), 2500);
+	CHECK_EQ(agg.min(), 0);
+	CHECK_EQ(agg.max(), 2499);
+	CHECK_EQ(agg.sum(), 2499.0 * 2500 / 2);
+	CHECK(agg.histogram() == std::vector<std::uint64_t>({500, 500, 500, 500, 500}));
+}
+
+#if __has_include(<sys/resource.h>)
+
+TEST_CASE("Aggregating many files") {
+	std::vector<std::string> paths;
+	for (int i = 0; i < 64; ++i) {
+		paths.push_back("/tmp/sbon-agg-" + std::to_string(::getpid()) + "-" + std::to_string(i));
+		std::ofstream(paths.back(), std::ios::binary) << records(10, i * 10);
+	}
+
+	// Opening every file up front would run out of file descriptors
+	struct rlimit old;
+	::getrlimit(RLIMIT_NOFILE, &old);
+	int fd = ::dup(0);
+	::close(fd);
+	struct rlimit limit = old;
+	limit.rlim_cur = (rlim_t)fd + 16;
+	::setrlimit(RLIMIT_NOFILE, &limit);
+
+	sbon::AggregateQuery query;
+	auto id = query.add("id");
+	std::uint64_t count = 0;
+	try {
+		count = sbon::aggregateFiles(query, paths, 2);
+	} catch (std::exception &) {}
+	::setrlimit(RLIMIT_NOFILE, &old);
+	CHECK_EQ(count, 640);
+	CHECK_EQ(query.result(id).max(), 639);
+
+	paths.push_back("/nonexistent/sbon-agg");
+	bool threw = false;
+	try {
+		sbon::aggregateFiles(query, paths, 2);
+	} catch (std::ios::failure &) {
+		threw = true;
+	}
+	CHECK(threw);
+
+	paths.pop_back();
+	for (auto &path: paths) {
+		::unlink(path.c_str());
+	}
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include <sbon.h>
+
+#include <sstream>
+#include <string>
+
+#include "test.h"
+#include "gen/keys.h"
+#include "gen/shapes.h"
+
+static shapes::Shape makeShape() {
+	shapes::Shape shape;
+	shape.name = "triangle";
+	shape.id = 10;
+	shape.offset = -3;
+	shape.scale = 0.5;
+	shape.closed = true;
+	shape.data = {1, 2, 3};
+	shape.points = {{0, 0, "a"}, {1, 0, "b"}, {0, 1.5, "c"}};
+	shape.grid = {{1, 2}, {}, {-3}};
+	return shape;
+}
+
+TEST_CASE("Generated code round-trip") {
+	std::stringstream ss;
+	shapes::encode(sbon::Writer(&ss), makeShape());
+
+	shapes::Shape shape;
+	shapes::decode(sbon::Reader(&ss), shape);
+	CHECK_EQ(shape.name, "triangle");
+	CHECK_EQ(shape.id, 10u);
+	CHECK_EQ(shape.offset, -3);
+	CHECK_EQ(shape.scale, 0.5);
+	CHECK(shape.closed);
+	CHECK(shape.data == std::vector<unsigned char>({1, 2, 3}));
+	REQUIRE(shape.points.size() == 3);
+	CHECK_EQ(shape.points[2].y, 1.5);
+	CHECK_EQ(shape.points[2].label, "c");
+	REQUIRE(shape.grid.size() == 3);
+	CHECK(shape.grid[0] == std::vector<std::int64_t>({1, 2}));
+	CHECK(shape.grid[1].empty());
+	CHECK(shape.grid[2] == std::vector<std::int64_t>({-3}));
+}
+
+TEST_CASE("Generated code accepts reordered and unknown fields") {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeObject([](sbon::ObjectWriter w) {
+		w.key("extra").writeArray([](sbon::Writer w) {
+			w.writeString("ignored");
+		});
+		w.key("point-label").writeString("origin");
+		w.key("y").writeDouble(2);
+		w.key("x").writeDouble(1);
+	});
+
+	shapes::Point point;
+	shapes::decode(sbon::Reader(&ss), point);
+	CHECK_EQ(point.x, 1);
+	CHECK_EQ(point.y, 2);
+	CHECK_EQ(point.label, "origin");
+}
+
+TEST_CASE("Generated code keeps defaults for missing fields") {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeObject([](sbon::ObjectWriter w) {
+		w.key("x").writeDouble(4);
+	});
+
+	shapes::Point point;
+	point.label = "default";
+	shapes::decode(sbon::Reader(&ss), point);
+	CHECK_EQ(point.x, 4);
+	CHECK_EQ(point.y, 0);
+	CHECK_EQ(point.label, "default");
+}
+
+TEST_CASE("Code inferred from keys which aren't identifiers") {
+	// Generated from tests/schemas/keys.sbon, whose keys sanitize
+	// to the same names, to keywords or to the names of structs,
+	// or have to be escaped in a C++ string
+	const char bytes[] = "{Message\0" "5a-b\0" "1a_b\0" "2class\0Sx\0-\0{v\0" "1}item\0{-\0{w\0T}}"
+		"a\nb\0T\xc3\xa9\x01\0" "3q\"\\\0Sq\0}";
+	std::string example(bytes, sizeof(bytes) - 1);
+
+	keys::Message msg;
+	std::stringstream ss(example);
+	decode(sbon::Reader(&ss), msg);
+	CHECK_EQ(msg.Message3, 5);
+	CHECK_EQ(msg.a_b, 1);
+	CHECK_EQ(msg.a_b2, 2);
+	CHECK_EQ(msg.class_, "x");
+	CHECK_EQ(msg._.v, 1);
+	CHECK(msg.item._.w);
+	CHECK(msg.a_b3);
+	CHECK_EQ(msg.___, 3);
+	CHECK_EQ(msg.q__, "q");
+
+	std::stringstream out;
+	encode(sbon::Writer(&out), msg);
+	CHECK(out.str() == example);
+}
@@ -0,0 +1,163 @@
+#include <sbon-columns.h>
+
+#include <sstream>
+
+#include "test.h"
+
+static std::string rows() {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeArray([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("id").writeInt(1);
+			w.key("price").writeDouble(2.5);
+			w.key("name").writeString("apple");
+			w.key("ok").writeBool(true);
+		});
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("ok").writeBool(false);
+			w.key("extra").writeArray([](sbon::Writer w) {
+				w.writeString("skipped");
+			});
+			w.key("name").writeString("pear");
+			w.key("id").writeInt(-2);
+			w.key("price").writeUInt(3);
+		});
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("id").writeNull();
+			w.key("price").writeString("not a number");
+			w.key("name").writeString("first");
+			w.key("name").writeString("plum");
+		});
+	});
+	return ss.str();
+}
+
+TEST_CASE("Column extraction") {
+	std::stringstream ss(rows());
+	sbon::ColumnExtractor ex;
+	ex.add("id", sbon::ColumnType::INT);
+	ex.add("price", sbon::ColumnType::DOUBLE);
+	ex.add("name", sbon::ColumnType::STRING);
+	ex.add("ok", sbon::ColumnType::BOOL);
+
+	CHECK_EQ(ex.extract(sbon::Reader(&ss)), 3);
+	CHECK_EQ(ex.rows(), 3);
+
+	auto &id = *ex.column("id");
+	CHECK(id.ints() == std::vector<std::int64_t>({1, -2, 0}));
+	CHECK(id.valid(0) && id.valid(1) && !id.valid(2));
+	CHECK_EQ(id.nullCount(), 1);
+
+	auto &price = ex.column(1);
+	CHECK(price.doubles() == std::vector<double>({2.5, 3, 0}));
+	CHECK_EQ(price.validity()[0], 0b011);
+
+	auto &name = ex.column(2);
+	CHECK_EQ(name.string(0), "apple");
+	CHECK_EQ(name.string(1), "pear");
+	CHECK_EQ(name.string(2), "plum");
+	CHECK_EQ(name.stringData(), "applepearplum");
+	CHECK(name.offsets() == std::vector<std::uint64_t>({0, 5, 9, 13}));
+	CHECK_EQ(name.nullCount(), 0);
+
+	auto &ok = ex.column(3);
+	CHECK(ok.bools() == std::vector<unsigned char>({1, 0, 0}));
+	CHECK(!ok.valid(2));
+
+	CHECK(ex.column("missing") == nullptr);
+}
+
+TEST_CASE("Column extraction appends across arrays") {
+	sbon::ColumnExtractor ex;
+	ex.add("id", sbon::ColumnType::INT);
+
+	for (int i = 0; i < 30; ++i) {
+		std::stringstream ss(rows());
+		ex.extract(sbon::Reader(&ss));
+	}
+
+	auto &id = ex.column(0);
+	CHECK_EQ(id.size(), 90);
+	CHECK_EQ(id.validity().size(), 2);
+	CHECK_EQ(id.nullCount(), 30);
+	CHECK(id.valid(63));
+	CHECK(!id.valid(65));
+
+	ex.clear();
+	CHECK_EQ(ex.rows(), 0);
+	CHECK_EQ(id.size(), 0);
+	CHECK(id.validity().empty());
+}
+
+TEST_CASE("Column extraction clears values made null by a repeated key") {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeArray([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("id").writeInt(7);
+			w.key("price").writeDouble(1.5);
+			w.key("name").writeString("apple");
+			w.key("ok").writeBool(true);
+			w.key("id").writeNull();
+			w.key("price").writeNull();
+			w.key("name").writeNull();
+			w.key("ok").writeNull();
+		});
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("name").writeString("pear");
+		});
+	});
+
+	sbon::ColumnExtractor ex;
+	ex.add("id", sbon::ColumnType::INT);
+	ex.add("price", sbon::ColumnType::DOUBLE);
+	ex.add("name", sbon::ColumnType::STRING);
+	ex.add("ok", sbon::ColumnType::BOOL);
+	CHECK_EQ(ex.extract(sbon::Reader(&ss)), 2);
+
+	CHECK(ex.column(0).ints() == std::vector<std::int64_t>({0, 0}));
+	CHECK(ex.column(1).doubles() == std::vector<double>({0, 0}));
+	CHECK(ex.column(3).bools() == std::vector<unsigned char>({0, 0}));
+
+	auto &name = ex.column(2);
+	CHECK(!name.valid(0));
+	CHECK_EQ(name.string(0), "");
+	CHECK_EQ(name.string(1), "pear");
+	CHECK_EQ(name.stringData(), "pear");
+	for (std::size_t i = 0; i < 4; ++i) {
+		CHECK_EQ(ex.column(i).nullCount(), i == 2 ? 1u : 2u);
+	}
+}
+
+TEST_CASE("Column extraction makes mismatched values and elements null") {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeArray([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("id").writeUInt(UINT64_MAX);
+			w.key("name").writeString("big");
+		});
+		w.writeString("not an object");
+		w.writeArray([](sbon::Writer w) {
+			w.writeInt(1);
+		});
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("id").writeUInt(9);
+			w.key("name").writeString("small");
+		});
+	});
+
+	sbon::ColumnExtractor ex;
+	ex.add("id", sbon::ColumnType::INT);
+	ex.add("name", sbon::ColumnType::STRING);
+	CHECK_EQ(ex.extract(sbon::Reader(&ss)), 4);
+
+	auto &id = ex.column(0);
+	CHECK(id.ints() == std::vector<std::int64_t>({0, 0, 0, 9}));
+	CHECK_EQ(id.nullCount(), 3u);
+	CHECK(id.valid(3));
+
+	auto &name = ex.column(1);
+	CHECK_EQ(name.string(0), "big");
+	CHECK(!name.valid(1));
+	CHECK(!name.valid(2));
+	CHECK_EQ(name.string(3), "small");
+}
@@ -0,0 +1,275 @@
+#include <sbon-container.h>
+
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+static void writeRecord(sbon::Writer w, std::size_t i) {
+	w.writeObject([&](sbon::ObjectWriter w) {
+		w.key("id").writeUInt(i);
+		w.key("name").writeString("record " + std::to_string(i));
+		w.key("tags").writeArray([&](sbon::Writer w) {
+			w.writeString("hello");
+			w.writeString("world");
+		});
+	});
+}
+
+static std::string writeContainer(std::size_t count, std::size_t blockSize) {
+	std::stringstream ss;
+	sbon::ContainerOStream os(&ss, blockSize);
+	sbon::Writer w(&os);
+	for (std::size_t i = 0; i < count; ++i) {
+		writeRecord(w, i);
+		os.endValue();
+	}
+	os.close();
+	return ss.str();
+}
+
+static std::uint64_t readId(sbon::Reader r) {
+	std::uint64_t id = ~(std::uint64_t)0;
+	r.getObject([&](sbon::ObjectReader obj) {
+		std::string key;
+		while (obj.hasNext()) {
+			sbon::Reader val = obj.next(key);
+			if (key == "id") {
+				id = val.getUInt();
+			} else {
+				val.skip();
+			}
+		}
+	});
+	return id;
+}
+
+TEST_CASE("LZ codec round trip") {
+	std::string random;
+	std::uint32_t state = 1;
+	for (int i = 0; i < 10000; ++i) {
+		state = state * 1103515245 + 12345;
+		random += (char)(state >> 24);
+	}
+
+	std::string inputs[] = {
+		"",
+		"a",
+		"abc",
+		std::string(10000, 'a'),
+		"abcabcabcabcabcabcabcabcabcabcxyz",
+		random,
+		random + random,
+	};
+
+	for (auto &input: inputs) {
+		std::string compressed = sbon::lz::compress(input);
+		std::string output;
+		sbon::lz::decompress(compressed, output, input.size());
+		CHECK(output == input);
+	}
+
+	CHECK(sbon::lz::compress(std::string(10000, 'a')).size() < 100);
+}
+
+TEST_CASE("Container round trip") {
+	std::string file = writeContainer(1000, 1024);
+	std::stringstream raw;
+	sbon::Writer w(&raw);
+	for (std::size_t i = 0; i < 1000; ++i) {
+		writeRecord(w, i);
+	}
+	CHECK(file.size() < raw.str().size());
+
+	std::istringstream is(file);
+	sbon::ContainerIStream cs(&is);
+	sbon::Reader r(&cs);
+	std::size_t count = 0;
+	while (r.hasNext()) {
+		CHECK_EQ(readId(r), count);
+		count += 1;
+	}
+	CHECK_EQ(count, 1000u);
+}
+
+TEST_CASE("Container block table") {
+	std::string file = writeContainer(1000, 1024);
+	std::istringstream is(file);
+	sbon::ContainerIStream cs(&is);
+
+	auto &blocks = cs.blocks();
+	REQUIRE(blocks.size() > 10);
+	std::uint64_t rawOffset = 0;
+	for (auto &block: blocks) {
+		CHECK_EQ(block.rawOffset, rawOffset);
+		CHECK(block.flags & sbon::ContainerBlock::VALUE_START);
+		CHECK(block.flags & sbon::ContainerBlock::COMPRESSED);
+		rawOffset += block.rawSize;
+	}
+
+	// Reading sequentially still works after the table is loaded
+	sbon::Reader r(&cs);
+	CHECK_EQ(readId(r), 0u);
+}
+
+TEST_CASE("Container seeking") {
+	std::string file = writeContainer(1000, 1024);
+	std::istringstream is(file);
+	sbon::ContainerIStream cs(&is);
+	auto &blocks = cs.blocks();
+	REQUIRE(blocks.size() > 5);
+
+	cs.seekg((std::streamoff)blocks[5].rawOffset);
+	CHECK_EQ((std::uint64_t)cs.tellg(), blocks[5].rawOffset);
+	sbon::Reader r(&cs);
+	std::uint64_t first = readId(r);
+	CHECK(first > 0);
+
+	// The rest of the stream follows the seeked-to block
+	std::uint64_t expected = first + 1;
+	while (r.hasNext()) {
+		CHECK_EQ(readId(r), expected);
+		expected += 1;
+	}
+	CHECK_EQ(expected, 1000u);
+
+	cs.clear();
+	cs.seekg(0);
+	sbon::Reader r2(&cs);
+	CHECK_EQ(readId(r2), 0u);
+}
+
+TEST_CASE("Container parallel decompression") {
+	std::string file = writeContainer(1000, 1024);
+	std::istringstream is(file);
+	sbon::ContainerIStream cs(&is);
+
+	std::mutex mut;
+	std::vector<int> seen(1000);
+	sbon::forEachBlock(cs, [&](std::size_t, std::string_view raw) {
+		sbon::SpanIStream block(raw);
+		sbon::Reader r(&block);
+		while (r.hasNext()) {
+			std::uint64_t id = readId(r);
+			std::lock_guard<std::mutex> lock(mut);
+			seen[id] += 1;
+		}
+	}, 4);
+
+	for (int n: seen) {
+		CHECK_EQ(n, 1);
+	}
+}
+
+TEST_CASE("Container values spanning blocks") {
+	std::stringstream ss;
+	{
+		sbon::ContainerOStream os(&ss, 64);
+		sbon::Writer w(&os);
+		w.writeString(std::string(1000, 'x'));
+		os.close();
+		CHECK(os.blocks().size() > 10);
+		CHECK(!(os.blocks()[1].flags & sbon::ContainerBlock::VALUE_START));
+	}
+
+	std::istringstream is(ss.str());
+	sbon::ContainerIStream cs(&is);
+	sbon::Reader r(&cs);
+	std::string str;
+	r.getString(str);
+	CHECK(str == std::string(1000, 'x'));
+	CHECK(!r.hasNext());
+}
+
+TEST_CASE("Container checksums") {
+	std::string file = writeContainer(100, 1024);
+	file[4 + sbon::ContainerBlock::HEADER_SIZE + 10] ^= 0x55;
+
+	std::istringstream is(file);
+	sbon::ContainerIStream cs(&is);
+	cs.exceptions(std::ios::badbit);
+	bool threw = false;
+	try {
+		sbon::Reader r(&cs);
+		while (r.hasNext()) {
+			r.skip();
+		}
+	} catch (sbon::ParseError &) {
+		threw = true;
+	} catch (std::ios::failure &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+static bool openThrows(const std::string &file) {
+	try {
+		std::istringstream is(file);
+		sbon::ContainerIStream cs(&is);
+		cs.exceptions(std::ios::badbit);
+		cs.blocks();
+		sbon::Reader r(&cs);
+		while (r.hasNext()) {
+			r.skip();
+		}
+	} catch (sbon::ParseError &) {
+		return true;
+	} catch (std::ios::failure &) {
+		return true;
+	}
+	return false;
+}
+
+TEST_CASE("Container rejects corrupt sizes") {
+	std::string file = writeContainer(100, 1024);
+	CHECK(!openThrows(file));
+
+	// A huge block count in the trailer
+	std::string bad = file;
+	bad[bad.size() - 6] = (char)0x7f;
+	CHECK(openThrows(bad));
+
+	// A table offset past the trailer
+	bad = file;
+	bad[bad.size() - 14] = (char)0x7f;
+	CHECK(openThrows(bad));
+
+	// A huge raw size in the first block's header
+	bad = file;
+	bad[4 + 3] = (char)0x7f;
+	CHECK(openThrows(bad));
+}
+
+TEST_CASE("Container table from several threads") {
+	std::string file = writeContainer(1000, 1024);
+	std::istringstream is(file);
+	sbon::ContainerIStream cs(&is);
+
+	std::vector<std::thread> threads;
+	std::vector<std::size_t> counts(4);
+	for (std::size_t t = 0; t < counts.size(); ++t) {
+		threads.emplace_back([&, t] {
+			std::string raw;
+			cs.readBlock(t, raw);
+			counts[t] = cs.blocks().size();
+		});
+	}
+	for (auto &thread: threads) {
+		thread.join();
+	}
+
+	for (auto count: counts) {
+		CHECK_EQ(count, cs.blocks().size());
+	}
+
+	bool threw = false;
+	try {
+		std::string raw;
+		cs.readBlock(cs.blocks().size(), raw);
+	} catch (sbon::LogicError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
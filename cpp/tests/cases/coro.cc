@@ -0,0 +1,165 @@
+#include <sbon-coro.h>
+
+#include <sstream>
+
+#include "test.h"
+
+static std::string encode(const char *buf, std::size_t size) {
+	return std::string(buf, size - 1);
+}
+
+namespace {
+
+// Runs eagerly until its first suspension, and cleans up after itself.
+struct Task {
+	struct promise_type {
+		Task get_return_object() {
+			return {};
+		}
+
+		std::suspend_never initial_suspend() noexcept {
+			return {};
+		}
+
+		std::suspend_never final_suspend() noexcept {
+			return {};
+		}
+
+		void return_void() {}
+
+		void unhandled_exception() {
+			std::terminate();
+		}
+	};
+};
+
+}
+
+static std::string describe(const sbon::Event &ev) {
+	switch (ev.type) {
+	case sbon::EventType::BOOL: return ev.boolean ? "T" : "F";
+	case sbon::EventType::NIL: return "N";
+	case sbon::EventType::STRING: return "S" + ev.str;
+	case sbon::EventType::BINARY: return "B" + std::to_string(ev.bin.size());
+	case sbon::EventType::FLOAT: return "f" + std::to_string(ev.f);
+	case sbon::EventType::DOUBLE: return "d" + std::to_string(ev.d);
+	case sbon::EventType::INT: return std::to_string(ev.i);
+	case sbon::EventType::UINT: return "+" + std::to_string(ev.u);
+	case sbon::EventType::ARRAY_BEGIN: return "[";
+	case sbon::EventType::ARRAY_END: return "]";
+	case sbon::EventType::OBJECT_BEGIN: return "{";
+	case sbon::EventType::OBJECT_END: return "}";
+	case sbon::EventType::KEY: return ev.str + ":";
+	}
+	return "?";
+}
+
+static std::string sample() {
+	std::stringstream ss;
+	sbon::Writer w(&ss);
+	w.writeObject([](sbon::ObjectWriter w) {
+		w.key("a").writeArray([](sbon::Writer w) {
+			w.writeBool(true);
+			w.writeNull();
+			w.writeInt(-300);
+			w.writeUInt(7);
+		});
+		w.key("").writeString("hello");
+		w.key("bin").writeBinary("\0\1\2", 3);
+		w.key("nums").writeObject([](sbon::ObjectWriter w) {
+			w.key("f").writeFloat(1.5);
+			w.key("d").writeDouble(-2.25);
+		});
+	});
+	w.writeUInt(1000);
+	return ss.str();
+}
+
+static const char *sampleEvents =
+	"{ a: [ T N -300 +7 ] : Shello bin: B3 nums: { f: f1.500000 "
+	"d: d-2.250000 } } +1000 ";
+
+TEST_CASE("Event generator") {
+	std::stringstream ss(sample());
+	std::string out;
+	for (auto &ev: sbon::events(&ss)) {
+		out += describe(ev) + " ";
+	}
+	CHECK_EQ(out, sampleEvents);
+}
+
+TEST_CASE("Moved-from event generator") {
+	std::stringstream ss(sample());
+	auto events = sbon::events(&ss);
+	auto moved = std::move(events);
+	CHECK(events.begin() == events.end());
+
+	int count = 0;
+	for (auto &ev: moved) {
+		(void)ev;
+		count += 1;
+	}
+	CHECK(count > 0);
+	CHECK(moved.begin() == moved.end());
+}
+
+TEST_CASE("Event generator reports parse errors") {
+	char buf[] = "[TF";
+	std::stringstream ss(encode(buf, sizeof(buf)));
+	int count = 0;
+	bool threw = false;
+	try {
+		for (auto &ev: sbon::events(&ss)) {
+			(void)ev;
+			count += 1;
+		}
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK_EQ(count, 3);
+}
+
+TEST_CASE("Event parser needs more input") {
+	sbon::EventParser parser;
+	CHECK(parser.next() == nullptr);
+	CHECK(!parser.done());
+
+	char buf[] = "Sab";
+	parser.feed(encode(buf, sizeof(buf)));
+	CHECK(parser.next() == nullptr);
+	parser.feed(std::string_view("c\0", 2));
+	auto *ev = parser.next();
+	REQUIRE(ev);
+	CHECK_EQ(ev->str, "abc");
+
+	parser.finish();
+	CHECK(parser.next() == nullptr);
+	CHECK(parser.done());
+}
+
+static Task collect(sbon::AsyncReader &reader, std::string &out) {
+	while (const sbon::Event *ev = co_await reader.next()) {
+		out += describe(*ev) + " ";
+	}
+	out += "end";
+}
+
+TEST_CASE("Interleaved async readers") {
+	std::string data = sample();
+	sbon::AsyncReader a, b;
+	std::string outA, outB;
+	collect(a, outA);
+	collect(b, outB);
+
+	for (char ch: data) {
+		a.feed({&ch, 1});
+		b.feed({&ch, 1});
+	}
+
+	CHECK_EQ(outA, sampleEvents);
+	a.finish();
+	b.finish();
+	CHECK_EQ(outA, std::string(sampleEvents) + "end");
+	CHECK_EQ(outB, outA);
+}
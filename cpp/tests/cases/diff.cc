@@ -0,0 +1,169 @@
+#include <sbon-diff.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "test.h"
+
+using namespace std::literals;
+
+template<typename Func>
+static std::string encode(Func func) {
+	std::stringstream ss;
+	func(sbon::Writer(&ss));
+	return ss.str();
+}
+
+static std::string user(const char *name, std::uint64_t age, bool withTags) {
+	return encode([&](sbon::Writer w) {
+		w.writeObject([&](sbon::ObjectWriter w) {
+			w.key("id").writeUInt(1234);
+			w.key("name").writeString(name);
+			w.key("address").writeObject([&](sbon::ObjectWriter w) {
+				w.key("street").writeString("Long Street 1");
+				w.key("city").writeString("Oslo");
+				w.key("age").writeUInt(age);
+			});
+			if (withTags) {
+				w.key("tags").writeArray([](sbon::Writer w) {
+					w.writeString("admin");
+					w.writeString("staff");
+				});
+			}
+		});
+	});
+}
+
+TEST_CASE("Diff changed fields") {
+	auto a = user("alice", 30, true);
+	auto b = user("alicia", 31, false);
+	auto patch = sbon::diff(a, b);
+	CHECK(patch.size() < b.size());
+	CHECK(sbon::apply(patch, a) == b);
+
+	std::string name;
+	std::uint64_t age = 0;
+	bool deletedTags = false;
+	std::stringstream ss(patch);
+	sbon::Reader(&ss).readObject([&](const std::string &key, sbon::Reader val) {
+		if (key == "name") {
+			val.readArray([&](sbon::Reader val) {
+				val.getString(name);
+			});
+		} else if (key == "address") {
+			val.readObject([&](const std::string &key, sbon::Reader val) {
+				CHECK(key == "age");
+				val.readArray([&](sbon::Reader val) {
+					age = val.getUInt();
+				});
+			});
+		} else if (key == "tags") {
+			deletedTags = true;
+			val.readArray([](sbon::Reader) {
+				CHECK(false);
+			});
+		} else {
+			CHECK(false);
+		}
+	});
+	CHECK(name == "alicia");
+	CHECK_EQ(age, 31u);
+	CHECK(deletedTags);
+}
+
+TEST_CASE("Diff identical documents") {
+	auto a = user("bob", 40, true);
+	auto patch = sbon::diff(a, a);
+	CHECK(patch == "{}");
+	CHECK(sbon::apply(patch, a) == a);
+	CHECK(sbon::apply(patch, "5") == "5");
+}
+
+TEST_CASE("Diff falls back to replacing") {
+	// Reordered keys can't be expressed as an object patch
+	auto a = encode([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("x").writeUInt(1);
+			w.key("y").writeUInt(2);
+		});
+	});
+	auto b = encode([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("y").writeUInt(2);
+			w.key("x").writeUInt(1);
+		});
+	});
+	auto patch = sbon::diff(a, b);
+	CHECK(patch == "[" + b + "]");
+	CHECK(sbon::apply(patch, a) == b);
+
+	// Setting null and adding keys are expressible, unlike in a JSON merge patch
+	auto c = encode([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("x").writeNull();
+			w.key("y").writeUInt(2);
+			w.key("z").writeArray([](sbon::Writer w) {
+				w.writeUInt(3);
+			});
+		});
+	});
+	CHECK(sbon::apply(sbon::diff(a, c), a) == c);
+
+	CHECK(sbon::diff("5", "Shi\0"sv) == "[Shi\0]"sv);
+	CHECK(sbon::apply(sbon::diff("5", a), "5") == a);
+	CHECK(sbon::apply(sbon::diff(a, "N"), a) == "N");
+}
+
+TEST_CASE("Apply rejects bad patches") {
+	auto a = user("carol", 50, false);
+	for (auto patch: {"[]"sv, "5"sv, "{name\0{x\0[5]}}"sv, "[12]"sv, "{x\0[]x\0[]}"sv}) {
+		bool threw = false;
+		try {
+			sbon::apply(patch, a);
+		} catch (sbon::ParseError &) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+}
+
+TEST_CASE("Diff random documents") {
+	std::uint64_t state = 42;
+	auto next = [&](std::uint64_t n) {
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return (state >> 33) % n;
+	};
+
+	for (int round = 0; round < 200; ++round) {
+		// Both documents pick from the same small set of keys and values,
+		// so some fields match and some don't
+		auto makeDoc = [&] {
+			return encode([&](sbon::Writer w) {
+				w.writeObject([&](sbon::ObjectWriter w) {
+					for (int i = 0; i < 6; ++i) {
+						if (next(3) == 0) {
+							continue;
+						}
+
+						std::string key = "k" + std::to_string(i);
+						if (next(2) == 0) {
+							w.key(key.c_str()).writeObject([&](sbon::ObjectWriter w) {
+								for (int j = 0; j < 3; ++j) {
+									std::string inner = "i" + std::to_string(j);
+									w.key(inner.c_str()).writeUInt(next(2));
+								}
+							});
+						} else {
+							w.key(key.c_str()).writeUInt(next(3));
+						}
+					}
+				});
+			});
+		};
+
+		auto a = makeDoc();
+		auto b = makeDoc();
+		CHECK(sbon::apply(sbon::diff(a, b), a) == b);
+	}
+}
@@ -0,0 +1,86 @@
+#include <sbon-fixed.h>
+
+#include <string_view>
+
+#include "test.h"
+
+TEST_CASE("Fixed output stream") {
+	sbon::FixedOStream<32> os;
+	sbon::Writer w(&os);
+	w.writeObject([](sbon::ObjectWriter w) {
+		w.key("a").writeInt(5);
+		w.key("b").writeString("hi");
+	});
+
+	char expected[] = "{a\0005b\0Shi\0}";
+	CHECK(os.view() == std::string_view(expected, sizeof(expected) - 1));
+	CHECK(!os.overflowed());
+
+	os.reset();
+	sbon::Writer(&os).writeString("this string is far too long to fit");
+	CHECK(os.overflowed());
+	CHECK_EQ(os.view().size(), 32);
+
+	os.reset();
+	CHECK(!os.overflowed());
+	CHECK(os.view().empty());
+}
+
+TEST_CASE("Fixed strings and keys") {
+	char buf[] = "{short\0Sabc\0binary\0B\x03xyz}";
+	sbon::SpanIStream is(std::string_view(buf, sizeof(buf) - 1));
+	sbon::Error err;
+	sbon::Reader r(&is, &err);
+
+	sbon::FixedString<6> key;
+	sbon::FixedString<8> str;
+	unsigned char bin[4];
+	std::size_t binSize = 0;
+	r.getObject([&](sbon::ObjectReader obj) {
+		while (obj.hasNext()) {
+			auto val = obj.next(key);
+			if (key == "short") {
+				val.getString(str);
+			} else if (key == "binary") {
+				binSize = val.getBinary(bin, sizeof(bin));
+			} else {
+				val.skip();
+			}
+		}
+	});
+
+	CHECK(!err);
+	CHECK_EQ(std::string_view(str), "abc");
+	CHECK_EQ(binSize, 3);
+	CHECK(bin[2] == 'z');
+}
+
+TEST_CASE("Fixed strings reject long values") {
+	char buf[] = "{a key which is too long\0T}";
+	sbon::SpanIStream is(std::string_view(buf, sizeof(buf) - 1));
+	sbon::Error err;
+	sbon::Reader r(&is, &err);
+
+	sbon::FixedString<8> key;
+	int count = 0;
+	r.matchObject({
+		{"a", [&](sbon::Reader) {
+			count += 1;
+		}},
+	}, key);
+
+	CHECK(err.code == sbon::ErrorCode::TOO_LONG);
+	CHECK_EQ(count, 0);
+
+	char strBuf[] = "Stoo long\0";
+	sbon::SpanIStream strIs(std::string_view(strBuf, sizeof(strBuf) - 1));
+	sbon::Reader strReader(&strIs);
+	sbon::FixedString<4> str;
+	bool threw = false;
+	try {
+		strReader.getString(str);
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
@@ -0,0 +1,188 @@
+#include <sbon-hash.h>
+
+#include <limits>
+#include <sstream>
+
+#include "test.h"
+
+static std::string encode(const char *buf, std::size_t size) {
+	return std::string(buf, size - 1);
+}
+
+template<typename Func>
+static std::string write(Func func) {
+	std::stringstream ss;
+	func(sbon::Writer(&ss));
+	return ss.str();
+}
+
+static std::uint64_t hashOf(const std::string &doc) {
+	std::stringstream ss(doc);
+	return sbon::hash(sbon::Reader(&ss));
+}
+
+static bool equalDocs(const std::string &a, const std::string &b) {
+	std::stringstream ssA(a);
+	std::stringstream ssB(b);
+	bool eq = sbon::equal(sbon::Reader(&ssA), sbon::Reader(&ssB));
+	CHECK(ssA.peek() == EOF);
+	CHECK(ssB.peek() == EOF);
+	if (eq) {
+		CHECK(hashOf(a) == hashOf(b));
+	}
+	return eq;
+}
+
+TEST_CASE("Equivalent number encodings") {
+	char imm[] = "3";
+	char leb[] = "+\x03";
+	std::string three[] = {
+		encode(imm, sizeof(imm)),
+		encode(leb, sizeof(leb)),
+		write([](sbon::Writer w) { w.writeFloat(3); }),
+		write([](sbon::Writer w) { w.writeDouble(3); }),
+	};
+
+	for (auto &a: three) {
+		for (auto &b: three) {
+			CHECK(equalDocs(a, b));
+		}
+	}
+
+	auto minusTwo = write([](sbon::Writer w) { w.writeInt(-2); });
+	auto minusTwoDouble = write([](sbon::Writer w) { w.writeDouble(-2); });
+	CHECK(equalDocs(minusTwo, minusTwoDouble));
+	CHECK(!equalDocs(three[0], minusTwo));
+
+	auto half = write([](sbon::Writer w) { w.writeFloat(0.5); });
+	auto halfDouble = write([](sbon::Writer w) { w.writeDouble(0.5); });
+	auto tenth = write([](sbon::Writer w) { w.writeFloat(0.1f); });
+	auto tenthDouble = write([](sbon::Writer w) { w.writeDouble(0.1); });
+	CHECK(equalDocs(half, halfDouble));
+	CHECK(!equalDocs(tenth, tenthDouble));
+
+	auto zero = write([](sbon::Writer w) { w.writeUInt(0); });
+	auto negZero = write([](sbon::Writer w) { w.writeDouble(-0.0); });
+	CHECK(equalDocs(zero, negZero));
+}
+
+TEST_CASE("NaNs are one value") {
+	char quietFloat[] = "f\x00\x00\xc0\x7f";
+	char payloadFloat[] = "f\x01\x00\xc0\xff";
+	char quietDouble[] = "d\x00\x00\x00\x00\x00\x00\xf8\x7f";
+	char payloadDouble[] = "d\x01\x00\x00\x00\x00\x00\xf0\x7f";
+	std::string nans[] = {
+		encode(quietFloat, sizeof(quietFloat)),
+		encode(payloadFloat, sizeof(payloadFloat)),
+		encode(quietDouble, sizeof(quietDouble)),
+		encode(payloadDouble, sizeof(payloadDouble)),
+	};
+
+	for (auto &a: nans) {
+		for (auto &b: nans) {
+			CHECK(equalDocs(a, b));
+			CHECK(equalDocs("[" + a + "1]", "[" + b + "1]"));
+		}
+	}
+
+	auto inf = write([](sbon::Writer w) { w.writeDouble(std::numeric_limits<double>::infinity()); });
+	auto zero = write([](sbon::Writer w) { w.writeUInt(0); });
+	CHECK(!equalDocs(nans[0], inf));
+	CHECK(!equalDocs(nans[3], zero));
+	CHECK(hashOf(nans[0]) != hashOf(inf));
+}
+
+TEST_CASE("Structural equality") {
+	auto doc = [](int num, const char *second) {
+		return write([&](sbon::Writer w) {
+			w.writeObject([&](sbon::ObjectWriter w) {
+				w.key("list").writeArray([&](sbon::Writer w) {
+					w.writeInt(num);
+					w.writeString("str");
+					w.writeBinary("\0\1", 2);
+					w.writeNull();
+				});
+				w.key(second).writeBool(true);
+			});
+		});
+	};
+
+	CHECK(equalDocs(doc(1, "b"), doc(1, "b")));
+	CHECK(!equalDocs(doc(1, "b"), doc(2, "b")));
+	CHECK(!equalDocs(doc(1, "b"), doc(1, "c")));
+	CHECK(hashOf(doc(1, "b")) != hashOf(doc(2, "b")));
+
+	auto ab = write([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("a").writeInt(1);
+			w.key("b").writeInt(2);
+		});
+	});
+	auto ba = write([](sbon::Writer w) {
+		w.writeObject([](sbon::ObjectWriter w) {
+			w.key("b").writeInt(2);
+			w.key("a").writeInt(1);
+		});
+	});
+	CHECK(!equalDocs(ab, ba));
+	CHECK(hashOf(ab) != hashOf(ba));
+
+	auto shortArr = write([](sbon::Writer w) {
+		w.writeArray([](sbon::Writer w) {
+			w.writeInt(1);
+		});
+	});
+	auto longArr = write([](sbon::Writer w) {
+		w.writeArray([](sbon::Writer w) {
+			w.writeInt(1);
+			w.writeArray([](sbon::Writer) {});
+		});
+	});
+	CHECK(!equalDocs(shortArr, longArr));
+	CHECK(!equalDocs(longArr, shortArr));
+}
+
+TEST_CASE("Hashing long strings doesn't depend on chunking") {
+	std::string big(sbon::Reader::CHUNK_SIZE * 3 + 5, 'a');
+	auto a = write([&](sbon::Writer w) { w.writeString(big); });
+	big.back() = 'b';
+	auto b = write([&](sbon::Writer w) { w.writeString(big); });
+	CHECK(!equalDocs(a, b));
+	CHECK(hashOf(a) != hashOf(b));
+	CHECK(hashOf(a) == hashOf(a));
+}
+
+TEST_CASE("Comparing long strings and binaries in chunks") {
+	constexpr std::size_t CHUNK = sbon::Reader::CHUNK_SIZE;
+	auto str = [](std::size_t size, std::size_t diffAt) {
+		std::string val(size, 'a');
+		if (diffAt < size) {
+			val[diffAt] = 'b';
+		}
+		return write([&](sbon::Writer w) { w.writeString(val); });
+	};
+	auto bin = [](std::size_t size, std::size_t diffAt) {
+		std::string val(size, 'a');
+		if (diffAt < size) {
+			val[diffAt] = 'b';
+		}
+		return write([&](sbon::Writer w) { w.writeBinary(val.data(), val.size()); });
+	};
+
+	for (std::size_t size: {CHUNK, CHUNK * 3 + 5}) {
+		CHECK(equalDocs(str(size, size), str(size, size)));
+		CHECK(equalDocs(bin(size, size), bin(size, size)));
+		CHECK(!equalDocs(str(size, size), str(size, 0)));
+		CHECK(!equalDocs(bin(size, size), bin(size, size - 1)));
+		CHECK(!equalDocs(str(size, size), str(size + 1, size + 1)));
+		CHECK(!equalDocs(bin(size + 1, size + 1), bin(size, size)));
+		CHECK(!equalDocs(str(size, size), bin(size, size)));
+	}
+
+	// The readers stay in step after values which differ
+	auto arr = [&](const std::string &first) {
+		return "[" + first + str(10, 10) + "]";
+	};
+	CHECK(!equalDocs(arr(str(CHUNK * 2, 3)), arr(str(CHUNK * 2, CHUNK * 2))));
+	CHECK(equalDocs(arr(bin(CHUNK * 2, 3)), arr(bin(CHUNK * 2, 3))));
+}
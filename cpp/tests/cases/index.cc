@@ -0,0 +1,278 @@
+#include <sbon-index.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+static void writeRecords(std::ostream *os, sbon::ArrayIndex &index, int count) {
+	sbon::writeIndexedArray(os, index, [&](sbon::IndexedArrayWriter arr) {
+		for (int i = 0; i < count; ++i) {
+			arr.next().writeObject([&](sbon::ObjectWriter w) {
+				w.key("id").writeInt(i);
+				w.key("name").writeString(std::string(i % 7, 'x'));
+			});
+		}
+	});
+}
+
+static int readId(sbon::Reader r) {
+	int id = -1;
+	r.matchObject({
+		{"id", [&](sbon::Reader val) {
+			id = val.getInt();
+		}},
+	});
+	return id;
+}
+
+TEST_CASE("Indexed array") {
+	std::stringstream ss;
+	sbon::ArrayIndex index(4);
+	writeRecords(&ss, index, 10);
+
+	CHECK(index.count() == 10);
+	CHECK(index.offsets().size() == 3);
+	CHECK(index.offsets()[0] == 1);
+
+	// The array itself is just a normal array
+	int count = 0;
+	sbon::Reader(&ss).readArray([&](sbon::Reader val) {
+		CHECK(readId(val) == count);
+		count += 1;
+	});
+	CHECK(count == 10);
+
+	for (int k: {0, 3, 4, 5, 9, 2}) {
+		auto arr = index.seek(&ss, k);
+		CHECK(readId(arr.next()) == k);
+	}
+
+	// Iteration continues to the end of the array
+	auto arr = index.seek(&ss, 7);
+	count = 0;
+	arr.all([&](sbon::Reader val) {
+		CHECK(readId(val) == 7 + count);
+		count += 1;
+	});
+	CHECK(count == 3);
+
+	bool threw = false;
+	try {
+		index.seek(&ss, 10);
+	} catch (sbon::LogicError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE("Indexed array not at the start of the stream") {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeString("header");
+	std::streamoff start = ss.tellp();
+
+	sbon::ArrayIndex index(3);
+	writeRecords(&ss, index, 8);
+
+	auto arr = index.seek(&ss, 6, start);
+	CHECK(readId(arr.next()) == 6);
+}
+
+TEST_CASE("Array index sidecar") {
+	std::stringstream data;
+	sbon::ArrayIndex index(2);
+	writeRecords(&data, index, 5);
+
+	std::stringstream sidecar;
+	index.write(sbon::Writer(&sidecar));
+
+	sbon::ArrayIndex loaded;
+	loaded.read(sbon::Reader(&sidecar));
+	CHECK(loaded.stride() == 2);
+	CHECK(loaded.count() == 5);
+	CHECK(loaded.offsets() == index.offsets());
+	CHECK(readId(loaded.seek(&data, 3).next()) == 3);
+}
+
+TEST_CASE("Hostile index sidecars") {
+	// A count near the maximum must not wrap around to no offsets
+	auto hostile = [](bool keys) {
+		std::stringstream ss;
+		sbon::Writer(&ss).writeObject([&](sbon::ObjectWriter w) {
+			w.key("stride").writeUInt(2);
+			w.key("count").writeUInt(UINT64_MAX);
+			if (keys) {
+				w.key("keys").writeArray([](sbon::Writer) {});
+			}
+			w.key("offsets").writeArray([](sbon::Writer) {});
+		});
+		return ss.str();
+	};
+
+	bool threw = false;
+	try {
+		std::stringstream ss(hostile(false));
+		sbon::ArrayIndex index;
+		index.read(sbon::Reader(&ss));
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+
+	threw = false;
+	try {
+		std::stringstream ss(hostile(true));
+		sbon::ObjectIndex index;
+		index.read(sbon::Reader(&ss));
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE("Array index trailer") {
+	std::stringstream ss;
+	sbon::ArrayIndex index(16);
+	writeRecords(&ss, index, 100);
+	index.writeTrailer(&ss);
+
+	sbon::ArrayIndex loaded;
+	loaded.readTrailer(&ss);
+	CHECK(loaded.count() == 100);
+	CHECK(readId(loaded.seek(&ss, 77).next()) == 77);
+
+	// A file with a trailer is still a valid stream of SBON values
+	ss.clear();
+	ss.seekg(0);
+	sbon::Reader r(&ss);
+	int values = 0;
+	while (r.hasNext()) {
+		r.skip();
+		values += 1;
+	}
+	CHECK(values == 3);
+}
+
+static void writeFeatures(sbon::SortedObjectWriter &w, int count) {
+	// Written in descending order, so they all have to be reordered
+	for (int i = count - 1; i >= 0; --i) {
+		std::string key = "f" + std::to_string(1000 + i);
+		w.key(key.c_str()).writeInt(i);
+	}
+}
+
+TEST_CASE("Sorted objects") {
+	std::stringstream ss;
+	sbon::writeSortedObject(sbon::Writer(&ss), [](sbon::SortedObjectWriter &w) {
+		w.key("b").writeUInt(2);
+		w.key("a").writeArray([](sbon::Writer w) {
+			w.writeUInt(1);
+		});
+		w.key("c").writeString("three");
+		w.key("a").writeUInt(4);
+	});
+
+	std::vector<std::string> keys;
+	sbon::Reader(&ss).readObject([&](const std::string &key, sbon::Reader val) {
+		keys.push_back(key);
+		val.skip();
+	});
+	CHECK((keys == std::vector<std::string>{"a", "a", "b", "c"}));
+
+	// Keys found in ascending order share one pass over the object
+	ss.clear();
+	ss.seekg(0);
+	std::uint64_t b = 0;
+	bool foundMissing = true;
+	sbon::Reader(&ss).getObject([&](sbon::ObjectReader obj) {
+		CHECK(obj.find("b", [&](sbon::Reader val) { b = val.getUInt(); }));
+		foundMissing = obj.find("bb", [](sbon::Reader) {});
+
+		// The search stopped at "c", which is still the next entry
+		CHECK(obj.hasNext());
+		std::string c;
+		CHECK(obj.find("c", [&](sbon::Reader val) { c = val.getString(); }));
+		CHECK(!obj.hasNext());
+		CHECK_EQ(c, "three");
+	});
+	CHECK_EQ(b, 2u);
+	CHECK(!foundMissing);
+
+	// Other readers also see the entry where find() stopped
+	ss.clear();
+	ss.seekg(0);
+	sbon::Reader(&ss).getObject([&](sbon::ObjectReader obj) {
+		CHECK(!obj.find("ab", [](sbon::Reader) {}));
+		CHECK(!obj.find("b0", [](sbon::Reader) {}));
+		std::string key;
+		auto val = obj.next(key);
+		CHECK_EQ(key, "c");
+		CHECK_EQ(val.getString(), "three");
+		CHECK(!obj.hasNext());
+	});
+
+	ss.clear();
+	ss.seekg(0);
+	sbon::Reader(&ss).getObject([&](sbon::ObjectReader obj) {
+		CHECK(obj.find("a", [](sbon::Reader val) { val.skip(); }));
+		CHECK(obj.hasNext());
+		obj.skipRest();
+	});
+}
+
+TEST_CASE("Object find stops at a greater key") {
+	std::stringstream ss;
+	sbon::writeSortedObject(sbon::Writer(&ss), [](sbon::SortedObjectWriter &w) {
+		writeFeatures(w, 100);
+	});
+
+	sbon::Stats stats;
+	sbon::StatsScope scope(stats);
+	sbon::Reader(&ss).getObject([&](sbon::ObjectReader obj) {
+		// Keys f1000 to f1010 are less, and f1011 is greater
+		CHECK(!obj.find("f1010x", [](sbon::Reader) {}));
+		CHECK_EQ(stats.matchMisses, 12u);
+
+		int val = -1;
+		CHECK(obj.find("f1050", [&](sbon::Reader r) { val = r.getInt(); }));
+		CHECK_EQ(val, 50);
+		CHECK_EQ(stats.matchHits, 1u);
+		obj.skipRest();
+	});
+}
+
+TEST_CASE("Object index") {
+	std::stringstream ss;
+	ss << "T";
+	sbon::ObjectIndex index(8);
+	sbon::writeIndexedObject(&ss, index, [](sbon::SortedObjectWriter &w) {
+		writeFeatures(w, 300);
+	});
+
+	CHECK(index.count() == 300);
+	CHECK(index.keys().size() == 38);
+	CHECK(index.keys()[1] == "f1008");
+	CHECK(index.offsets()[0] == 1);
+
+	for (int i: {0, 7, 8, 150, 299}) {
+		int val = -1;
+		std::string key = "f" + std::to_string(1000 + i);
+		CHECK(index.find(&ss, key, [&](sbon::Reader r) { val = r.getInt(); }, 1));
+		CHECK_EQ(val, i);
+	}
+
+	CHECK(!index.find(&ss, "a", [](sbon::Reader) {}, 1));
+	CHECK(!index.find(&ss, "f1150x", [](sbon::Reader) {}, 1));
+	CHECK(!index.find(&ss, "z", [](sbon::Reader) {}, 1));
+
+	std::stringstream sidecar;
+	index.write(sbon::Writer(&sidecar));
+	sbon::ObjectIndex loaded;
+	loaded.read(sbon::Reader(&sidecar));
+	CHECK(loaded.keys() == index.keys());
+	CHECK(loaded.offsets() == index.offsets());
+	int val = -1;
+	CHECK(loaded.find(&ss, "f1222", [&](sbon::Reader r) { val = r.getInt(); }, 1));
+	CHECK_EQ(val, 222);
+}
@@ -0,0 +1,239 @@
+#include <sbon-io.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <system_error>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+template<typename Writer>
+static void writeDoc(Writer w) {
+	w.writeObject([](auto w) {
+		w.key("name").writeString("hello");
+		w.key("nums").writeArray([](auto w) {
+			w.writeInt(-5);
+			w.writeUInt(1000);
+			w.writeDouble(1.5);
+			w.writeFloat(2.5f);
+		});
+		w.key("bin").writeBinary("\x01\x02\x03", 3);
+		w.key("ok").writeBool(true);
+		w.key("nothing").writeNull();
+	});
+}
+
+template<typename Reader>
+static void checkDoc(Reader r) {
+	std::string name;
+	std::vector<double> nums;
+	std::vector<unsigned char> bin;
+	bool ok = false;
+	r.readObject([&](const std::string &key, Reader val) {
+		if (key == "name") {
+			val.getString(name);
+		} else if (key == "nums") {
+			val.readArray([&](Reader num) {
+				nums.push_back(num.getDouble());
+			});
+		} else if (key == "bin") {
+			val.getBinary(bin);
+		} else if (key == "ok") {
+			ok = val.getBool();
+		} else {
+			val.skip();
+		}
+	});
+
+	CHECK(name == "hello");
+	REQUIRE(nums.size() == 4);
+	CHECK_EQ(nums[0], -5);
+	CHECK_EQ(nums[1], 1000);
+	CHECK_EQ(nums[2], 1.5);
+	CHECK_EQ(nums[3], 2.5);
+	CHECK((bin == std::vector<unsigned char>{1, 2, 3}));
+	CHECK(ok);
+	CHECK(!r.hasNext());
+}
+
+static std::string expectedDoc() {
+	std::stringstream ss;
+	writeDoc(sbon::Writer(&ss));
+	return ss.str();
+}
+
+TEST_CASE("Buffer source and string sink") {
+	std::string doc;
+	sbon::StringSink sink(&doc);
+	writeDoc(sbon::StringWriter(&sink));
+	CHECK(doc == expectedDoc());
+
+	sbon::BufferSource src(doc);
+	checkDoc(sbon::BufferReader(&src));
+	CHECK(src.remaining().empty());
+	CHECK_EQ(src.offset(), doc.size());
+}
+
+TEST_CASE("Buffer source errors") {
+	sbon::BufferSource src(std::string_view("[12X]", 5));
+	sbon::Error err;
+	sbon::BufferReader r(&src, &err);
+	r.readArray([](sbon::BufferReader val) {
+		val.getInt();
+	});
+	CHECK(err.code == sbon::ErrorCode::UNEXPECTED_CHARACTER);
+	CHECK_EQ(err.offset, 4u);
+
+	sbon::BufferSource truncated(std::string_view("S", 1));
+	bool threw = false;
+	try {
+		sbon::BufferReader(&truncated).getString();
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE("Encoded size and exact encoding") {
+	auto expected = expectedDoc();
+	CHECK_EQ(sbon::encodedSize([](auto w) { writeDoc(w); }), expected.size());
+	CHECK(sbon::encodeExact([](auto w) { writeDoc(w); }) == expected);
+
+	// Integers around the LEB128 length boundaries
+	for (std::uint64_t num: {9ull, 10ull, 127ull, 128ull, 16383ull, 16384ull, ~0ull}) {
+		std::stringstream ss;
+		sbon::Writer(&ss).writeUInt(num);
+		CHECK_EQ(sbon::encodedSize([&](auto w) { w.writeUInt(num); }), ss.str().size());
+
+		auto neg = -(std::int64_t)(num >> 1) - 1;
+		ss.str("");
+		sbon::Writer(&ss).writeInt(neg);
+		CHECK_EQ(sbon::encodedSize([&](auto w) { w.writeInt(neg); }), ss.str().size());
+	}
+
+	// A length-prefixed frame, encoded into one buffer
+	auto body = [](auto w) { writeDoc(w); };
+	auto size = sbon::encodedSize(body);
+	auto header = [&](auto w) { w.writeUInt(size); };
+	std::string frame((std::size_t)(sbon::encodedSize(header) + size), '\0');
+	sbon::SpanSink sink(frame.data(), frame.size());
+	header(sbon::SpanWriter(&sink));
+	body(sbon::SpanWriter(&sink));
+	CHECK_EQ(sink.offset(), frame.size());
+
+	sbon::BufferSource src(frame);
+	CHECK_EQ(sbon::BufferReader(&src).getUInt(), expected.size());
+	CHECK(src.remaining() == expected);
+}
+
+TEST_CASE("Span sink overflow") {
+	char buf[4];
+	sbon::SpanSink sink(buf, sizeof(buf));
+	sbon::SpanWriter w(&sink);
+	w.writeUInt(1000);
+	CHECK_EQ(sink.offset(), 3u);
+
+	bool threw = false;
+	try {
+		w.writeString("too long");
+	} catch (sbon::LogicError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE("FILE source and sink") {
+	std::FILE *f = std::tmpfile();
+	REQUIRE(f);
+	{
+		sbon::FileSink sink(f);
+		writeDoc(sbon::FileWriter(&sink));
+		CHECK_EQ(sink.offset(), expectedDoc().size());
+	}
+
+	std::rewind(f);
+	sbon::FileSource src(f);
+	checkDoc(sbon::FileReader(&src));
+	std::fclose(f);
+}
+
+#ifdef SBON_HAS_POSIX
+
+TEST_CASE("File descriptor and mapped file sources") {
+	char path[] = "/tmp/sbon-io-XXXXXX";
+	int fd = mkstemp(path);
+	REQUIRE(fd >= 0);
+	{
+		sbon::FdSink sink(fd);
+		writeDoc(sbon::FdWriter(&sink));
+		CHECK(sink.flush());
+	}
+
+	::lseek(fd, 0, SEEK_SET);
+	sbon::FdSource src(fd);
+	checkDoc(sbon::FdReader(&src));
+	CHECK(!src.failed());
+	::close(fd);
+
+	sbon::MappedSource mapped(path);
+	CHECK(mapped.data() == expectedDoc());
+	checkDoc(sbon::BufferReader(&mapped));
+
+	sbon::MappedSource reopened;
+	CHECK_EQ(reopened.open(path), 0);
+	CHECK(reopened.data() == expectedDoc());
+	::unlink(path);
+
+	bool threw = false;
+	try {
+		sbon::MappedSource missing("/nonexistent/sbon-file");
+	} catch (std::system_error &) {
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK_EQ(reopened.open("/nonexistent/sbon-file"), ENOENT);
+	CHECK(reopened.data().empty());
+}
+
+TEST_CASE("File descriptor sink errors") {
+	sbon::FdSink sink(-1);
+	writeDoc(sbon::FdWriter(&sink));
+	CHECK(!sink.flush());
+	CHECK_EQ(sink.error(), EBADF);
+
+	// Nothing reached the file
+	CHECK_EQ(sink.offset(), 0u);
+}
+
+TEST_CASE("File descriptor source across buffer refills") {
+	std::string big(sbon::FdSource::BUFFER_SIZE * 3, 'x');
+	std::string doc;
+	sbon::StringSink sink(&doc);
+	sbon::StringWriter(&sink).writeArray([&](sbon::StringWriter w) {
+		w.writeString(big);
+		w.writeBinary(big.data(), big.size());
+	});
+
+	std::FILE *f = std::tmpfile();
+	REQUIRE(f);
+	std::fwrite(doc.data(), 1, doc.size(), f);
+	std::rewind(f);
+
+	sbon::FdSource src(fileno(f));
+	sbon::FdReader r(&src);
+	std::string str;
+	std::vector<unsigned char> bin;
+	r.getArray([&](sbon::BasicArrayReader<sbon::FdSource> arr) {
+		arr.next().getString(str);
+		arr.next().getBinary(bin);
+	});
+	CHECK(str == big);
+	CHECK_EQ(bin.size(), big.size());
+	CHECK_EQ(src.offset(), doc.size());
+	std::fclose(f);
+}
+
+#endif
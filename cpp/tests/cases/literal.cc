@@ -0,0 +1,90 @@
+#include <sbon-literal.h>
+
+#include <sstream>
+#include <string_view>
+
+#include "test.h"
+
+static constexpr auto HELLO = sbon::literal<[](sbon::LiteralWriter w) {
+	w.writeObject([](sbon::LiteralObjectWriter w) {
+		w.key("type").writeString("hello");
+		w.key("version").writeUInt(3);
+		w.key("id").writeUInt(1000);
+		w.key("offset").writeInt(-300);
+		w.key("scale").writeDouble(0.5);
+		w.key("ratio").writeFloat(1.25f);
+		w.key("flags").writeArray([](sbon::LiteralWriter w) {
+			w.writeTrue();
+			w.writeFalse();
+			w.writeNull();
+		});
+	});
+}>();
+
+static constexpr auto SEVEN = sbon::literal<[](sbon::LiteralWriter w) {
+	w.writeUInt(7);
+}>();
+static_assert(SEVEN.size() == 1 && SEVEN[0] == '7');
+
+static constexpr auto STRING = sbon::literal<[](sbon::LiteralWriter w) {
+	w.writeString("hi");
+}>();
+static_assert(std::string_view(STRING.data(), STRING.size()) == std::string_view("Shi\0", 4));
+
+static constexpr auto NESTED = sbon::literal<[](sbon::LiteralWriter w) {
+	w.writeArray([](sbon::LiteralWriter w) {
+		w.writeEncoded(SEVEN);
+		w.writeEncoded(STRING);
+	});
+}>();
+static_assert(NESTED.size() == 2 + SEVEN.size() + STRING.size());
+
+TEST_CASE("Literals match the runtime writer") {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeObject([](sbon::ObjectWriter w) {
+		w.key("type").writeString("hello");
+		w.key("version").writeUInt(3);
+		w.key("id").writeUInt(1000);
+		w.key("offset").writeInt(-300);
+		w.key("scale").writeDouble(0.5);
+		w.key("ratio").writeFloat(1.25f);
+		w.key("flags").writeArray([](sbon::Writer w) {
+			w.writeTrue();
+			w.writeFalse();
+			w.writeNull();
+		});
+	});
+
+	CHECK(std::string_view(HELLO.data(), HELLO.size()) == ss.str());
+}
+
+TEST_CASE("Splicing literals") {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeArray([](sbon::Writer w) {
+		w.writeEncoded(HELLO);
+		w.writeUInt(5);
+		w.writeEncoded(SEVEN);
+	});
+
+	sbon::Reader r(&ss);
+	std::string type;
+	std::vector<std::uint64_t> nums;
+	r.readArray([&](sbon::Reader val) {
+		if (val.getType() == sbon::Type::OBJECT) {
+			val.readObject([&](const std::string &key, sbon::Reader val) {
+				if (key == "type") {
+					val.getString(type);
+				} else {
+					val.skip();
+				}
+			});
+		} else {
+			nums.push_back(val.getUInt());
+		}
+	});
+
+	CHECK(type == "hello");
+	REQUIRE(nums.size() == 2);
+	CHECK_EQ(nums[0], 5u);
+	CHECK_EQ(nums[1], 7u);
+}
@@ -0,0 +1,459 @@
+#include <sbon-log.h>
+
+#include <chrono>
+#include <csignal>
+#include <stdexcept>
+#include <system_error>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+#ifdef SBON_HAS_POSIX
+
+#include <sys/resource.h>
+
+static std::string tempPath() {
+	char path[] = "/tmp/sbon-log-XXXXXX";
+	int fd = mkstemp(path);
+	::close(fd);
+	::unlink(path);
+	return path;
+}
+
+static void removeLog(const std::string &path) {
+	::unlink(path.c_str());
+	::unlink((path + ".checkpoint").c_str());
+}
+
+static void writeRecord(sbon::Writer w, std::uint64_t id) {
+	w.writeObject([&](sbon::ObjectWriter w) {
+		w.key("id").writeUInt(id);
+		w.key("msg").writeString("record " + std::to_string(id));
+	});
+}
+
+static void appendRaw(const std::string &path, std::string_view data) {
+	int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+	CHECK_EQ(::write(fd, data.data(), data.size()), (ssize_t)data.size());
+	::close(fd);
+}
+
+static std::vector<std::uint64_t> readIds(sbon::LogTailer &tailer) {
+	std::vector<std::uint64_t> ids;
+	tailer.poll([&](sbon::BufferReader r) {
+		r.readObject([&](const std::string &key, sbon::BufferReader val) {
+			if (key == "id") {
+				ids.push_back(val.getUInt());
+			} else {
+				val.skip();
+			}
+		});
+	});
+	return ids;
+}
+
+TEST_CASE("Log round trip") {
+	std::string path = tempPath();
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 0u);
+		for (std::uint64_t i = 0; i < 100; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, i);
+			});
+		}
+	}
+
+	sbon::LogTailer tailer(path);
+	auto ids = readIds(tailer);
+	REQUIRE(ids.size() == 100);
+	for (std::uint64_t i = 0; i < 100; ++i) {
+		CHECK_EQ(ids[i], i);
+	}
+
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 100u);
+		CHECK_EQ(log.truncated(), 0u);
+	}
+	removeLog(path);
+}
+
+TEST_CASE("Log recovery truncates a torn record") {
+	std::string path = tempPath();
+	std::uint64_t size;
+	{
+		sbon::LogWriter log(path);
+		for (std::uint64_t i = 0; i < 10; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, i);
+			});
+		}
+		log.close();
+		size = log.size();
+	}
+
+	appendRaw(path, std::string_view("{id\0+\x85", 6));
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 10u);
+		CHECK_EQ(log.recovered().size, size);
+		CHECK_EQ(log.truncated(), 6u);
+		CHECK(!log.recovered().corrupt);
+		log.append([&](sbon::Writer w) {
+			writeRecord(w, 10);
+		});
+	}
+
+	// Zeros from a file which grew before its data was written
+	appendRaw(path, std::string(100, '\0'));
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 11u);
+		CHECK_EQ(log.truncated(), 100u);
+	}
+
+	sbon::LogTailer tailer(path);
+	auto ids = readIds(tailer);
+	REQUIRE(ids.size() == 11);
+	CHECK_EQ(ids[10], 10u);
+
+	// Other garbage isn't truncated away
+	appendRaw(path, "XYZ");
+	bool threw = false;
+	try {
+		sbon::LogWriter log(path);
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+	removeLog(path);
+}
+
+TEST_CASE("Log recovery with a torn record before zero fill") {
+	std::string path = tempPath();
+	std::uint64_t size;
+	{
+		sbon::LogWriter log(path);
+		for (std::uint64_t i = 0; i < 2; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, i);
+			});
+		}
+		log.close();
+		size = log.size();
+	}
+
+	// The zeros would complete the torn string
+	appendRaw(path, std::string_view("Sre\0\0\0\0", 7));
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 2u);
+		CHECK_EQ(log.recovered().size, size);
+		CHECK_EQ(log.truncated(), 7u);
+	}
+
+	// ... or make the torn object look corrupt
+	appendRaw(path, std::string_view("{id\0" "5msg\0Sre\0\0\0\0", 17));
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 2u);
+		CHECK(!log.recovered().corrupt);
+		CHECK_EQ(log.truncated(), 17u);
+	}
+
+	// A last record which ends in zeros is complete when nothing follows it
+	{
+		sbon::LogWriter log(path);
+		log.append([](sbon::Writer w) {
+			w.writeDouble(0.0);
+		});
+	}
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 3u);
+		CHECK_EQ(log.truncated(), 0u);
+	}
+	removeLog(path);
+}
+
+TEST_CASE("Log recovery from a checkpoint") {
+	std::string path = tempPath();
+	{
+		sbon::LogWriter log(path);
+		for (std::uint64_t i = 0; i < 100; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, i);
+			});
+		}
+	}
+
+	std::uint64_t size;
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.recovered().records, 100u);
+		CHECK_EQ(log.scannedFrom(), log.size());
+		log.append([&](sbon::Writer w) {
+			writeRecord(w, 100);
+		});
+		log.close();
+		size = log.size();
+	}
+
+	// A torn record after the checkpoint is still truncated, while the
+	// records before it aren't scanned, so damage there goes unnoticed
+	appendRaw(path, std::string_view("{id\0+\x85", 6));
+	int fd = ::open(path.c_str(), O_WRONLY);
+	CHECK_EQ(::pwrite(fd, "X", 1, 0), 1);
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.scannedFrom(), size);
+		CHECK_EQ(log.recovered().records, 101u);
+		CHECK_EQ(log.recovered().size, size);
+		CHECK_EQ(log.truncated(), 6u);
+	}
+
+	sbon::LogOptions opts;
+	opts.checkpoint = false;
+	bool threw = false;
+	try {
+		sbon::LogWriter log(path, opts);
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK_EQ(::pwrite(fd, "{", 1, 0), 1);
+	::close(fd);
+
+	// A checkpoint which doesn't match a replaced log is ignored
+	::unlink(path.c_str());
+	{
+		sbon::LogWriter log(path, opts);
+		for (std::uint64_t i = 0; i < 200; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, 1000 + i);
+			});
+		}
+	}
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.scannedFrom(), 0u);
+		CHECK_EQ(log.recovered().records, 200u);
+	}
+	removeLog(path);
+}
+
+TEST_CASE("Log flush retries only the unwritten bytes") {
+	std::string path = tempPath();
+	struct rlimit old;
+	::getrlimit(RLIMIT_FSIZE, &old);
+	auto oldHandler = ::signal(SIGXFSZ, SIG_IGN);
+
+	sbon::LogOptions opts;
+	opts.syncBytes = 0;
+	opts.syncInterval = std::chrono::milliseconds(0);
+	std::string expected;
+	{
+		sbon::LogWriter log(path, opts);
+		for (std::uint64_t i = 0; i < 20; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, i);
+			});
+		}
+		expected.resize((std::size_t)log.size());
+
+		// The file can't grow past 100 bytes, so the write stops partway
+		struct rlimit limit = old;
+		limit.rlim_cur = 100;
+		::setrlimit(RLIMIT_FSIZE, &limit);
+		bool threw = false;
+		try {
+			log.flush();
+		} catch (std::system_error &) {
+			threw = true;
+		}
+		CHECK(threw);
+		CHECK_EQ(log.size(), expected.size());
+
+		::setrlimit(RLIMIT_FSIZE, &old);
+		log.flush();
+	}
+	::signal(SIGXFSZ, oldHandler);
+
+	sbon::LogTailer tailer(path);
+	auto ids = readIds(tailer);
+	REQUIRE(ids.size() == 20);
+	for (std::uint64_t i = 0; i < 20; ++i) {
+		CHECK_EQ(ids[i], i);
+	}
+	removeLog(path);
+}
+
+TEST_CASE("Log tailing") {
+	std::string path = tempPath();
+	sbon::LogWriter log(path);
+	sbon::LogTailer tailer(path);
+	CHECK(readIds(tailer).empty());
+
+	for (std::uint64_t i = 0; i < 3; ++i) {
+		log.append([&](sbon::Writer w) {
+			writeRecord(w, i);
+		});
+	}
+	log.flush();
+	CHECK_EQ(readIds(tailer).size(), 3u);
+	std::uint64_t resumeAt = tailer.offset();
+	CHECK_EQ(resumeAt, log.size());
+
+	// A record which is only partly written isn't delivered
+	std::string encoded;
+	sbon::StringSink sink(&encoded);
+	sbon::StringWriter(&sink).writeObject([](sbon::StringObjectWriter w) {
+		w.key("id").writeUInt(3);
+	});
+	log.close();
+	appendRaw(path, encoded.substr(0, 3));
+	CHECK(readIds(tailer).empty());
+	CHECK_EQ(tailer.offset(), resumeAt);
+
+	appendRaw(path, encoded.substr(3));
+	auto ids = readIds(tailer);
+	REQUIRE(ids.size() == 1);
+	CHECK_EQ(ids[0], 3u);
+
+	// Resuming from a saved offset
+	sbon::LogTailer resumed(path, resumeAt);
+	ids = readIds(resumed);
+	REQUIRE(ids.size() == 1);
+	CHECK_EQ(ids[0], 3u);
+	removeLog(path);
+}
+
+TEST_CASE("Log tailing with a callback which throws") {
+	std::string path = tempPath();
+	sbon::LogWriter log(path);
+	for (std::uint64_t i = 0; i < 3; ++i) {
+		log.append([&](sbon::Writer w) {
+			writeRecord(w, i);
+		});
+	}
+	log.flush();
+
+	sbon::LogTailer tailer(path);
+	std::vector<std::uint64_t> ids;
+	bool threw = false;
+	try {
+		tailer.poll([&](sbon::BufferReader r) {
+			if (ids.size() == 1) {
+				throw std::runtime_error("oops");
+			}
+			ids.push_back(0);
+			r.skip();
+		});
+	} catch (std::runtime_error &) {
+		threw = true;
+	}
+	CHECK(threw);
+	std::uint64_t first = tailer.offset();
+
+	for (std::uint64_t i = 3; i < 5; ++i) {
+		log.append([&](sbon::Writer w) {
+			writeRecord(w, i);
+		});
+	}
+	log.close();
+
+	// The record it threw on is delivered again
+	ids = readIds(tailer);
+	REQUIRE(ids.size() == 4);
+	for (std::uint64_t i = 0; i < 4; ++i) {
+		CHECK_EQ(ids[i], i + 1);
+	}
+
+	sbon::LogTailer resumed(path, first);
+	CHECK_EQ(readIds(resumed).size(), 4u);
+	removeLog(path);
+}
+
+TEST_CASE("Log tailing before zero fill is recovered") {
+	std::string path = tempPath();
+	std::uint64_t size;
+	{
+		sbon::LogWriter log(path);
+		for (std::uint64_t i = 0; i < 2; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, i);
+			});
+		}
+		log.close();
+		size = log.size();
+	}
+
+	// The zeros would complete the torn string
+	appendRaw(path, std::string_view("Sre\0\0\0\0", 7));
+	sbon::LogTailer tailer(path);
+	CHECK_EQ(readIds(tailer).size(), 2u);
+	CHECK_EQ(tailer.offset(), size);
+
+	// The writer truncates the fill, and the log grows past it again
+	{
+		sbon::LogWriter log(path);
+		CHECK_EQ(log.truncated(), 7u);
+		for (std::uint64_t i = 2; i < 4; ++i) {
+			log.append([&](sbon::Writer w) {
+				writeRecord(w, i);
+			});
+		}
+	}
+
+	auto ids = readIds(tailer);
+	REQUIRE(ids.size() == 2);
+	CHECK_EQ(ids[0], 2u);
+	CHECK_EQ(ids[1], 3u);
+	removeLog(path);
+}
+
+TEST_CASE("Log group commit") {
+	std::string path = tempPath();
+	sbon::LogOptions opts;
+	opts.syncRecords = 4;
+	opts.syncBytes = 0;
+	opts.syncInterval = std::chrono::milliseconds(0);
+
+	sbon::LogWriter log(path, opts);
+	for (std::uint64_t i = 0; i < 3; ++i) {
+		log.append([&](sbon::Writer w) {
+			writeRecord(w, i);
+		});
+	}
+	CHECK_EQ(log.committed(), 0u);
+	CHECK_EQ(log.syncs(), 0u);
+
+	log.append([&](sbon::Writer w) {
+		writeRecord(w, 3);
+	});
+	CHECK_EQ(log.committed(), log.size());
+	CHECK_EQ(log.syncs(), 1u);
+
+	// A record which fails to encode is dropped
+	bool threw = false;
+	try {
+		log.append([](sbon::Writer w) {
+			w.writeArray([](sbon::Writer w) {
+				w.writeUInt(1);
+				throw std::runtime_error("oops");
+			});
+		});
+	} catch (std::runtime_error &) {
+		threw = true;
+	}
+	CHECK(threw);
+	log.close();
+
+	sbon::LogTailer tailer(path);
+	CHECK_EQ(readIds(tailer).size(), 4u);
+	removeLog(path);
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include <sbon-parallel.h>
+
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include "test.h"
+
+static void writeRecord(sbon::Writer w, std::size_t i) {
+	w.writeObject([&](sbon::ObjectWriter w) {
+		w.key("id").writeUInt(i);
+		w.key("name").writeString("record " + std::to_string(i));
+	});
+}
+
+TEST_CASE("Parallel array writing matches serial writing") {
+	for (std::size_t count: {0, 1, 100, 5000}) {
+		std::stringstream serial;
+		sbon::Writer(&serial).writeArray([&](sbon::Writer w) {
+			for (std::size_t i = 0; i < count; ++i) {
+				writeRecord(w, i);
+			}
+		});
+
+		std::stringstream parallel;
+		sbon::writeArrayParallel(sbon::Writer(&parallel), count, writeRecord, 4);
+		CHECK(parallel.str() == serial.str());
+	}
+}
+
+TEST_CASE("Parallel array writing keeps nesting checks") {
+	std::stringstream ss;
+	sbon::Writer w(&ss);
+	bool threw = false;
+	try {
+		w.writeArray([&](sbon::Writer) {
+			sbon::writeArrayParallel(w, 1000, writeRecord, 4);
+		});
+	} catch (sbon::LogicError &) {
+		threw = true;
+	}
+	CHECK(threw);
+
+	ss.str("");
+	threw = false;
+	try {
+		sbon::writeArrayParallel(sbon::Writer(&ss), 1000, [](sbon::Writer w, std::size_t i) {
+			if (i == 700) {
+				throw std::runtime_error("failed");
+			}
+			w.writeUInt(i);
+		}, 4);
+	} catch (std::runtime_error &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE("Parallel array writing records errors") {
+	std::stringstream ss;
+	sbon::Error err;
+	sbon::writeArrayParallel(sbon::Writer(&ss, &err), 1000, [](sbon::Writer w, std::size_t i) {
+		if (i == 700) {
+			// Using the outer writer inside the array is a logic error
+			w.writeArray([&](sbon::Writer) {
+				w.writeUInt(1);
+			});
+			return;
+		}
+		w.writeUInt(i);
+	}, 4);
+	CHECK(err.code == sbon::ErrorCode::LOGIC);
+
+	// The output stops where a serial writer's would
+	std::stringstream serial;
+	sbon::Error serialErr;
+	sbon::Writer(&serial, &serialErr).writeArray([](sbon::Writer w) {
+		for (std::size_t i = 0; i < 1000; ++i) {
+			if (i == 700) {
+				w.writeArray([&](sbon::Writer) {
+					w.writeUInt(1);
+				});
+				return;
+			}
+			w.writeUInt(i);
+		}
+	});
+	CHECK(serialErr.code == sbon::ErrorCode::LOGIC);
+	CHECK(ss.str() == serial.str());
+	CHECK_EQ(err.offset, serialErr.offset);
+}
+
+namespace {
+
+// An output which can't tell its position, like a pipe
+struct UnseekableBuf: std::streambuf {
+	std::string out;
+
+	int_type overflow(int_type ch) override {
+		out += (char)ch;
+		return ch;
+	}
+
+	std::streamsize xsputn(const char *data, std::streamsize size) override {
+		out.append(data, (std::size_t)size);
+		return size;
+	}
+};
+
+}
+
+TEST_CASE("Parallel array writing records errors in an unseekable output") {
+	UnseekableBuf buf;
+	std::ostream os(&buf);
+	sbon::Error err;
+	sbon::writeArrayParallel(sbon::Writer(&os, &err), 1000, [](sbon::Writer w, std::size_t i) {
+		if (i == 700) {
+			w.writeArray([&](sbon::Writer) {
+				w.writeUInt(1);
+			});
+			return;
+		}
+		w.writeUInt(i);
+	}, 4);
+	CHECK(err.code == sbon::ErrorCode::LOGIC);
+	CHECK(err.offset <= buf.out.size());
+}
+
+TEST_CASE("Parallel array writing stays close to the copying") {
+	// 4 threads make 16 chunks of 400 elements. While the first chunk
+	// is slow, the other workers mustn't encode every other chunk.
+	std::atomic<std::size_t> maxChunk{0};
+	std::atomic<bool> firstDone{false};
+	std::stringstream ss;
+	sbon::writeArrayParallel(sbon::Writer(&ss), 16 * 400, [&](sbon::Writer w, std::size_t i) {
+		if (i == 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		} else if (i == 399) {
+			firstDone = true;
+		} else if (!firstDone) {
+			std::size_t chunk = i / 400;
+			std::size_t prev = maxChunk.load();
+			while (chunk > prev && !maxChunk.compare_exchange_weak(prev, chunk)) {}
+		}
+		w.writeUInt(i);
+	}, 4);
+	CHECK(maxChunk.load() < 8);
+}
+
+TEST_CASE("Encoded values") {
+	std::stringstream ss;
+	sbon::Writer w(&ss);
+	w.writeArray([](sbon::Writer w) {
+		w.writeEncoded("TF");
+		w.writeEncoded(std::string_view("Sx\0", 3));
+	});
+
+	char expected[] = "[TFSx\0]";
+	CHECK(ss.str() == std::string(expected, sizeof(expected) - 1));
+}
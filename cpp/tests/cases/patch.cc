@@ -0,0 +1,110 @@
+#include <sbon-patch.h>
+
+#include <sstream>
+
+#include "test.h"
+
+static std::string encode(const char *buf, std::size_t size) {
+	return std::string(buf, size - 1);
+}
+
+TEST_CASE("Find values by path") {
+	char buf[] = "{flags\0[TF]count\0+\x20name\0Sbob\0}";
+	std::string doc = encode(buf, sizeof(buf));
+
+	auto span = sbon::findValue(doc, {"flags", 1});
+	REQUIRE(span);
+	CHECK(span->offset == 9);
+	CHECK(span->size == 1);
+	CHECK(span->type == sbon::Type::BOOL);
+
+	span = sbon::findValue(doc, {"name"});
+	REQUIRE(span);
+	CHECK(span->size == 5);
+	CHECK(span->type == sbon::Type::STRING);
+
+	span = sbon::findValue(doc, {});
+	REQUIRE(span);
+	CHECK(span->offset == 0);
+	CHECK(span->size == doc.size());
+
+	CHECK(!sbon::findValue(doc, {"missing"}));
+	CHECK(!sbon::findValue(doc, {"flags", 2}));
+	CHECK(!sbon::findValue(doc, {"count", 0}));
+
+	auto at = sbon::valueAt(doc, 9);
+	CHECK(at.type == sbon::Type::BOOL);
+}
+
+TEST_CASE("Patch fixed-size values in place") {
+	char buf[] = "{flag\0Tratio\0d\0\0\0\0\0\0\0\0name\0Sbob\0}";
+	std::string doc = encode(buf, sizeof(buf));
+	std::size_t size = doc.size();
+
+	CHECK(sbon::patch(doc, *sbon::findValue(doc, {"flag"}), [](sbon::Writer w) {
+		w.writeFalse();
+	}));
+	CHECK(sbon::patch(doc, *sbon::findValue(doc, {"ratio"}), [](sbon::Writer w) {
+		w.writeDouble(0.5);
+	}));
+	CHECK(sbon::patch(doc, *sbon::findValue(doc, {"name"}), [](sbon::Writer w) {
+		w.writeString("eve");
+	}));
+	CHECK(doc.size() == size);
+
+	std::stringstream ss(doc);
+	sbon::Reader(&ss).readObject([](std::string &key, sbon::Reader val) {
+		if (key == "flag") {
+			CHECK(val.getBool() == false);
+		} else if (key == "ratio") {
+			CHECK(val.getDouble() == 0.5);
+		} else {
+			CHECK(val.getString() == "eve");
+		}
+	});
+}
+
+TEST_CASE("Patch integers in place with padding") {
+	char buf[] = "[+\xff\xff\x03" "5]";
+	std::string doc = encode(buf, sizeof(buf));
+
+	auto first = *sbon::findValue(doc, {0});
+	CHECK(sbon::patch(doc, first, [](sbon::Writer w) { w.writeInt(3); }));
+	CHECK(doc == encode("[+\x83\x80\x00" "5]", 8));
+	CHECK(sbon::patch(doc, first, [](sbon::Writer w) { w.writeInt(-200); }));
+	CHECK(sbon::patch(doc, first, [](sbon::Writer w) { w.writeInt(0xffff); }));
+
+	// An immediate can't be padded
+	auto second = *sbon::findValue(doc, {1});
+	CHECK(!sbon::patch(doc, second, [](sbon::Writer w) { w.writeInt(10); }));
+
+	std::stringstream ss(doc);
+	sbon::Reader(&ss).getArray([](sbon::ArrayReader arr) {
+		CHECK(arr.next().getInt() == 0xffff);
+		CHECK(arr.next().getInt() == 10);
+	});
+}
+
+TEST_CASE("Patch by splicing") {
+	char buf[] = "{name\0Sbob\0age\0" "4}";
+	std::string doc = encode(buf, sizeof(buf));
+
+	auto span = *sbon::findValue(doc, {"name"});
+	CHECK(!sbon::patch(doc, span, [](sbon::Writer w) {
+		w.writeString("robert");
+	}));
+
+	CHECK(!sbon::patchInPlace(doc, *sbon::findValue(doc, {"age"}), "Sx"));
+
+	std::stringstream ss(doc);
+	int count = 0;
+	sbon::Reader(&ss).readObject([&](std::string &key, sbon::Reader val) {
+		if (key == "name") {
+			CHECK(val.getString() == "robert");
+		} else {
+			CHECK(val.getInt() == 4);
+		}
+		count += 1;
+	});
+	CHECK(count == 2);
+}
@@ -0,0 +1,225 @@
+#include <sbon-pull.h>
+
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "test.h"
+
+static void writeDoc(sbon::Writer w, std::size_t count) {
+	w.writeObject([&](sbon::ObjectWriter w) {
+		w.key("name").writeString("doc");
+		w.key("empty").writeArray([](sbon::Writer) {});
+		w.key("items").writeArray([&](sbon::Writer w) {
+			for (std::size_t i = 0; i < count; ++i) {
+				w.writeObject([&](sbon::ObjectWriter w) {
+					w.key("id").writeUInt(i);
+					w.key("score").writeDouble((double)i / 3);
+					w.key("label").writeString("item " + std::to_string(i));
+				});
+			}
+		});
+		w.key("ok").writeBool(true);
+	});
+}
+
+static void pullDoc(sbon::PullWriter::Value v, std::size_t count) {
+	v.writeObject([count, field = 0](sbon::PullWriter::ObjectValue obj) mutable {
+		switch (field++) {
+		case 0:
+			obj.key("name").writeString("doc");
+			return true;
+		case 1:
+			obj.key("empty").writeArray([](sbon::PullWriter::Value) {
+				return false;
+			});
+			return true;
+		case 2:
+			obj.key("items").writeArray([count, i = (std::size_t)0](sbon::PullWriter::Value v) mutable {
+				if (i == count) {
+					return false;
+				}
+
+				v.writeObject([i, field = 0](sbon::PullWriter::ObjectValue obj) mutable {
+					switch (field++) {
+					case 0:
+						obj.key("id").writeUInt(i);
+						return true;
+					case 1:
+						obj.key("score").writeDouble((double)i / 3);
+						return true;
+					case 2:
+						obj.key("label").writeString("item " + std::to_string(i));
+						return true;
+					}
+					return false;
+				});
+				i += 1;
+				return true;
+			});
+			return true;
+		case 3:
+			obj.key("ok").writeBool(true);
+			return true;
+		}
+		return false;
+	});
+}
+
+TEST_CASE("Pull writer matches Writer") {
+	std::stringstream ss;
+	writeDoc(sbon::Writer(&ss), 500);
+	std::string expected = ss.str();
+
+	for (std::size_t bufSize: {1, 7, 64, 4096}) {
+		sbon::PullWriter pw([](sbon::PullWriter::Value v) {
+			pullDoc(v, 500);
+		});
+
+		std::string out;
+		std::string buf(bufSize, '\0');
+		while (!pw.done()) {
+			std::size_t n = pw.fill(buf.data(), buf.size());
+			if (!pw.done()) {
+				CHECK_EQ(n, bufSize);
+			}
+			out.append(buf.data(), n);
+		}
+
+		CHECK(out == expected);
+		CHECK_EQ(pw.fill(buf.data(), buf.size()), 0u);
+	}
+}
+
+TEST_CASE("Pull writer pauses between calls") {
+	std::size_t produced = 0;
+	sbon::PullWriter pw([&](sbon::PullWriter::Value v) {
+		v.writeArray([&](sbon::PullWriter::Value v) {
+			if (produced == 1000) {
+				return false;
+			}
+			v.writeUInt(produced++);
+			return true;
+		});
+	});
+
+	char buf[16];
+	CHECK_EQ(pw.fill(buf, sizeof(buf)), sizeof(buf));
+	CHECK(produced < 20);
+	CHECK_EQ(pw.depth(), 2u);
+	CHECK(buf[0] == '[');
+}
+
+TEST_CASE("Pull writer logic errors") {
+	auto check = [](std::function<void(sbon::PullWriter::Value)> root) {
+		sbon::PullWriter pw(std::move(root));
+		char buf[64];
+		bool threw = false;
+		try {
+			while (!pw.done()) {
+				pw.fill(buf, sizeof(buf));
+			}
+		} catch (sbon::LogicError &) {
+			threw = true;
+		}
+		return threw;
+	};
+
+	// Nothing written
+	CHECK(check([](sbon::PullWriter::Value) {}));
+
+	// Two values written
+	CHECK(check([](sbon::PullWriter::Value v) {
+		v.writeNull();
+		v.writeNull();
+	}));
+
+	// Key without a value
+	CHECK(check([](sbon::PullWriter::Value v) {
+		v.writeObject([](sbon::PullWriter::ObjectValue obj) {
+			obj.key("a");
+			return true;
+		});
+	}));
+
+	// Element written, but the array reported done
+	CHECK(check([](sbon::PullWriter::Value v) {
+		v.writeArray([](sbon::PullWriter::Value v) {
+			v.writeNull();
+			return false;
+		});
+	}));
+
+	CHECK(!check([](sbon::PullWriter::Value v) {
+		v.writeNull();
+	}));
+}
+
+TEST_CASE("Pull writer streams large strings and binaries") {
+	std::string big(100000, 'x');
+	big[5000] = 'y';
+
+	std::stringstream ss;
+	sbon::Writer(&ss).writeArray([&](sbon::Writer w) {
+		w.writeString(big);
+		w.writeBinary(big.data(), big.size());
+		w.writeBinary(big.data(), big.size());
+		w.writeString(std::string_view("a\0b", 3));
+		w.writeString("");
+	});
+	std::string expected = ss.str();
+
+	std::stringstream is(big);
+	sbon::PullWriter pw([&](sbon::PullWriter::Value v) {
+		v.writeArray([&, i = 0](sbon::PullWriter::Value v) mutable {
+			switch (i++) {
+			case 0:
+				v.writeStringRef(big);
+				return true;
+			case 1:
+				v.writeBinaryRef(big.data(), big.size());
+				return true;
+			case 2:
+				v.writeBinary(&is, big.size());
+				return true;
+			case 3:
+				v.writeStringRef(std::string_view("a\0b", 3));
+				return true;
+			case 4:
+				v.writeStringRef("");
+				return true;
+			}
+			return false;
+		});
+	});
+
+	std::string out;
+	char buf[64];
+	while (!pw.done()) {
+		std::size_t n = pw.fill(buf, sizeof(buf));
+		out.append(buf, n);
+
+		// The stream is only read as far as the output
+		if (out.size() < 2 * big.size()) {
+			CHECK(is.tellg() == 0);
+		} else if (out.size() < 3 * big.size()) {
+			CHECK((std::size_t)is.tellg() <= out.size() - 2 * big.size());
+		}
+	}
+	CHECK(out == expected);
+
+	// A stream which ends early
+	std::stringstream shortStream("abc");
+	sbon::PullWriter truncated([&](sbon::PullWriter::Value v) {
+		v.writeBinary(&shortStream, 10);
+	});
+	bool threw = false;
+	try {
+		while (!truncated.done()) {
+			truncated.fill(buf, sizeof(buf));
+		}
+	} catch (sbon::LogicError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
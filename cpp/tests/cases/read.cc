@@ -1,5 +1,7 @@
 #include <sbon.h>
 
+#include <cmath>
+#include <memory_resource>
 #include <sstream>
 #include <string_view>
 
@@ -91,7 +93,8 @@ TEST_CASE("Floats") {
 		"f\x52\xe1\x1c\x46"
 		"f\xcd\xcc\xcc\x3d"
 		"f\x00\x00\x30\xc1"
-		"f\x00\x00\x80\x7f";
+		"f\x00\x00\x80\x7f"
+		"f\x00\x00\xc0\x7f";
 	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
 	sbon::Reader r(&ss);
 
@@ -100,6 +103,7 @@ TEST_CASE("Floats") {
 	CHECK(r.getFloat() == 0.1f);
 	CHECK(r.getFloat() == -11.0f);
 	CHECK(r.getFloat() == std::numeric_limits<float>::infinity());
+	CHECK(std::isnan(r.getFloat()));
 	CHECK(!r.hasNext());
 }
 
@@ -109,7 +113,8 @@ TEST_CASE("Doubles") {
 		"d\xd7\xa3\x70\x3d\x2a\x9c\xc3\x40"
 		"d\x9a\x99\x99\x99\x99\x99\xb9\x3f"
 		"d\x00\x00\x00\x00\x00\x00\x26\xc0"
-		"d\x00\x00\x00\x00\x00\x00\xf0\x7f";
+		"d\x00\x00\x00\x00\x00\x00\xf0\x7f"
+		"d\x00\x00\x00\x00\x00\x00\xf8\x7f";
 	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
 	sbon::Reader r(&ss);
 
@@ -118,6 +123,7 @@ TEST_CASE("Doubles") {
 	CHECK(r.getDouble() == 0.1);
 	CHECK(r.getDouble() == -11);
 	CHECK(r.getDouble() == std::numeric_limits<double>::infinity());
+	CHECK(std::isnan(r.getDouble()));
 	CHECK(!r.hasNext());
 }
 
@@ -209,3 +215,181 @@ TEST_CASE("Object matching") {
 
 	CHECK(remaining == 0);
 }
+
+TEST_CASE("Allocators") {
+	char buf[] =
+		"{a long key which doesn't fit in SSO\0"
+		"Sa long string which doesn't fit in SSO either\0"
+		"another long key which doesn't fit\0"
+		"B\x30" "012345678901234567890123456789012345678901234567"
+		"}";
+	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
+	sbon::Reader r(&ss);
+
+	// Everything must come from the arena, since its upstream can't allocate
+	char arena[1024];
+	std::pmr::monotonic_buffer_resource mr(
+		arena, sizeof(arena), std::pmr::null_memory_resource());
+
+	std::pmr::string key(&mr);
+	r.getObject([&](sbon::ObjectReader obj) {
+		auto val = obj.next(key);
+		CHECK(key == "a long key which doesn't fit in SSO");
+		CHECK(val.getString(&mr) == "a long string which doesn't fit in SSO either");
+
+		val = obj.next(key);
+		CHECK(key == "another long key which doesn't fit");
+		auto bin = val.getBinary(&mr);
+		CHECK(bin.size() == 0x30);
+		CHECK(bin[0] == '0');
+	});
+
+	CHECK(!r.hasNext());
+}
+
+TEST_CASE("Allocators with object matching") {
+	char buf[] =
+		"{a long key which doesn't fit in SSO\0"
+		"Sskipped\0"
+		"a long key which we actually want to match\0"
+		"3}";
+	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
+	sbon::Reader r(&ss);
+
+	char arena[1024];
+	std::pmr::monotonic_buffer_resource mr(
+		arena, sizeof(arena), std::pmr::null_memory_resource());
+
+	std::pmr::string key(&mr);
+	int num = 0;
+	r.matchObject({
+		{"a long key which we actually want to match", [&](sbon::Reader val) {
+			num = val.getInt();
+		}},
+	}, key);
+
+	CHECK(num == 3);
+}
+
+TEST_CASE("Error state") {
+	char buf[] = "{a\0[12X]b\0T}";
+	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
+	sbon::Error err;
+	sbon::Reader r(&ss, &err);
+
+	int count = 0;
+	bool b = false;
+	r.readObject([&](std::string &key, sbon::Reader val) {
+		if (key == "a") {
+			val.readArray([&](sbon::Reader val) {
+				val.getInt();
+				count += 1;
+			});
+		} else {
+			b = val.getBool();
+		}
+	});
+
+	CHECK(err);
+	CHECK(err.code == sbon::ErrorCode::UNEXPECTED_CHARACTER);
+	CHECK_EQ(err.offset, 7);
+	CHECK_EQ(count, 3);
+	CHECK(!b);
+	CHECK(!r.hasNext());
+	CHECK(r.getType() == sbon::Type::NIL);
+	CHECK(r.getString().empty());
+}
+
+TEST_CASE("Error state on EOF") {
+	char buf[] = "[Sunterminated";
+	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
+	sbon::Error err;
+	sbon::Reader r(&ss, &err);
+
+	std::vector<std::string> strs;
+	r.readArray([&](sbon::Reader val) {
+		strs.push_back(val.getString());
+	});
+
+	CHECK(err.code == sbon::ErrorCode::UNEXPECTED_EOF);
+	CHECK_EQ(err.offset, 14);
+	CHECK(strs.size() == 1);
+}
+
+TEST_CASE("Chunked binaries and strings") {
+	std::string big(sbon::Reader::CHUNK_SIZE * 2 + 10, 'x');
+	big[sbon::Reader::CHUNK_SIZE] = 'y';
+	std::stringstream ss;
+	sbon::Writer w(&ss);
+	w.writeBinary(big.data(), big.size());
+	w.writeString(big);
+	w.writeString("");
+
+	sbon::Reader r(&ss);
+	std::vector<std::size_t> chunks;
+	std::string bin;
+	auto size = r.readBinary([&](const unsigned char *data, std::size_t size) {
+		chunks.push_back(size);
+		bin.append((const char *)data, size);
+	});
+	CHECK_EQ(size, big.size());
+	CHECK(bin == big);
+	CHECK(chunks.size() == 3);
+	CHECK(chunks[2] == 10);
+
+	std::stringstream out;
+	CHECK_EQ(r.readString(&out), big.size());
+	CHECK(out.str() == big);
+
+	int calls = 0;
+	CHECK_EQ(r.readString([&](std::string_view) { calls += 1; }), 0);
+	CHECK_EQ(calls, 0);
+	CHECK(!r.hasNext());
+}
+
+TEST_CASE("Reading binaries and strings in pieces") {
+	std::stringstream ss;
+	sbon::Writer w(&ss);
+	w.writeBinary("abcdefg", 7);
+	w.writeString("hijklmn");
+	w.writeString("");
+	w.writeBinary("", 0);
+	w.writeInt(1);
+
+	sbon::Reader r(&ss);
+	char buf[4];
+	for (int i = 0; i < 2; ++i) {
+		auto bytes = r.readBytes();
+		std::string got;
+		std::size_t n;
+		while ((n = bytes.read(buf, sizeof(buf))) == sizeof(buf)) {
+			got.append(buf, n);
+		}
+		got.append(buf, n);
+		CHECK_EQ(got, i == 0 ? "abcdefg" : "hijklmn");
+		CHECK_EQ(bytes.read(buf, sizeof(buf)), 0u);
+	}
+
+	CHECK_EQ(r.readBytes().read(buf, sizeof(buf)), 0u);
+	CHECK_EQ(r.readBytes().read(buf, sizeof(buf)), 0u);
+	CHECK_EQ(r.getInt(), 1);
+
+	char trunc[] = "Sabc";
+	std::stringstream truncated{std::string(trunc, sizeof(trunc) - 1)};
+	sbon::Error err;
+	auto bytes = sbon::Reader(&truncated, &err).readBytes();
+	CHECK_EQ(bytes.read(buf, 2), 2u);
+	CHECK_EQ(bytes.read(buf, 2), 0u);
+	CHECK(err.code == sbon::ErrorCode::UNEXPECTED_EOF);
+}
+
+TEST_CASE("Chunked binary with truncated input") {
+	char buf[] = "B\x0a" "abc";
+	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
+	sbon::Error err;
+	sbon::Reader r(&ss, &err);
+	int calls = 0;
+	CHECK_EQ(r.readBinary([&](const unsigned char *, std::size_t) { calls += 1; }), 0);
+	CHECK_EQ(calls, 0);
+	CHECK(err.code == sbon::ErrorCode::UNEXPECTED_EOF);
+}
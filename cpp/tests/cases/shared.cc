@@ -0,0 +1,132 @@
+#include <sbon-shared.h>
+
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+static std::string config() {
+	std::stringstream ss;
+	sbon::Writer(&ss).writeObject([](sbon::ObjectWriter w) {
+		w.key("name").writeString("service");
+		w.key("port").writeUInt(8080);
+		w.key("offset").writeInt(-3);
+		w.key("ratio").writeDouble(0.25);
+		w.key("debug").writeFalse();
+		w.key("secret").writeBinary("\x01\x02\x03", 3);
+		w.key("nothing").writeNull();
+		w.key("flags").writeObject([](sbon::ObjectWriter w) {
+			for (int i = 0; i < 100; ++i) {
+				std::string key = "flag_" + std::to_string(i);
+				w.key(key.c_str()).writeBool(i % 2 == 0);
+			}
+		});
+		w.key("servers").writeArray([](sbon::Writer w) {
+			for (int i = 0; i < 3; ++i) {
+				w.writeObject([&](sbon::ObjectWriter w) {
+					w.key("host").writeString("host-" + std::to_string(i));
+				});
+			}
+		});
+	});
+	return ss.str();
+}
+
+TEST_CASE("Shared document getters") {
+	sbon::SharedDocument doc(config());
+	auto root = doc.root();
+	CHECK(root.type() == sbon::Type::OBJECT);
+	CHECK_EQ(root.size(), 9u);
+	CHECK(root.keyAt(1) == "port");
+
+	CHECK(root.find("name")->getString() == "service");
+	CHECK_EQ(root.find("port")->getUInt(), 8080u);
+	CHECK_EQ(root.find("offset")->getInt(), -3);
+	CHECK_EQ(root.find("ratio")->getDouble(), 0.25);
+	CHECK(!root.find("debug")->getBool());
+	CHECK(root.find("secret")->getBinary() == "\x01\x02\x03");
+	CHECK(root.find("nothing")->isNull());
+	CHECK(!root.find("missing"));
+	CHECK(!root.find("port")->find("x"));
+
+	CHECK(root.find({"flags", "flag_42"})->getBool());
+	CHECK(!root.find({"flags", "flag_43"})->getBool());
+	CHECK(!root.find({"flags", "flag_100"}));
+	CHECK(root.find({"servers", 2, "host"})->getString() == "host-2");
+	CHECK(!root.find({"servers", 3}));
+	CHECK(!root.find({"name", 0}));
+
+	bool threw = false;
+	try {
+		root.find("name")->getUInt();
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE("Shared document iteration") {
+	sbon::SharedDocument doc(config());
+	std::vector<std::string> hosts;
+	doc.root().find("servers")->forEach([&](sbon::SharedValue server) {
+		hosts.emplace_back(server.find("host")->getString());
+	});
+	CHECK((hosts == std::vector<std::string>{"host-0", "host-1", "host-2"}));
+
+	int enabled = 0;
+	doc.root().find("flags")->forEach([&](std::string_view key, sbon::SharedValue val) {
+		CHECK(key.starts_with("flag_"));
+		enabled += val.getBool();
+	});
+	CHECK_EQ(enabled, 50);
+}
+
+TEST_CASE("Shared document indexes lazily") {
+	sbon::SharedDocument doc(config());
+	CHECK_EQ(doc.indexed(), 0u);
+	doc.root().find("port");
+	CHECK_EQ(doc.indexed(), 1u);
+	doc.root().find({"servers", 1, "host"});
+	CHECK_EQ(doc.indexed(), 3u);
+	doc.root().find({"servers", 1, "host"});
+	CHECK_EQ(doc.indexed(), 3u);
+
+	bool threw = false;
+	try {
+		sbon::SharedDocument bad(std::string("{a\0", 3));
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
+
+TEST_CASE("Shared document across threads") {
+	sbon::SharedDocument doc(config());
+	std::atomic<int> failures{0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 8; ++t) {
+		threads.emplace_back([&, t] {
+			for (int i = 0; i < 200; ++i) {
+				int flag = (i + t) % 100;
+				std::string key = "flag_" + std::to_string(flag);
+				auto val = doc.root().find({"flags", std::string_view(key)});
+				auto host = doc.root().find({"servers", (std::size_t)(i % 3), "host"});
+				if (!val || val->getBool() != (flag % 2 == 0) ||
+						host->getString() != "host-" + std::to_string(i % 3)) {
+					failures += 1;
+				}
+			}
+		});
+	}
+
+	for (auto &thread: threads) {
+		thread.join();
+	}
+	CHECK_EQ(failures.load(), 0);
+
+	// Each container was published once, however many threads raced to build it
+	CHECK_EQ(doc.indexed(), 6u);
+}
@@ -0,0 +1,194 @@
+#include <sbon-sort.h>
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+template<typename Func>
+static std::string encode(Func func) {
+	std::stringstream ss;
+	func(sbon::Writer(&ss));
+	return ss.str();
+}
+
+static int compare(const std::string &a, const std::string &b) {
+	return sbon::compareSortKeys(sbon::sortKey(a, {}), sbon::sortKey(b, {}));
+}
+
+static void writeRecord(sbon::Writer w, std::int64_t key, std::uint64_t seq) {
+	w.writeObject([&](sbon::ObjectWriter w) {
+		w.key("meta").writeObject([&](sbon::ObjectWriter w) {
+			w.key("seq").writeUInt(seq);
+			if (key % 3 == 0) {
+				w.key("key").writeDouble((double)key);
+			} else {
+				w.key("key").writeInt(key);
+			}
+		});
+	});
+}
+
+static std::vector<std::uint64_t> readSeqs(std::istream &is, bool array = false) {
+	std::vector<std::uint64_t> seqs;
+	auto readRecord = [&](sbon::Reader r) {
+		r.readObject([&](const std::string &, sbon::Reader val) {
+			val.readObject([&](const std::string &key, sbon::Reader val) {
+				if (key == "seq") {
+					seqs.push_back(val.getUInt());
+				} else {
+					val.skip();
+				}
+			});
+		});
+	};
+
+	sbon::Reader r(&is);
+	if (array) {
+		r.readArray(readRecord);
+	} else {
+		while (r.hasNext()) {
+			readRecord(r);
+		}
+	}
+	return seqs;
+}
+
+TEST_CASE("Sort keys follow number equivalence") {
+	auto i3 = encode([](sbon::Writer w) { w.writeUInt(3); });
+	auto d3 = encode([](sbon::Writer w) { w.writeDouble(3.0); });
+	auto f3 = encode([](sbon::Writer w) { w.writeFloat(3.0f); });
+	auto half = encode([](sbon::Writer w) { w.writeDouble(2.5); });
+	auto neg = encode([](sbon::Writer w) { w.writeInt(-1); });
+	auto big = encode([](sbon::Writer w) { w.writeUInt(std::numeric_limits<std::uint64_t>::max()); });
+	auto huge = encode([](sbon::Writer w) { w.writeDouble(1e30); });
+	auto nan = encode([](sbon::Writer w) { w.writeDouble(std::nan("")); });
+	auto negHalf = encode([](sbon::Writer w) { w.writeDouble(-0.5); });
+
+	CHECK_EQ(compare(i3, d3), 0);
+	CHECK_EQ(compare(d3, f3), 0);
+	CHECK_EQ(compare(half, i3), -1);
+	CHECK_EQ(compare(i3, half), 1);
+	CHECK_EQ(compare(neg, negHalf), -1);
+	CHECK_EQ(compare(negHalf, neg), 1);
+	CHECK_EQ(compare(big, huge), -1);
+	CHECK_EQ(compare(huge, nan), -1);
+	CHECK_EQ(compare(nan, nan), 0);
+}
+
+TEST_CASE("Sort keys are ordered by kind") {
+	std::vector<std::string> ordered = {
+		encode([](sbon::Writer w) { w.writeObject([](sbon::ObjectWriter) {}); }),
+		encode([](sbon::Writer w) { w.writeNull(); }),
+		encode([](sbon::Writer w) { w.writeFalse(); }),
+		encode([](sbon::Writer w) { w.writeTrue(); }),
+		encode([](sbon::Writer w) { w.writeInt(-100); }),
+		encode([](sbon::Writer w) { w.writeString("a"); }),
+		encode([](sbon::Writer w) { w.writeString("ab"); }),
+		encode([](sbon::Writer w) { w.writeBinary("\x01", 1); }),
+		encode([](sbon::Writer w) { w.writeArray([](sbon::Writer) {}); }),
+	};
+
+	// The first record has no "x"
+	std::vector<std::string> path = {"x"};
+	for (std::size_t i = 1; i < ordered.size(); ++i) {
+		std::string a = encode([&](sbon::Writer w) {
+			w.writeObject([&](sbon::ObjectWriter w) {
+				w.key("x").writeEncoded(ordered[i - 1]);
+			});
+		});
+		std::string b = encode([&](sbon::Writer w) {
+			w.writeObject([&](sbon::ObjectWriter w) {
+				w.key("x").writeEncoded(ordered[i]);
+			});
+		});
+		if (i == 1) {
+			a = ordered[0];
+		}
+		CHECK_EQ(sbon::compareSortKeys(sbon::sortKey(a, path), sbon::sortKey(b, path)), -1);
+	}
+
+	auto bin = encode([](sbon::Writer w) { w.writeBinary("xyz", 3); });
+	auto key = sbon::sortKey(bin, {});
+	CHECK(key.bytes == "xyz");
+	CHECK((sbon::parseSortPath("a.b.c") == std::vector<std::string>{"a", "b", "c"}));
+}
+
+TEST_CASE("External sort spills runs") {
+	std::stringstream in;
+	std::vector<std::int64_t> keys;
+	for (std::uint64_t i = 0; i < 5000; ++i) {
+		std::int64_t key = (std::int64_t)((i * 7919) % 1000) - 500;
+		keys.push_back(key);
+		writeRecord(sbon::Writer(&in), key, i);
+	}
+
+	std::vector<std::uint64_t> expected(keys.size());
+	for (std::uint64_t i = 0; i < expected.size(); ++i) {
+		expected[i] = i;
+	}
+	std::stable_sort(expected.begin(), expected.end(), [&](std::uint64_t a, std::uint64_t b) {
+		return keys[a] < keys[b];
+	});
+
+	sbon::SortOptions opts;
+	opts.path = sbon::parseSortPath("meta.key");
+	opts.memoryBudget = 4096;
+	opts.threads = 3;
+
+	std::stringstream out;
+	auto stats = sbon::sortRecords(&in, &out, opts);
+	CHECK_EQ(stats.records, 5000u);
+	CHECK(stats.runs > 64);
+	CHECK(stats.mergePasses > 0);
+	CHECK(readSeqs(out) == expected);
+
+	// Sorted in memory, descending
+	in.clear();
+	in.seekg(0);
+	opts.memoryBudget = 1024 * 1024;
+	opts.descending = true;
+	std::stringstream desc;
+	stats = sbon::sortRecords(&in, &desc, opts);
+	CHECK_EQ(stats.runs, 1u);
+	std::stable_sort(expected.begin(), expected.end(), [&](std::uint64_t a, std::uint64_t b) {
+		return keys[a] > keys[b];
+	});
+	CHECK(readSeqs(desc) == expected);
+}
+
+TEST_CASE("External sort of a top-level array") {
+	std::stringstream in;
+	sbon::Writer(&in).writeArray([](sbon::Writer w) {
+		for (std::uint64_t i = 0; i < 100; ++i) {
+			writeRecord(w, 50 - (std::int64_t)(i % 50), i);
+		}
+	});
+
+	sbon::SortOptions opts;
+	opts.path = {"meta", "key"};
+	opts.array = true;
+	opts.memoryBudget = 512;
+	std::stringstream out;
+	sbon::sortRecords(&in, &out, opts);
+
+	auto seqs = readSeqs(out, true);
+	REQUIRE(seqs.size() == 100);
+	CHECK_EQ(seqs[0], 49u);
+	CHECK_EQ(seqs[1], 99u);
+	CHECK_EQ(seqs[98], 0u);
+	CHECK_EQ(seqs[99], 50u);
+
+	std::stringstream bad("[1");
+	std::stringstream discard;
+	bool threw = false;
+	try {
+		sbon::sortRecords(&bad, &discard, opts);
+	} catch (sbon::ParseError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}
@@ -0,0 +1,73 @@
+#include <sbon.h>
+
+#include <sstream>
+
+#include "test.h"
+
+#ifdef SBON_STATS
+
+TEST_CASE("Stats count bytes per type") {
+	char buf[] = "[T+\x80\x01" "Shello\0{k\0N}]";
+	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
+
+	sbon::Stats stats;
+	{
+		sbon::StatsScope scope(stats);
+		sbon::Reader r(&ss);
+		r.readArray([](sbon::Reader val) {
+			if (val.getType() == sbon::Type::STRING) {
+				CHECK(val.getString() == "hello");
+			} else {
+				val.skip();
+			}
+		});
+	}
+
+	CHECK_EQ(stats.bytesRead, sizeof(buf) - 1);
+	CHECK_EQ(stats.bytes[(int)sbon::Type::BOOL], 1u);
+	CHECK_EQ(stats.bytes[(int)sbon::Type::UINT], 3u);
+	CHECK_EQ(stats.bytes[(int)sbon::Type::STRING], 7u);
+	CHECK_EQ(stats.bytes[(int)sbon::Type::NIL], 1u);
+	CHECK_EQ(stats.bytes[(int)sbon::Type::OBJECT], 2u);
+	CHECK_EQ(stats.bytes[(int)sbon::Type::ARRAY], 2u);
+	CHECK_EQ(stats.keyBytes, 2u);
+	CHECK_EQ(stats.valuesDecoded, 2u);
+	CHECK_EQ(stats.valuesSkipped, 4u);
+	CHECK_EQ(stats.bytesSkipped, 1u + 3u + 5u);
+	CHECK_EQ(stats.maxDepth, 2u);
+	CHECK_EQ(stats.depth, 0u);
+}
+
+TEST_CASE("Stats count match hits and misses") {
+	char buf[] = "{a\0" "1b\0" "2c\0" "3}";
+	std::stringstream ss{std::string(buf, sizeof(buf) - 1)};
+
+	sbon::Stats stats;
+	sbon::StatsScope scope(stats);
+	sbon::Reader r(&ss);
+	r.matchObject({
+		{"b", [](sbon::Reader val) {
+			CHECK(val.getInt() == 2);
+		}},
+	});
+
+	CHECK_EQ(stats.matchHits, 1u);
+	CHECK_EQ(stats.matchMisses, 2u);
+	CHECK_EQ(stats.valuesSkipped, 2u);
+}
+
+TEST_CASE("Stats are only collected inside a scope") {
+	std::stringstream ss{"TT"};
+	sbon::Reader r(&ss);
+
+	sbon::Stats stats;
+	{
+		sbon::StatsScope scope(stats);
+		r.getBool();
+	}
+	r.getBool();
+
+	CHECK_EQ(stats.bytesRead, 1u);
+}
+
+#endif
@@ -227,3 +227,40 @@ TEST_CASE("Logic error checking") {
 	}
 	CHECK(threw);
 }
+
+TEST_CASE("Logic error state") {
+	std::stringstream ss;
+	sbon::Error err;
+	sbon::Writer w(&ss, &err);
+
+	w.writeArray([&](sbon::Writer inner) {
+		inner.writeInt(1);
+		w.writeInt(10);
+		inner.writeInt(2);
+	});
+	w.writeInt(3);
+
+	CHECK(err.code == sbon::ErrorCode::LOGIC);
+	CHECK_EQ(err.offset, 2);
+	CHECK_EQ(ss.str(), "[1]");
+}
+
+TEST_CASE("Binary from a stream") {
+	std::string big(10000, 'x');
+	std::stringstream in(big + "trailing");
+	std::stringstream ss;
+	sbon::Writer w(&ss);
+	w.writeBinary(&in, big.size());
+
+	std::string expected = "B\x90\x4e" + big;
+	CHECK(ss.str() == expected);
+
+	std::stringstream shortIn("abc");
+	bool threw = false;
+	try {
+		w.writeBinary(&shortIn, 4);
+	} catch (sbon::LogicError &) {
+		threw = true;
+	}
+	CHECK(threw);
+}